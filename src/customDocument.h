@@ -4,6 +4,10 @@
 #include <QtGui>
 #include <QStringList>
 #include <QTextEdit>
+#include <memory>
+#include "nodedata.h"
+
+struct DocumentIndex;
 
 class CustomDocument : public QTextEdit
 {
@@ -21,16 +25,28 @@ public:
     QUrl getUrlUnderMouse();
     void moveBlockUp();
     void moveBlockDown();
+    QVector<NoteHeading> outline();
 signals:
     void resized();
     void mouseMoved();
+    void focusLost();
 
     // QWidget interface
 protected:
     void resizeEvent(QResizeEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
+    void focusOutEvent(QFocusEvent *event) override;
 
     QStringList _ignoredClickUrlSchemata;
+
+private:
+    std::shared_ptr<DocumentIndex> documentIndex(QTextDocument *document);
+    QString referenceUrl(QTextDocument *document, const QString &referenceId);
+    void onDocumentContentsChange(QTextDocument *document, int position, int charsAdded);
+
+    // links and outlines of the documents shown so far, kept up to date as
+    // they change
+    QHash<const QTextDocument *, std::shared_ptr<DocumentIndex>> m_documentIndexes;
 };
 
 #endif // CUSTOMDOCUMENT_H
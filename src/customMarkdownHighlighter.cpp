@@ -1,12 +1,114 @@
 #include "customMarkdownHighlighter.h"
 #include "editorsettingsoptions.h"
+#include <QTextBlock>
+#include <QTextDocument>
+
+namespace {
+// time one synchronous pass may spend outside the priority range
+auto constexpr PASS_BUDGET_MS = 8;
+// time one idle slice may spend on pending blocks
+auto constexpr SLICE_BUDGET_MS = 4;
+} // namespace
 
 CustomMarkdownHighlighter::CustomMarkdownHighlighter(QTextDocument *parent, HighlightingOptions highlightingOptions)
-    : MarkdownHighlighter(parent, highlightingOptions)
+    : MarkdownHighlighter(parent, highlightingOptions),
+      m_priorityFirst{ 0 },
+      m_priorityLast{ 0 }
 {
     setListsColor(QColor(35, 131, 226)); // accent color
 
     _formats[static_cast<HighlighterState>(HighlighterState::HorizontalRuler)].clearBackground();
+
+    m_pendingTimer.setSingleShot(true);
+    m_pendingTimer.setInterval(0);
+    QObject::connect(&m_pendingTimer, &QTimer::timeout, this, [this]() { highlightPendingBlocks(); });
+}
+
+void CustomMarkdownHighlighter::setPriorityRange(int firstBlock, int lastBlock)
+{
+    m_priorityFirst = firstBlock;
+    m_priorityLast = lastBlock;
+    auto const pending = firstPendingBlock();
+    if (!pending.isValid() || pending.blockNumber() > lastBlock) {
+        return;
+    }
+    // blocks pending before the range stay so
+    auto const resumesInRange = pending.blockNumber() >= firstBlock;
+    if (resumesInRange) {
+        m_pendingCursor = QTextCursor();
+    }
+    auto block = resumesInRange ? pending : document()->findBlockByNumber(firstBlock);
+    for (; block.isValid() && block.blockNumber() <= lastBlock; block = block.next()) {
+        rehighlightBlock(block);
+    }
+    if (resumesInRange && block.isValid()) {
+        markPending(block);
+    }
+}
+
+void CustomMarkdownHighlighter::highlightBlock(const QString &text)
+{
+    if (shouldDefer()) {
+        // The block keeps the state it had, so the pass stops here instead
+        // of running through the rest of the document; whatever follows is
+        // brought up to date from here by the idle slices.
+        markPending(currentBlock());
+        return;
+    }
+    MarkdownHighlighter::highlightBlock(text);
+}
+
+// Blocks from the first pending one on may be stale. A cursor keeps that
+// position across edits.
+QTextBlock CustomMarkdownHighlighter::firstPendingBlock() const
+{
+    if (m_pendingCursor.isNull() || m_pendingCursor.document() != document()) {
+        return {};
+    }
+    return m_pendingCursor.block();
+}
+
+void CustomMarkdownHighlighter::markPending(const QTextBlock &block)
+{
+    auto const pending = firstPendingBlock();
+    if (!pending.isValid() || block.position() < pending.position()) {
+        m_pendingCursor = QTextCursor(block);
+        m_pendingCursor.setKeepPositionOnInsert(true);
+    }
+    if (!m_pendingTimer.isActive()) {
+        m_pendingTimer.start();
+    }
+}
+
+bool CustomMarkdownHighlighter::shouldDefer()
+{
+    auto const blockNumber = currentBlock().blockNumber();
+    if (blockNumber >= m_priorityFirst && blockNumber <= m_priorityLast) {
+        return false;
+    }
+    if (!m_passTimer.isValid()) {
+        // the pass ends when control gets back to the event loop
+        m_passTimer.start();
+        QTimer::singleShot(0, this, [this]() { m_passTimer.invalidate(); });
+    }
+    return m_passTimer.elapsed() >= PASS_BUDGET_MS;
+}
+
+// One idle slice: highlights blocks from the first pending one on. Blocks
+// deferred meanwhile move the start back.
+void CustomMarkdownHighlighter::highlightPendingBlocks()
+{
+    auto block = firstPendingBlock();
+    m_pendingCursor = QTextCursor();
+    m_passTimer.start();
+    while (block.isValid() && m_passTimer.elapsed() < SLICE_BUDGET_MS) {
+        rehighlightBlock(block);
+        block = block.next();
+    }
+    m_passTimer.invalidate();
+    if (block.isValid()) {
+        markPending(block);
+    }
 }
 
 void CustomMarkdownHighlighter::setHeaderColors(QColor color)
@@ -2,7 +2,15 @@
 
 #include "3rdParty/qmarkdowntextedit/markdownhighlighter.h"
 #include "editorsettingsoptions.h"
+#include <QElapsedTimer>
+#include <QTextCursor>
+#include <QTimer>
 
+// Highlights the blocks in the priority range (the visible part of the
+// editor) right away and everything else within a per pass time budget.
+// A block over budget keeps its last state and the blocks from it on are
+// highlighted in short slices while the event loop is idle, so replacing
+// the text of a big note doesn't block on a full pass.
 class CustomMarkdownHighlighter : public MarkdownHighlighter
 {
 public:
@@ -14,4 +22,22 @@ public:
     void setListsColor(QColor color);
 
     void setTheme(Theme::Value theme, QColor textColor, qreal fontSize);
+
+    // Block numbers, inclusive. Pending blocks in the range are highlighted now.
+    void setPriorityRange(int firstBlock, int lastBlock);
+
+protected:
+    void highlightBlock(const QString &text) override;
+
+private:
+    bool shouldDefer();
+    QTextBlock firstPendingBlock() const;
+    void markPending(const QTextBlock &block);
+    void highlightPendingBlocks();
+
+    int m_priorityFirst;
+    int m_priorityLast;
+    QElapsedTimer m_passTimer;
+    QTimer m_pendingTimer;
+    QTextCursor m_pendingCursor;
 };
@@ -1,8 +1,160 @@
 #include "customDocument.h"
+#include "noteoutline.h"
 #include <QDebug>
 #include <QGuiApplication>
 #include <QTextCursor>
+#include <QTextBlock>
 #include <QMessageBox>
+#include <algorithm>
+#include <limits>
+
+// Per document: where the reference definitions ("[id]: url") are, and the
+// references resolved since they last changed; and the blocks the outline
+// comes from, see note_outline::isOutlineLine(). The outline
+// blocks are kept in document order as the text changes, and looked for
+// again only when one of them is removed.
+struct DocumentIndex
+{
+    bool definitionsChanged = true;
+    QVector<QTextBlock> definitionBlocks;
+    QHash<QString, QString> referenceUrls;
+    bool outlineBlocksChanged = true;
+    QVector<QTextBlock> outlineBlocks;
+};
+
+namespace {
+// changes spanning more blocks than this are parsed lazily
+auto constexpr EAGER_PARSE_BLOCKS = 64;
+// a revision no block has, see invalidateMarkup()
+auto constexpr STALE_REVISION = std::numeric_limits<int>::min();
+
+struct BlockLink
+{
+    int start;
+    int end;
+    QString url; // the reference id for reference links
+    QString linkText;
+    bool isReference;
+};
+
+// Links and outline markup found in the text of a block, kept as its user
+// data. The block revision tells whether the text changed since it was parsed.
+class BlockMarkup : public QTextBlockUserData
+{
+public:
+    BlockMarkup(const QString &text, int revision, std::shared_ptr<DocumentIndex> index);
+    ~BlockMarkup() override;
+
+    int revision;
+    QVector<BlockLink> links;
+    // positions of "]: " followed by text, which may end a reference definition
+    QVector<int> definitionMarks;
+    bool isOutlineLine;
+    // set when the block gets new markup, as opposed to being removed
+    bool isReplaced = false;
+
+private:
+    std::shared_ptr<DocumentIndex> m_index;
+};
+
+QVector<BlockLink> parseLinks(const QString &text)
+{
+    QVector<BlockLink> links;
+    if (!text.contains(QLatin1Char('<')) && !text.contains(QLatin1Char('[')) && !text.contains(QLatin1Char(':'))
+        && !text.contains(QLatin1String("www."))) {
+        return links;
+    }
+
+    // match urls like this: <http://mylink>
+    static const QRegularExpression angleUrlRegex(QStringLiteral("(<(.+?)>)"));
+    // match urls like this: [link text](http://mylink)
+    static const QRegularExpression markdownUrlRegex(R"((\[.*?\]\((.+?)\)))");
+    // match urls like this: http://mylink
+    static const QRegularExpression plainUrlRegex(R"(\b\w+?:\/\/[^\s]+[^\s>\)])");
+    // match urls like this: www.github.com
+    static const QRegularExpression wwwUrlRegex(R"(\bwww\.[^\s]+\.[^\s]+\b)");
+    // match reference urls like this: [this url][1] with this later:
+    // [1]: http://domain
+    static const QRegularExpression referenceUrlRegex(R"((\[.*?\]\[(.+?)\]))");
+
+    auto iterator = angleUrlRegex.globalMatch(text);
+    while (iterator.hasNext()) {
+        auto const match = iterator.next();
+        links.append({ static_cast<int>(match.capturedStart(1)), static_cast<int>(match.capturedEnd(1)), match.captured(2), match.captured(1), false });
+    }
+    iterator = markdownUrlRegex.globalMatch(text);
+    while (iterator.hasNext()) {
+        auto const match = iterator.next();
+        links.append({ static_cast<int>(match.capturedStart(1)), static_cast<int>(match.capturedEnd(1)), match.captured(2), match.captured(1), false });
+    }
+    iterator = plainUrlRegex.globalMatch(text);
+    while (iterator.hasNext()) {
+        auto const match = iterator.next();
+        links.append({ static_cast<int>(match.capturedStart(0)), static_cast<int>(match.capturedEnd(0)), match.captured(0), match.captured(0), false });
+    }
+    iterator = wwwUrlRegex.globalMatch(text);
+    while (iterator.hasNext()) {
+        auto const match = iterator.next();
+        links.append({ static_cast<int>(match.capturedStart(0)), static_cast<int>(match.capturedEnd(0)), QStringLiteral("http://%1").arg(match.captured(0)),
+                       match.captured(0), false });
+    }
+    iterator = referenceUrlRegex.globalMatch(text);
+    while (iterator.hasNext()) {
+        auto const match = iterator.next();
+        links.append({ static_cast<int>(match.capturedStart(1)), static_cast<int>(match.capturedEnd(1)), match.captured(2), match.captured(1), true });
+    }
+    return links;
+}
+
+BlockMarkup::BlockMarkup(const QString &text, int revision, std::shared_ptr<DocumentIndex> index)
+    : revision{ revision }, links{ parseLinks(text) }, isOutlineLine{ note_outline::isOutlineLine(text) }, m_index{ std::move(index) }
+{
+    auto const marker = QLatin1String("]: ");
+    for (auto i = text.indexOf(marker); i >= 0; i = text.indexOf(marker, i + 1)) {
+        if (i + marker.size() < text.size()) {
+            definitionMarks.append(static_cast<int>(i));
+        }
+    }
+    if (!definitionMarks.isEmpty()) {
+        m_index->definitionsChanged = true;
+    }
+}
+
+BlockMarkup::~BlockMarkup()
+{
+    // also runs when the block is removed
+    if (!definitionMarks.isEmpty()) {
+        m_index->definitionsChanged = true;
+    }
+    if (isOutlineLine && !isReplaced) {
+        // the index may still have it
+        m_index->outlineBlocksChanged = true;
+    }
+}
+
+// The markup of the block, parsed again if its text changed
+BlockMarkup *markupOf(QTextBlock block, const std::shared_ptr<DocumentIndex> &index)
+{
+    auto *data = dynamic_cast<BlockMarkup *>(block.userData());
+    if (data == nullptr || data->revision != block.revision()) {
+        if (data != nullptr) {
+            data->isReplaced = true;
+        }
+        data = new BlockMarkup(block.text(), block.revision(), index);
+        block.setUserData(data);
+    }
+    return data;
+}
+
+// Makes markupOf() parse the block again. Needed where the block revision
+// can't tell: a document without undo keeps its revision as it is edited.
+void invalidateMarkup(const QTextBlock &block)
+{
+    if (auto *data = dynamic_cast<BlockMarkup *>(block.userData())) {
+        data->revision = STALE_REVISION;
+    }
+}
+} // namespace
 
 CustomDocument::CustomDocument(QWidget *parent) : QTextEdit(parent)
 {
@@ -40,6 +192,12 @@ void CustomDocument::mouseMoveEvent(QMouseEvent *event)
     emit mouseMoved();
 }
 
+void CustomDocument::focusOutEvent(QFocusEvent *event)
+{
+    QTextEdit::focusOutEvent(event);
+    emit focusLost();
+}
+
 bool CustomDocument::eventFilter(QObject *obj, QEvent *event)
 {
     // qDebug() << event->type();
@@ -104,35 +262,23 @@ bool CustomDocument::eventFilter(QObject *obj, QEvent *event)
  */
 QString CustomDocument::getMarkdownUrlAtPosition(const QString &text, int position)
 {
-    QString url;
-
-    // get a map of parsed markdown urls with their link texts as key
-    const QMap<QString, QString> urlMap = parseMarkdownUrlsFromText(text);
-    QMap<QString, QString>::const_iterator i = urlMap.constBegin();
-    for (; i != urlMap.constEnd(); ++i) {
-        const QString &linkText = i.key();
-        const QString &urlString = i.value();
-
-        const int foundPositionStart = text.indexOf(linkText);
-
-        if (foundPositionStart >= 0) {
-            // calculate end position of found linkText
-            const int foundPositionEnd = foundPositionStart + linkText.size();
-
-            // check if position is in found string range
-            if ((position >= foundPositionStart) && (position < foundPositionEnd)) {
-                url = urlString;
-                break;
+    for (const auto &link : parseLinks(text)) {
+        if (position >= link.start && position < link.end) {
+            auto const url = link.isReference ? referenceUrl(document(), link.url) : link.url;
+            if (!url.isEmpty()) {
+                return url;
             }
         }
     }
-
-    return url;
+    return QString();
 }
 
 /**
  * @brief Returns the URL under the current mouse cursor
  *
+ * Only the links of the block under the mouse are looked at, and they are
+ * parsed again only when the block changed.
+ *
  * @return QUrl
  */
 QUrl CustomDocument::getUrlUnderMouse()
@@ -140,15 +286,155 @@ QUrl CustomDocument::getUrlUnderMouse()
     // place a temp cursor at the mouse position
     auto pos = viewport()->mapFromGlobal(QCursor::pos());
     QTextCursor cursor = cursorForPosition(pos);
-    const int cursorPosition = cursor.position();
+    const int indexInBlock = cursor.positionInBlock();
+
+    auto *blockMarkup = markupOf(cursor.block(), documentIndex(document()));
+    for (const auto &link : std::as_const(blockMarkup->links)) {
+        if (indexInBlock >= link.start && indexInBlock < link.end) {
+            auto const url = link.isReference ? referenceUrl(document(), link.url) : link.url;
+            if (!url.isEmpty()) {
+                return { url };
+            }
+        }
+    }
+    return {};
+}
 
-    // select the text of the current block
-    cursor.movePosition(QTextCursor::StartOfBlock);
-    const int indexInBlock = cursorPosition - cursor.position();
-    cursor.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
+/**
+ * @brief Returns the index of document, made on first use
+ */
+std::shared_ptr<DocumentIndex> CustomDocument::documentIndex(QTextDocument *document)
+{
+    auto index = m_documentIndexes.value(document);
+    if (index == nullptr) {
+        index = std::make_shared<DocumentIndex>();
+        m_documentIndexes.insert(document, index);
+        connect(document, &QTextDocument::contentsChange, this,
+                [this, document](int position, int, int charsAdded) { onDocumentContentsChange(document, position, charsAdded); });
+        connect(document, &QObject::destroyed, this, [this, document]() { m_documentIndexes.remove(document); });
+    }
+    return index;
+}
 
-    // get the correct link from the selected text, or an empty URL if none found
-    return { getMarkdownUrlAtPosition(cursor.selectedText(), indexInBlock) };
+/**
+ * @brief Parses the changed blocks again
+ *
+ * Blocks that get or lose a reference definition invalidate the resolved
+ * references, see BlockMarkup. The changed blocks replace the outline blocks
+ * in their range.
+ */
+void CustomDocument::onDocumentContentsChange(QTextDocument *document, int position, int charsAdded)
+{
+    auto const index = m_documentIndexes.value(document);
+    if (index == nullptr) {
+        return;
+    }
+    auto const first = document->findBlock(position);
+    auto const last = document->findBlock(position + charsAdded);
+    if (!document->isUndoRedoEnabled()) {
+        for (auto block = first; block.isValid(); block = block.next()) {
+            invalidateMarkup(block);
+            if (block == last) {
+                break;
+            }
+        }
+    }
+    if (last.blockNumber() - first.blockNumber() > EAGER_PARSE_BLOCKS) {
+        // e.g. the whole text was replaced: parse the blocks once they are needed
+        index->definitionsChanged = true;
+        index->outlineBlocksChanged = true;
+        return;
+    }
+    QVector<QTextBlock> outlineBlocks;
+    for (auto block = first; block.isValid(); block = block.next()) {
+        if (markupOf(block, index)->isOutlineLine) {
+            outlineBlocks.append(block);
+        }
+        if (block == last) {
+            break;
+        }
+    }
+    if (index->outlineBlocksChanged) {
+        return;
+    }
+    // no outline block was removed, so all of them are still valid
+    auto &blocks = index->outlineBlocks;
+    auto const begin = std::lower_bound(blocks.begin(), blocks.end(), first.position(),
+                                        [](const QTextBlock &block, int position) { return block.position() < position; });
+    auto const end = std::upper_bound(begin, blocks.end(), last.position(),
+                                      [](int position, const QTextBlock &block) { return position < block.position(); });
+    auto at = begin - blocks.begin();
+    blocks.erase(begin, end);
+    for (const auto &block : std::as_const(outlineBlocks)) {
+        blocks.insert(at++, block);
+    }
+}
+
+/**
+ * @brief Returns the headings of the document in the editor
+ *
+ * Only the outline blocks are looked at; they are looked for in the whole
+ * text after a big change or the removal of one of them.
+ */
+QVector<NoteHeading> CustomDocument::outline()
+{
+    auto *document = this->document();
+    auto const index = documentIndex(document);
+    if (index->outlineBlocksChanged) {
+        index->outlineBlocks.clear();
+        for (const auto number : note_outline::outlineLineNumbers(document->toPlainText())) {
+            auto const block = document->findBlockByNumber(number);
+            // so that its removal is noticed
+            markupOf(block, index);
+            index->outlineBlocks.append(block);
+        }
+        index->outlineBlocksChanged = false;
+    }
+    QVector<note_outline::OutlineLine> lines;
+    lines.reserve(index->outlineBlocks.size());
+    for (const auto &block : std::as_const(index->outlineBlocks)) {
+        lines.append({ block.blockNumber(), block.text(), block.previous().text() });
+    }
+    return note_outline::outline(lines);
+}
+
+/**
+ * @brief Returns the url of the first "[referenceId]: url" definition in document
+ */
+QString CustomDocument::referenceUrl(QTextDocument *document, const QString &referenceId)
+{
+    auto const index = documentIndex(document);
+    if (index->definitionsChanged) {
+        index->definitionBlocks.clear();
+        index->referenceUrls.clear();
+        for (auto block = document->begin(); block.isValid(); block = block.next()) {
+            if (!markupOf(block, index)->definitionMarks.isEmpty()) {
+                index->definitionBlocks.append(block);
+            }
+        }
+        index->definitionsChanged = false;
+    }
+    auto it = index->referenceUrls.constFind(referenceId);
+    if (it != index->referenceUrls.constEnd()) {
+        return *it;
+    }
+
+    QString url;
+    auto const opening = QStringLiteral("[%1").arg(referenceId);
+    for (const auto &block : std::as_const(index->definitionBlocks)) {
+        auto const text = block.text();
+        for (const auto mark : std::as_const(markupOf(block, index)->definitionMarks)) {
+            if (mark >= opening.size() && QStringView(text).mid(mark - opening.size(), opening.size()) == opening) {
+                url = text.mid(mark + 3);
+                break;
+            }
+        }
+        if (!url.isEmpty()) {
+            break;
+        }
+    }
+    index->referenceUrls.insert(referenceId, url);
+    return url;
 }
 
 /**
@@ -212,8 +498,8 @@ bool CustomDocument::openLinkAtCursorPosition()
  */
 bool CustomDocument::isValidUrl(const QString &urlString)
 {
-    const QRegularExpressionMatch match = QRegularExpression(R"(^\w+:\/\/.+)").match(urlString);
-    return match.hasMatch();
+    static const QRegularExpression urlRegex(R"(^\w+:\/\/.+)");
+    return urlRegex.match(urlString).hasMatch();
 }
 
 /**
@@ -241,65 +527,16 @@ void CustomDocument::openUrl(const QString &urlString)
 QMap<QString, QString> CustomDocument::parseMarkdownUrlsFromText(const QString &text)
 {
     QMap<QString, QString> urlMap;
-    QRegularExpression regex;
-    QRegularExpressionMatchIterator iterator;
-
-    // match urls like this: <http://mylink>
-    //    re = QRegularExpression("(<(.+?:\\/\\/.+?)>)");
-    regex = QRegularExpression(QStringLiteral("(<(.+?)>)"));
-    iterator = regex.globalMatch(text);
-    while (iterator.hasNext()) {
-        QRegularExpressionMatch match = iterator.next();
-        QString linkText = match.captured(1);
-        QString url = match.captured(2);
-        urlMap[linkText] = url;
-    }
-
-    regex = QRegularExpression(R"((\[.*?\]\((.+?)\)))");
-    iterator = regex.globalMatch(text);
-    while (iterator.hasNext()) {
-        QRegularExpressionMatch match = iterator.next();
-        QString linkText = match.captured(1);
-        QString url = match.captured(2);
-        urlMap[linkText] = url;
-    }
-
-    // match urls like this: http://mylink
-    regex = QRegularExpression(R"(\b\w+?:\/\/[^\s]+[^\s>\)])");
-    iterator = regex.globalMatch(text);
-    while (iterator.hasNext()) {
-        QRegularExpressionMatch match = iterator.next();
-        QString url = match.captured(0);
-        urlMap[url] = url;
-    }
-
-    // match urls like this: www.github.com
-    regex = QRegularExpression(R"(\bwww\.[^\s]+\.[^\s]+\b)");
-    iterator = regex.globalMatch(text);
-    while (iterator.hasNext()) {
-        QRegularExpressionMatch match = iterator.next();
-        QString url = match.captured(0);
-        urlMap[url] = QStringLiteral("http://%1").arg(url);
-    }
-
-    // match reference urls like this: [this url][1] with this later:
-    // [1]: http://domain
-    regex = QRegularExpression(R"((\[.*?\]\[(.+?)\]))");
-    iterator = regex.globalMatch(text);
-    while (iterator.hasNext()) {
-        QRegularExpressionMatch match = iterator.next();
-        QString linkText = match.captured(1);
-        QString referenceId = match.captured(2);
-
-        QRegularExpression refRegExp(QStringLiteral("\\[%1\\]: (.+)").arg(QRegularExpression::escape(referenceId)));
-        QRegularExpressionMatch urlMatch = refRegExp.match(toPlainText());
-
-        if (urlMatch.hasMatch()) {
-            QString url = urlMatch.captured(1);
-            urlMap[linkText] = url;
+    for (const auto &link : parseLinks(text)) {
+        if (!link.isReference) {
+            urlMap[link.linkText] = link.url;
+            continue;
+        }
+        auto const url = referenceUrl(document(), link.url);
+        if (!url.isEmpty()) {
+            urlMap[link.linkText] = url;
         }
     }
-
     return urlMap;
 }
 
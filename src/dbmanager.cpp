@@ -1,29 +1,83 @@
 #include "dbmanager.h"
+#include "dbscheduler.h"
+#include "noteoutline.h"
 #include <QtSql/QSqlQuery>
 #include <QTimeZone>
 #include <QDateTime>
 #include <QDebug>
+#include <QDataStream>
 #include <QSqlError>
 #include <QtConcurrent>
 #include <QSqlRecord>
 #include <QSet>
+#include <QTimer>
 #include <algorithm>
 
 #define DEFAULT_DATABASE_NAME "default_database"
 #define OUTSIDE_DATABASE_NAME "outside_database"
 
+namespace {
+// ids DBManager takes from the metadata counters in one go
+auto constexpr ID_BLOCK_SIZE = 256;
+// work done per background chunk before yielding to queued requests
+auto constexpr RECOUNT_CHUNK_SIZE = 32;
+auto constexpr EXPORT_CHUNK_SIZE = 50;
+// the deltas of a note are folded into its content once they are this many
+// or this big, or once no deltas came in for a while
+auto constexpr JOURNAL_COMPACT_DELTAS = 512;
+auto constexpr JOURNAL_COMPACT_BYTES = 256 * 1024;
+auto constexpr JOURNAL_IDLE_COMPACT_MS = 30 * 1000;
+
+// Note lists only load the start of a large note, for its preview; the
+// editor loads the rest when it opens the note. These stand in for the
+// content column of list queries, the second one says whether it was cut
+QString previewContentColumn()
+{
+    return QStringLiteral(R"(CASE WHEN length("content") > %1 THEN substr("content", 1, %2) ELSE "content" END)").arg(LARGE_NOTE_SIZE).arg(NOTE_PREVIEW_SIZE);
+}
+
+QString isContentPrefixColumn()
+{
+    return QStringLiteral(R"(length("content") > %1)").arg(LARGE_NOTE_SIZE);
+}
+
+// List queries return pinned notes first, newest first within each group.
+// Pinned notes keep the order the user dragged them into, which depends on
+// whether we are in All Notes or in a folder, so that (short) prefix is
+// reordered here instead of in SQL where it would defeat the index.
+void sortPinnedNotesPrefix(QVector<NodeData> &nodeList, bool isInAllNotes)
+{
+    auto pinnedEnd = std::find_if(nodeList.begin(), nodeList.end(), [](const NodeData &node) { return !node.isPinnedNote(); });
+    std::stable_sort(nodeList.begin(), pinnedEnd, [isInAllNotes](const NodeData &lhs, const NodeData &rhs) {
+        if (isInAllNotes) {
+            return lhs.relativePosAN() < rhs.relativePosAN();
+        }
+        return lhs.relativePosition() < rhs.relativePosition();
+    });
+}
+} // namespace
+
 /*!
  * \brief DBManager::DBManager
  * \param parent
  */
-DBManager::DBManager(QObject *parent) : QObject(parent)
+DBManager::DBManager(QObject *parent)
+    : QObject(parent), m_nextNodeId{ INVALID_NODE_ID }, m_nodeIdBlockEnd{ INVALID_NODE_ID }, m_nextTagId{ INVALID_NODE_ID }, m_tagIdBlockEnd{ INVALID_NODE_ID },
+      m_scheduler{ new DBScheduler(this) },
+      m_journalCompactionTimer{ new QTimer(this) }
 {
     qRegisterMetaType<QList<NodeData *>>("QList<NodeData*>");
     qRegisterMetaType<QVector<NodeData>>("QVector<NodeData>");
     qRegisterMetaType<NodeTagTreeData>("NodeTagTreeData");
     qRegisterMetaType<QSet<int>>("QSet<int>");
     qRegisterMetaType<ListViewInfo>("ListViewInfo");
+    qRegisterMetaType<TagFilter>("TagFilter");
     qRegisterMetaType<FolderListType>("DBManager::FolderListType");
+    qRegisterMetaType<QVector<ContentDelta>>("QVector<ContentDelta>");
+    qRegisterMetaType<QVector<NoteHeading>>("QVector<NoteHeading>");
+    m_journalCompactionTimer->setSingleShot(true);
+    m_journalCompactionTimer->setInterval(JOURNAL_IDLE_COMPACT_MS);
+    connect(m_journalCompactionTimer, &QTimer::timeout, this, &DBManager::scheduleContentJournalCompaction);
 }
 
 /*!
@@ -42,10 +96,31 @@ void DBManager::open(const QString &path, bool doCreate)
         qDebug() << "Database: connection ok";
     }
 
+    // ids reserved from a previous database mean nothing in this one
+    m_nextNodeId = m_nodeIdBlockEnd = INVALID_NODE_ID;
+    m_nextTagId = m_tagIdBlockEnd = INVALID_NODE_ID;
     if (doCreate) {
         createTables();
     }
-    recalculateChildNotesCount();
+    createIndexes();
+    createContentJournal();
+    createNoteOutline();
+    loadFolderGraph();
+    loadTagIndex();
+    loadContentJournal();
+    scheduleRecalculateChildNotesCount();
+    emit nodeIdsReset();
+}
+
+/*!
+ * \brief DBManager::scheduler
+ * Runs work on this thread with coalescing and background priority,
+ * see DBScheduler
+ * \return
+ */
+DBScheduler *DBManager::scheduler() const
+{
+    return m_scheduler;
 }
 
 /*!
@@ -161,6 +236,80 @@ void DBManager::createTables()
     }
 }
 
+/*!
+ * \brief DBManager::createIndexes
+ * Indexes backing the ORDER BY of the note list queries. Created on every
+ * open so databases made by older versions get them too.
+ */
+void DBManager::createIndexes()
+{
+    QSqlQuery query(m_db);
+    QString folderListIndex = R"(CREATE INDEX IF NOT EXISTS "node_table_parent_order" ON "node_table" ()"
+                              R"(    "parent_id", "node_type", "is_pinned_note" DESC, "modification_date" DESC)"
+                              R"();)";
+    if (!query.exec(folderListIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    QString noteListIndex = R"(CREATE INDEX IF NOT EXISTS "node_table_type_order" ON "node_table" ()"
+                            R"(    "node_type", "is_pinned_note" DESC, "modification_date" DESC)"
+                            R"();)";
+    if (!query.exec(noteListIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    // the trash is listed by deletion date instead
+    QString trashListIndex = R"(CREATE INDEX IF NOT EXISTS "node_table_parent_deletion" ON "node_table" ()"
+                             R"(    "parent_id", "node_type", "deletion_date" DESC)"
+                             R"();)";
+    if (!query.exec(trashListIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::createContentJournal
+ * Edits of note content saved as deltas, see onNoteContentDeltasRequested().
+ * Created on every open so databases made by older versions get it too.
+ */
+void DBManager::createContentJournal()
+{
+    QSqlQuery query(m_db);
+    QString journalTable = R"(CREATE TABLE IF NOT EXISTS "content_journal" ()"
+                           R"(    "seq"	INTEGER PRIMARY KEY,)"
+                           R"(    "note_id"	INTEGER NOT NULL,)"
+                           R"(    "position"	INTEGER NOT NULL,)"
+                           R"(    "removed"	INTEGER NOT NULL,)"
+                           R"(    "inserted"	TEXT NOT NULL)"
+                           R"();)";
+    if (!query.exec(journalTable)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    QString journalIndex = R"(CREATE INDEX IF NOT EXISTS "content_journal_note" ON "content_journal" ("note_id", "seq");)";
+    if (!query.exec(journalIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::createNoteOutline
+ * The headings of each note, see getNoteOutline(). A row is only valid for
+ * the modification date it was made for.
+ */
+void DBManager::createNoteOutline()
+{
+    QSqlQuery query(m_db);
+    QString outlineTable = R"(CREATE TABLE IF NOT EXISTS "note_outline" ()"
+                           R"(    "note_id"	INTEGER PRIMARY KEY,)"
+                           R"(    "modification_date"	INTEGER NOT NULL,)"
+                           R"(    "headings"	BLOB NOT NULL)"
+                           R"();)";
+    if (!query.exec(outlineTable)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
 /*!
  * \brief DBManager::isNoteExist
  * \param note
@@ -195,7 +344,6 @@ QVector<NodeData> DBManager::getAllFolders()
                        R"("creation_date",)"
                        R"("modification_date",)"
                        R"("deletion_date",)"
-                       R"("content",)"
                        R"("node_type",)"
                        R"("parent_id",)"
                        R"("relative_position",)"
@@ -214,17 +362,13 @@ QVector<NodeData> DBManager::getAllFolders()
             node.setId(query.value(0).toInt());
             node.setFullTitle(query.value(1).toString());
             node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-            node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+            node.setLastModificationMSecs(query.value(3).toLongLong());
             node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-            node.setContent(query.value(5).toString());
-            node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
-            node.setParentId(query.value(7).toInt());
-            node.setRelativePosition(query.value(8).toInt());
-            node.setAbsolutePath(query.value(9).toString());
-            node.setChildNotesCount(query.value(10).toInt());
-            if (node.nodeType() == NodeData::Type::Note) {
-                node.setTagIds(getAllTagForNote(node.id()));
-            }
+            node.setNodeType(static_cast<NodeData::Type>(query.value(5).toInt()));
+            node.setParentId(query.value(6).toInt());
+            node.setRelativePosition(query.value(7).toInt());
+            node.setAbsolutePath(query.value(8).toString());
+            node.setChildNotesCount(query.value(9).toInt());
             nodeList.append(node);
         }
     } else {
@@ -234,6 +378,92 @@ QVector<NodeData> DBManager::getAllFolders()
     return nodeList;
 }
 
+/*!
+ * \brief DBManager::getCachedFolders
+ * All folders from the in-memory folder graph, in id order like getAllFolders()
+ * \return
+ */
+QVector<NodeData> DBManager::getCachedFolders() const
+{
+    QVector<NodeData> folders;
+    folders.reserve(m_folders.size());
+    for (const auto &folder : m_folders) {
+        folders.append(folder);
+    }
+    std::sort(folders.begin(), folders.end(), [](const NodeData &a, const NodeData &b) { return a.id() < b.id(); });
+    return folders;
+}
+
+/*!
+ * \brief DBManager::loadFolderGraph
+ * Rebuild the in-memory folder graph from the database
+ */
+void DBManager::loadFolderGraph()
+{
+    m_folders.clear();
+    m_folderChildren.clear();
+    const auto folders = getAllFolders();
+    for (const auto &folder : folders) {
+        cacheFolder(folder);
+    }
+}
+
+void DBManager::cacheFolder(const NodeData &folder)
+{
+    auto it = m_folders.find(folder.id());
+    if (it != m_folders.end()) {
+        m_folderChildren[it->parentId()].removeOne(folder.id());
+    }
+    NodeData cached = folder;
+    cached.setContent(QString());
+    m_folders.insert(folder.id(), cached);
+    if (folder.id() != ROOT_FOLDER_ID) {
+        m_folderChildren[folder.parentId()].append(folder.id());
+    }
+}
+
+/*!
+ * \brief DBManager::uncacheFolder
+ * Drop a folder and its whole subtree from the folder graph
+ * \param folderId
+ */
+void DBManager::uncacheFolder(int folderId)
+{
+    auto it = m_folders.find(folderId);
+    if (it == m_folders.end()) {
+        return;
+    }
+    m_folderChildren[it->parentId()].removeOne(folderId);
+    m_folders.erase(it);
+    const auto children = m_folderChildren.take(folderId);
+    for (const auto childId : children) {
+        uncacheFolder(childId);
+    }
+}
+
+void DBManager::updateCachedFolderPath(int folderId, const QString &oldPath, const QString &newPath)
+{
+    auto it = m_folders.find(folderId);
+    if (it == m_folders.end()) {
+        return;
+    }
+    auto path = it->absolutePath();
+    path.replace(path.indexOf(oldPath), oldPath.size(), newPath);
+    it->setAbsolutePath(path);
+    const auto children = m_folderChildren.value(folderId);
+    for (const auto childId : children) {
+        updateCachedFolderPath(childId, oldPath, newPath);
+    }
+}
+
+void DBManager::setCachedChildNotesCount(int folderId, int childNotesCount)
+{
+    auto it = m_folders.find(folderId);
+    if (it != m_folders.end()) {
+        it->setChildNotesCount(childNotesCount);
+    }
+}
+
 QVector<TagData> DBManager::getAllTagInfo()
 {
     QVector<TagData> tagList;
@@ -263,24 +493,122 @@ QVector<TagData> DBManager::getAllTagInfo()
 QSet<int> DBManager::getAllTagForNote(int noteId)
 {
     QSet<int> tagIds;
+    for (auto it = m_tagIndex.constBegin(); it != m_tagIndex.constEnd(); ++it) {
+        if (it->contains(noteId)) {
+            tagIds.insert(it.key());
+        }
+    }
+    return tagIds;
+}
+
+/*!
+ * \brief DBManager::loadTagIndex
+ * Rebuild the tag -> notes bitmaps from tag_relationship
+ */
+void DBManager::loadTagIndex()
+{
+    m_tagIndex.clear();
     QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT "tag_id" FROM tag_relationship WHERE node_id = :node_id;)")) {
+    if (!query.prepare(R"(SELECT "tag_id", "node_id" FROM tag_relationship;)")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    query.bindValue(":node_id", noteId);
-    bool status = query.exec();
-    if (status) {
+    if (query.exec()) {
         while (query.next()) {
-            tagIds.insert(query.value(0).toInt());
+            m_tagIndex[query.value(0).toInt()].add(query.value(1).toInt());
         }
     } else {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    return tagIds;
+}
+
+/*!
+ * \brief DBManager::notesMatchingTags
+ * Evaluate a tag selection against the tag index. With only exclusions all
+ * notes are the starting set. Trashed notes keep their tags but never match,
+ * in any mode, as they don't count for their tags either (see moveNode())
+ * \param filter
+ * \return
+ */
+NoteBitmap DBManager::notesMatchingTags(const TagFilter &filter)
+{
+    NoteBitmap result;
+    if (filter.tagIds.isEmpty()) {
+        if (filter.excludedTagIds.isEmpty()) {
+            return result;
+        }
+        QSqlQuery query(m_db);
+        if (!query.prepare(R"(SELECT "id" FROM node_table WHERE node_type = :node_type;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+        if (query.exec()) {
+            while (query.next()) {
+                result.add(query.value(0).toInt());
+            }
+        } else {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    }
+    bool matchAll = filter.mode == TagFilterMode::All;
+    bool first = true;
+    for (const auto tagId : filter.tagIds) {
+        auto const &notes = m_tagIndex.value(tagId);
+        if (first) {
+            result = notes;
+            first = false;
+        } else if (matchAll) {
+            result = result & notes;
+        } else {
+            result = result | notes;
+        }
+        if (matchAll && result.isEmpty()) {
+            return result;
+        }
+    }
+    for (const auto tagId : filter.excludedTagIds) {
+        if (result.isEmpty()) {
+            break;
+        }
+        result = result - m_tagIndex.value(tagId);
+    }
+    if (result.isEmpty()) {
+        return result;
+    }
+    NoteBitmap trashed;
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "id" FROM node_table WHERE parent_id = :parent_id AND node_type = :node_type;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":parent_id"), static_cast<int>(TRASH_FOLDER_ID));
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    if (query.exec()) {
+        while (query.next()) {
+            trashed.add(query.value(0).toInt());
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    return result - trashed;
 }
 
 int DBManager::addNode(const NodeData &node)
 {
+    return addNodeWithId(node, allocateNodeId());
+}
+
+/*!
+ * \brief DBManager::addNodeWithId
+ * Insert node under an id reserved beforehand, see reserveNodeIds()
+ * \param node
+ * \param nodeId
+ * \return
+ */
+int DBManager::addNodeWithId(const NodeData &node, int nodeId)
+{
+    if (nodeId == INVALID_NODE_ID) {
+        qDebug() << __FUNCTION__ << __LINE__ << "no id to insert the node with";
+        return INVALID_NODE_ID;
+    }
     QSqlQuery query(m_db);
     QString emptyStr;
 
@@ -313,7 +641,6 @@ int DBManager::addNode(const NodeData &node)
         }
         query.finish();
     }
-    int nodeId = nextAvailableNodeId();
     QString absolutePath;
     if (node.parentId() != -1) {
         absolutePath = getNodeAbsolutePath(node.parentId()).path();
@@ -351,16 +678,19 @@ int DBManager::addNode(const NodeData &node)
     }
     query.finish();
 
-    if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(":value", nodeId + 1);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
     if (node.nodeType() == NodeData::Type::Note) {
         increaseChildNotesCountFolder(node.parentId());
         increaseChildNotesCountFolder(ROOT_FOLDER_ID);
+    } else if (node.nodeType() == NodeData::Type::Folder) {
+        NodeData folder = node;
+        folder.setId(nodeId);
+        folder.setRelativePosition(relationalPosition);
+        folder.setAbsolutePath(absolutePath);
+        if (folder.lastModificationdateTime().isNull()) {
+            folder.setLastModificationMSecs(epochTimeDateLastModified);
+        }
+        cacheFolder(folder);
+        emit folderAdded(folder);
     }
     return nodeId;
 }
@@ -413,6 +743,9 @@ int DBManager::addNodePreComputed(const NodeData &node)
     }
 
     query.finish();
+    if (node.nodeType() == NodeData::Type::Folder) {
+        cacheFolder(node);
+    }
 
     return nodeId;
 }
@@ -461,21 +794,10 @@ void DBManager::recalculateChildNotesCount()
     }
     query.clear();
     QMap<int, QString> folderIds;
-    if (!query.prepare(R"(SELECT id, absolute_path )"
-                       R"(FROM node_table WHERE node_type=:node_type;)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(":node_type", static_cast<int>(NodeData::Type::Folder));
-    status = query.exec();
-    if (status) {
-        while (query.next()) {
-            auto id = query.value(0).toInt();
-            if (id != ROOT_FOLDER_ID) {
-                folderIds[id] = query.value(1).toString();
-            }
+    for (const auto &folder : std::as_const(m_folders)) {
+        if (folder.id() != ROOT_FOLDER_ID) {
+            folderIds[folder.id()] = folder.absolutePath();
         }
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     for (const auto &id : folderIds.keys()) {
         if (!query.prepare(R"(SELECT count(*) FROM node_table )"
@@ -503,11 +825,63 @@ void DBManager::recalculateChildNotesCount()
         if (!status) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
+        setCachedChildNotesCount(id, childNotesCount);
         emit childNotesCountUpdatedFolder(id, folderIds[id], childNotesCount);
     }
     recalculateChildNotesCountAllNotes();
 }
 
+/*!
+ * \brief DBManager::scheduleRecalculateChildNotesCount
+ * Background variant of recalculateChildNotesCount(). The stored counts are
+ * shown as they are and corrected a few tags and folders per chunk, so
+ * requests for the tree and the note list don't wait behind the recount
+ */
+void DBManager::scheduleRecalculateChildNotesCount()
+{
+    QVector<int> tagIds;
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT id FROM "tag_table")")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    if (query.exec()) {
+        while (query.next()) {
+            tagIds.append(query.value(0).toInt());
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    QVector<int> folderIds;
+    for (auto it = m_folders.constBegin(); it != m_folders.constEnd(); ++it) {
+        if (it.key() != ROOT_FOLDER_ID) {
+            folderIds.append(it.key());
+        }
+    }
+    std::sort(folderIds.begin(), folderIds.end());
+
+    int position = 0;
+    m_scheduler->postChunked([this, tagIds, folderIds, position]() mutable {
+        auto const total = tagIds.size() + folderIds.size();
+        auto const chunkEnd = std::min<qsizetype>(position + RECOUNT_CHUNK_SIZE, total);
+        for (; position < chunkEnd; ++position) {
+            if (position < tagIds.size()) {
+                recalculateChildNotesCountTag(tagIds[position]);
+            } else {
+                auto const folderId = folderIds[position - tagIds.size()];
+                // may have been deleted since the recount was scheduled
+                if (m_folders.contains(folderId)) {
+                    recalculateChildNotesCountFolder(folderId);
+                }
+            }
+        }
+        if (position < total) {
+            return true;
+        }
+        recalculateChildNotesCountAllNotes();
+        return false;
+    });
+}
+
 void DBManager::recalculateChildNotesCountFolder(int folderId)
 {
     QSqlQuery query(m_db);
@@ -536,6 +910,7 @@ void DBManager::recalculateChildNotesCountFolder(int folderId)
     if (!status) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
+    setCachedChildNotesCount(folderId, childNotesCount);
     emit childNotesCountUpdatedFolder(folderId, getNodeAbsolutePath(folderId).path(), childNotesCount);
 }
 
@@ -596,6 +971,7 @@ void DBManager::recalculateChildNotesCountAllNotes()
     if (!status) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
+    setCachedChildNotesCount(ROOT_FOLDER_ID, childNotesCount);
     emit childNotesCountUpdatedFolder(ROOT_FOLDER_ID, getNodeAbsolutePath(ROOT_FOLDER_ID).path(), childNotesCount);
 }
 
@@ -666,33 +1042,24 @@ void DBManager::decreaseChildNotesCountTag(int tagId)
 
 void DBManager::increaseChildNotesCountFolder(int folderId)
 {
-    QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT child_notes_count, absolute_path  FROM "node_table" WHERE id=:id)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(QStringLiteral(":id"), folderId);
-    bool status = query.exec();
-    int childNotesCount = 0;
-    QString absPath;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
-        absPath = query.value(1).toString();
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    auto it = m_folders.find(folderId);
+    if (it == m_folders.end()) {
+        qDebug() << __FUNCTION__ << __LINE__ << "folder not found" << folderId;
         return;
     }
-    query.clear();
+    int childNotesCount = it->childNotesCount();
+    QString absPath = it->absolutePath();
     childNotesCount += 1;
+    it->setChildNotesCount(childNotesCount);
 
+    QSqlQuery query(m_db);
     if (!query.prepare(QStringLiteral("UPDATE node_table SET child_notes_count = :child_notes_count "
                                       "WHERE id = :id"))) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.bindValue(QStringLiteral(":id"), folderId);
     query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     emit childNotesCountUpdatedFolder(folderId, absPath, childNotesCount);
@@ -700,34 +1067,25 @@ void DBManager::increaseChildNotesCountFolder(int folderId)
 
 void DBManager::decreaseChildNotesCountFolder(int folderId)
 {
-    QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT child_notes_count, absolute_path  FROM "node_table" WHERE id=:id)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(QStringLiteral(":id"), folderId);
-    bool status = query.exec();
-    int childNotesCount = 0;
-    QString absPath;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
-        absPath = query.value(1).toString();
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    auto it = m_folders.find(folderId);
+    if (it == m_folders.end()) {
+        qDebug() << __FUNCTION__ << __LINE__ << "folder not found" << folderId;
         return;
     }
-    query.clear();
+    int childNotesCount = it->childNotesCount();
+    QString absPath = it->absolutePath();
     childNotesCount -= 1;
     childNotesCount = std::max(childNotesCount, 0);
+    it->setChildNotesCount(childNotesCount);
 
+    QSqlQuery query(m_db);
     if (!query.prepare(QStringLiteral("UPDATE node_table SET child_notes_count = :child_notes_count "
                                       "WHERE id = :id"))) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.bindValue(QStringLiteral(":id"), folderId);
     query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     emit childNotesCountUpdatedFolder(folderId, absPath, childNotesCount);
@@ -752,7 +1110,11 @@ int DBManager::addTag(const TagData &tag)
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.finish();
-    int id = nextAvailableTagId();
+    int id = allocateTagId();
+    if (id == INVALID_NODE_ID) {
+        qDebug() << __FUNCTION__ << __LINE__ << "no id to insert the tag with";
+        return INVALID_NODE_ID;
+    }
 
     QString queryStr = R"(INSERT INTO "tag_table" )"
                        R"(("id","name","color","relative_position","child_notes_count") )"
@@ -770,13 +1132,6 @@ int DBManager::addTag(const TagData &tag)
     }
     query.finish();
 
-    if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_tag_id';)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(":value", id + 1);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
     auto newTag = tag;
     newTag.setId(id);
     emit tagAdded(newTag);
@@ -793,6 +1148,8 @@ void DBManager::addNoteToTag(int noteId, int tagId)
     query.bindValue(":tag_id", tagId);
     if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    } else {
+        m_tagIndex[tagId].add(noteId);
     }
     recalculateChildNotesCountTag(tagId);
 }
@@ -808,28 +1165,166 @@ void DBManager::removeNoteFromTag(int noteId, int tagId)
     query.bindValue(":tag_id", tagId);
     if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    } else {
+        m_tagIndex[tagId].remove(noteId);
     }
     decreaseChildNotesCountTag(tagId);
 }
 
-int DBManager::nextAvailableNodeId()
+/*!
+ * \brief DBManager::addTagToNotes
+ * Tags every note in \a noteIds inside a single transaction and refreshes the
+ * tag's note count once afterwards.
+ */
+void DBManager::addTagToNotes(int tagId, const QVector<int> &noteIds)
 {
+    if (noteIds.isEmpty()) {
+        return;
+    }
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
     QSqlQuery query(m_db);
-    if (!query.prepare("SELECT value FROM metadata WHERE key = :key")) {
+    if (!query.prepare(R"(INSERT OR IGNORE INTO "tag_relationship" ("node_id","tag_id") VALUES (:note_id, :tag_id);)")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    query.bindValue(":key", "next_node_id");
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    auto &taggedNotes = m_tagIndex[tagId];
+    for (const auto &noteId : noteIds) {
+        query.bindValue(":note_id", noteId);
+        query.bindValue(":tag_id", tagId);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        } else {
+            taggedNotes.add(noteId);
+        }
     }
-    query.last();
-    int nodeId = query.value(0).toInt();
-    return nodeId;
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    recalculateChildNotesCountTag(tagId);
 }
 
-int DBManager::nextAvailableTagId()
+/*!
+ * \brief DBManager::removeTagFromNotes
+ * Untags every note in \a noteIds with one statement and refreshes the tag's
+ * note count once afterwards.
+ */
+void DBManager::removeTagFromNotes(int tagId, const QVector<int> &noteIds)
 {
-    QSqlQuery query(m_db);
+    if (noteIds.isEmpty()) {
+        return;
+    }
+    QStringList idList;
+    idList.reserve(noteIds.size());
+    for (const auto &id : noteIds) {
+        idList.append(QString::number(id));
+    }
+    QSqlQuery query(m_db);
+    if (!query.prepare(QStringLiteral(R"(DELETE FROM "tag_relationship" )"
+                                      R"(WHERE tag_id = (:tag_id) AND node_id IN (%1);)")
+                               .arg(idList.join(QLatin1Char(','))))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(":tag_id", tagId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    } else {
+        auto &taggedNotes = m_tagIndex[tagId];
+        for (const auto &id : noteIds) {
+            taggedNotes.remove(id);
+        }
+    }
+    recalculateChildNotesCountTag(tagId);
+}
+
+/*!
+ * \brief DBManager::reserveIds
+ * Advance the metadata counter under key by count and return the first id of
+ * the range. The counter is written before any of the ids is used, so a crash
+ * only leaves a gap. The UPDATE takes the write lock before the counter is
+ * read back, so another connection can't be handed the same range
+ * \param key
+ * \param count
+ * \return the first reserved id, INVALID_NODE_ID on failure
+ */
+int DBManager::reserveIds(const QString &key, int count)
+{
+    QSqlQuery query(m_db);
+    // unlike BEGIN, a savepoint also nests inside a transaction of the caller
+    if (!query.exec(QStringLiteral("SAVEPOINT reserve_ids;"))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return INVALID_NODE_ID;
+    }
+    int firstId = INVALID_NODE_ID;
+    if (!query.prepare(R"(UPDATE "metadata" SET "value"="value"+:count WHERE "key"=:key;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(":count", count);
+    query.bindValue(":key", key);
+    if (query.exec()) {
+        if (!query.prepare(R"(SELECT "value" FROM "metadata" WHERE "key"=:key;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(":key", key);
+        if (query.exec() && query.next()) {
+            firstId = query.value(0).toInt() - count;
+        } else {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.finish();
+    if (firstId == INVALID_NODE_ID && !query.exec(QStringLiteral("ROLLBACK TO reserve_ids;"))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    if (!query.exec(QStringLiteral("RELEASE reserve_ids;"))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    return firstId;
+}
+
+/*!
+ * \brief DBManager::reserveNodeIds
+ * Reserve count node ids for the caller to hand out on its own. Notes
+ * created with them are stored by onCreateUpdateRequestedNoteContent()
+ * \param count
+ * \return the first reserved id, INVALID_NODE_ID on failure
+ */
+int DBManager::reserveNodeIds(int count)
+{
+    return reserveIds(QStringLiteral("next_node_id"), count);
+}
+
+int DBManager::allocateNodeId()
+{
+    if (m_nextNodeId == m_nodeIdBlockEnd) {
+        int firstId = reserveIds(QStringLiteral("next_node_id"), ID_BLOCK_SIZE);
+        if (firstId == INVALID_NODE_ID) {
+            return INVALID_NODE_ID;
+        }
+        m_nextNodeId = firstId;
+        m_nodeIdBlockEnd = firstId + ID_BLOCK_SIZE;
+    }
+    return m_nextNodeId++;
+}
+
+int DBManager::allocateTagId()
+{
+    if (m_nextTagId == m_tagIdBlockEnd) {
+        int firstId = reserveIds(QStringLiteral("next_tag_id"), ID_BLOCK_SIZE);
+        if (firstId == INVALID_NODE_ID) {
+            return INVALID_NODE_ID;
+        }
+        m_nextTagId = firstId;
+        m_tagIdBlockEnd = firstId + ID_BLOCK_SIZE;
+    }
+    return m_nextTagId++;
+}
+
+int DBManager::nextAvailableTagId()
+{
+    QSqlQuery query(m_db);
     if (!query.prepare("SELECT value FROM metadata WHERE key = :key")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
@@ -853,6 +1348,11 @@ void DBManager::renameNode(int id, const QString &newName)
     if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
+    auto it = m_folders.find(id);
+    if (it != m_folders.end()) {
+        it->setFullTitle(newName);
+    }
+    emit folderRenamed(id, newName);
 }
 
 void DBManager::renameTag(int id, const QString &newName)
@@ -910,6 +1410,28 @@ void DBManager::removeNote(const NodeData &note)
         if (!query.exec()) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
+        query.clear();
+        if (!query.prepare(R"(DELETE FROM "content_journal" )"
+                           R"(WHERE note_id = (:id);)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":id"), note.id());
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        m_contentJournal.remove(note.id());
+        query.clear();
+        if (!query.prepare(R"(DELETE FROM "note_outline" )"
+                           R"(WHERE note_id = (:id);)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":id"), note.id());
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        for (auto &taggedNotes : m_tagIndex) {
+            taggedNotes.remove(note.id());
+        }
         if (note.nodeType() == NodeData::Type::Note) {
             decreaseChildNotesCountFolder(TRASH_FOLDER_ID);
         }
@@ -939,6 +1461,7 @@ void DBManager::removeTag(int tagId)
     if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
+    m_tagIndex.remove(tagId);
     emit tagRemoved(tagId);
 }
 
@@ -963,6 +1486,12 @@ bool DBManager::updateNoteContent(const NodeData &note)
     QString fullTitle = note.fullTitle();
     fullTitle.replace(QChar('\x0'), emptyStr);
 
+    // the full content replaces the deltas saved before it
+    bool const hasJournal = m_contentJournal.value(id).pendingDeltas > 0;
+    if (hasJournal && !m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        return false;
+    }
     if (!query.prepare(QStringLiteral("UPDATE node_table SET modification_date = :modification_date, content = :content, "
                                       "title = :title, scrollbar_position = :scrollbar_position WHERE id = :id AND node_type "
                                       "= :node_type;"))) {
@@ -976,8 +1505,264 @@ bool DBManager::updateNoteContent(const NodeData &note)
     query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
     if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        if (hasJournal) {
+            m_db.rollback();
+        }
+        return false;
+    }
+    bool const isUpdated = query.numRowsAffected() == 1;
+    if (hasJournal) {
+        query.clear();
+        if (!query.prepare(R"(DELETE FROM "content_journal" WHERE note_id = :note_id;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":note_id"), id);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        if (!m_db.commit()) {
+            qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        }
+    }
+    if (isUpdated) {
+        // the deltas that follow are relative to this content
+        m_contentJournal.insert(id, ContentJournalState{ static_cast<int>(content.size()), 0, 0 });
+    }
+    return isUpdated;
+}
+
+/*!
+ * \brief DBManager::loadContentJournal
+ * Picks up the deltas a previous session left behind (e.g. it crashed before
+ * folding them in) and folds them into their notes in the background
+ */
+void DBManager::loadContentJournal()
+{
+    m_contentJournal.clear();
+    QSqlQuery query(m_db);
+    if (!query.exec(R"(SELECT "note_id", COUNT(*), SUM(LENGTH("inserted")) FROM "content_journal" GROUP BY "note_id";)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    while (query.next()) {
+        ContentJournalState state;
+        state.pendingDeltas = query.value(1).toInt();
+        state.pendingBytes = query.value(2).toLongLong() * 2;
+        m_contentJournal.insert(query.value(0).toInt(), state);
+    }
+    if (!m_contentJournal.isEmpty()) {
+        scheduleContentJournalCompaction();
+    }
+}
+
+/*!
+ * \brief DBManager::journaledContent
+ * The current content of a note: its stored content with the deltas of its
+ * journal applied in order
+ * \param noteId
+ * \param content the content column of the note
+ * \param isPrefix whether content is only the start of the content column.
+ * Deltas past its end are skipped and the result is cut to a preview
+ * \return
+ */
+QString DBManager::journaledContent(int noteId, QString content, bool isPrefix)
+{
+    auto it = m_contentJournal.constFind(noteId);
+    if (it == m_contentJournal.constEnd() || it->pendingDeltas == 0) {
+        return content;
+    }
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "position", "removed", "inserted" FROM "content_journal" WHERE note_id = :note_id ORDER BY seq;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":note_id"), noteId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return content;
     }
-    return (query.numRowsAffected() == 1);
+    while (query.next()) {
+        auto const position = query.value(0).toInt();
+        auto const removed = query.value(1).toInt();
+        if (isPrefix && position <= content.size() && position + removed > content.size()) {
+            // the rest of the prefix is unknown past the inserted text
+            content.truncate(position);
+            content.append(query.value(2).toString());
+            continue;
+        }
+        if (position < 0 || removed < 0 || position + removed > content.size()) {
+            if (!isPrefix) {
+                // onNoteContentDeltasRequested() never stores such a delta
+                qDebug() << __FUNCTION__ << __LINE__ << "Invalid delta for note" << noteId;
+            }
+            continue;
+        }
+        content.replace(position, removed, query.value(2).toString());
+    }
+    if (isPrefix) {
+        content.truncate(NOTE_PREVIEW_SIZE);
+    }
+    return content;
+}
+
+/*!
+ * \brief DBManager::contentLength
+ * \param noteId
+ * \return length of the current content of the note
+ */
+int DBManager::contentLength(int noteId)
+{
+    auto it = m_contentJournal.find(noteId);
+    if (it != m_contentJournal.end() && it->length >= 0) {
+        return it->length;
+    }
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "content" FROM node_table WHERE id = :id AND node_type = :node_type;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":id"), noteId);
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    if (!query.exec() || !query.next()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return -1;
+    }
+    auto const length = static_cast<int>(journaledContent(noteId, query.value(0).toString()).size());
+    m_contentJournal[noteId].length = length;
+    return length;
+}
+
+/*!
+ * \brief DBManager::notesWithJournal
+ * \return the notes whose content column misses some of their edits
+ */
+QSet<int> DBManager::notesWithJournal() const
+{
+    QSet<int> noteIds;
+    for (auto it = m_contentJournal.constBegin(); it != m_contentJournal.constEnd(); ++it) {
+        if (it->pendingDeltas > 0) {
+            noteIds.insert(it.key());
+        }
+    }
+    return noteIds;
+}
+
+/*!
+ * \brief DBManager::journaledContentContains
+ * Search match of a note whose content column isn't up to date, see notesWithJournal()
+ * \param noteId
+ * \param keyword
+ * \return
+ */
+bool DBManager::journaledContentContains(int noteId, const QString &keyword)
+{
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "content" FROM node_table WHERE id = :id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":id"), noteId);
+    if (!query.exec() || !query.next()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return false;
+    }
+    // LIKE in the search queries ignores case as well
+    return journaledContent(noteId, query.value(0).toString()).contains(keyword, Qt::CaseInsensitive);
+}
+
+/*!
+ * \brief DBManager::compactContentJournal
+ * Folds the deltas of the note into its content. Both happen in one
+ * transaction, so a crash leaves either the old content and its deltas or
+ * the new content alone.
+ * \param noteId
+ * \return
+ */
+bool DBManager::compactContentJournal(int noteId)
+{
+    auto it = m_contentJournal.find(noteId);
+    if (it == m_contentJournal.end() || it->pendingDeltas == 0) {
+        return true;
+    }
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        return false;
+    }
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "content" FROM node_table WHERE id = :id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":id"), noteId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        m_db.rollback();
+        return false;
+    }
+    if (query.next()) {
+        auto const content = journaledContent(noteId, query.value(0).toString());
+        query.clear();
+        if (!query.prepare(R"(UPDATE node_table SET content = :content WHERE id = :id;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":content"), content);
+        query.bindValue(QStringLiteral(":id"), noteId);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            m_db.rollback();
+            return false;
+        }
+        it->length = static_cast<int>(content.size());
+    }
+    // a note deleted meanwhile just loses its deltas
+    query.clear();
+    if (!query.prepare(R"(DELETE FROM "content_journal" WHERE note_id = :note_id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":note_id"), noteId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        m_db.rollback();
+        return false;
+    }
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        return false;
+    }
+    it->pendingDeltas = 0;
+    it->pendingBytes = 0;
+    return true;
+}
+
+/*!
+ * \brief DBManager::compactContentJournals
+ * Folds all deltas into their notes, for readers that only see the content
+ * column: copies of the database file
+ */
+void DBManager::compactContentJournals()
+{
+    for (auto it = m_contentJournal.constBegin(); it != m_contentJournal.constEnd(); ++it) {
+        if (it->pendingDeltas > 0) {
+            compactContentJournal(it.key());
+        }
+    }
+}
+
+/*!
+ * \brief DBManager::scheduleContentJournalCompaction
+ * Folds the deltas in as background work, one note per chunk
+ */
+void DBManager::scheduleContentJournalCompaction()
+{
+    m_scheduler->postChunked([this]() {
+        for (auto it = m_contentJournal.constBegin(); it != m_contentJournal.constEnd(); ++it) {
+            if (it->pendingDeltas > 0) {
+                // on failure the deltas stay readable, retry on the next idle period
+                if (!compactContentJournal(it.key())) {
+                    m_journalCompactionTimer->start();
+                    return false;
+                }
+                return true;
+            }
+        }
+        return false;
+    });
 }
 
 QList<NodeData> DBManager::readOldNBK(const QString &fileName)
@@ -1049,6 +1834,10 @@ int DBManager::nextAvailablePosition(int parentId, NodeData::Type nodeType)
 
 NodePath DBManager::getNodeAbsolutePath(int nodeId)
 {
+    auto it = m_folders.constFind(nodeId);
+    if (it != m_folders.constEnd()) {
+        return it->absolutePath();
+    }
     QSqlQuery query(m_db);
     if (!query.prepare("SELECT absolute_path FROM node_table WHERE id = :id")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
@@ -1065,6 +1854,10 @@ NodePath DBManager::getNodeAbsolutePath(int nodeId)
 
 NodeData DBManager::getNode(int nodeId)
 {
+    auto it = m_folders.constFind(nodeId);
+    if (it != m_folders.constEnd()) {
+        return *it;
+    }
     QSqlQuery query(m_db);
     if (!query.prepare(R"(SELECT)"
                        R"("id",)"
@@ -1092,32 +1885,20 @@ NodeData DBManager::getNode(int nodeId)
         node.setId(query.value(0).toInt());
         node.setFullTitle(query.value(1).toString());
         node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-        node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+        node.setLastModificationMSecs(query.value(3).toLongLong());
         node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-        node.setContent(query.value(5).toString());
+        node.setContent(journaledContent(node.id(), query.value(5).toString()));
         node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
         node.setParentId(query.value(7).toInt());
         node.setRelativePosition(query.value(8).toInt());
         node.setScrollBarPosition(query.value(9).toInt());
         node.setAbsolutePath(query.value(10).toString());
         node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-        node.setRelativePosAN(query.value(13).toInt());
-        node.setRelativePosAN(query.value(14).toInt());
+        node.setRelativePosAN(query.value(12).toInt());
+        node.setChildNotesCount(query.value(13).toInt());
         if (node.nodeType() == NodeData::Type::Note) {
             node.setTagIds(getAllTagForNote(node.id()));
-            QSqlQuery query2(m_db);
-            if (!query2.prepare(R"(SELECT)"
-                                R"("title" )"
-                                R"(FROM node_table WHERE id=:id LIMIT 1;)")) {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
-            query2.bindValue(":id", node.parentId());
-            if (query2.exec()) {
-                query2.next();
-                node.setParentName(query2.value(0).toString());
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << query2.lastError();
-            }
+            node.setParentName(m_folders.value(node.parentId()).fullTitle());
         }
         return node;
     }
@@ -1125,6 +1906,112 @@ NodeData DBManager::getNode(int nodeId)
     return NodeData();
 }
 
+/*!
+ * \brief DBManager::getNodes
+ * Folders come from the cache and notes from a single query, in the order of nodeIds.
+ * Ids that can't be found give an empty node, same as getNode()
+ * \param nodeIds
+ * \return
+ */
+QVector<NodeData> DBManager::getNodes(const QVector<int> &nodeIds)
+{
+    QVector<int> noteIds;
+    for (const auto id : nodeIds) {
+        if (!m_folders.contains(id)) {
+            noteIds.append(id);
+        }
+    }
+    QHash<int, NodeData> notes;
+    for (const auto &note : getNotesByIds(noteIds, false)) {
+        notes.insert(note.id(), note);
+    }
+    QVector<NodeData> nodes;
+    nodes.reserve(nodeIds.size());
+    for (const auto id : nodeIds) {
+        auto it = m_folders.constFind(id);
+        if (it != m_folders.constEnd()) {
+            nodes.append(*it);
+        } else {
+            nodes.append(notes.value(id));
+        }
+    }
+    return nodes;
+}
+
+/*!
+ * \brief DBManager::getNotesByIds
+ * Fetch the given notes in one query, newest first
+ * \param noteIds
+ * \param isPreview whether large notes only need the start of their content
+ * \return
+ */
+QVector<NodeData> DBManager::getNotesByIds(const QVector<int> &noteIds, bool isPreview)
+{
+    QVector<NodeData> nodeList;
+    if (noteIds.isEmpty()) {
+        return nodeList;
+    }
+    QStringList idList;
+    idList.reserve(noteIds.size());
+    for (const auto &id : noteIds) {
+        idList.append(QString::number(id));
+    }
+    QSqlQuery query(m_db);
+    // ids are integers, inlining them avoids SQLite's bound variable limit
+    if (!query.prepare(QStringLiteral(R"(SELECT )"
+                                      R"("id",)"
+                                      R"("title",)"
+                                      R"("creation_date",)"
+                                      R"("modification_date",)"
+                                      R"("deletion_date",)"
+                                      R"(%1,)"
+                                      R"("node_type",)"
+                                      R"("parent_id",)"
+                                      R"("relative_position", )"
+                                      R"("scrollbar_position",)"
+                                      R"("absolute_path", )"
+                                      R"("is_pinned_note", )"
+                                      R"("relative_position_an", )"
+                                      R"("child_notes_count", )"
+                                      R"(%2 )"
+                                      R"(FROM node_table )"
+                                      R"(WHERE node_type = (:node_type) AND id IN (%3) )"
+                                      R"(ORDER BY modification_date DESC;)")
+                               .arg(isPreview ? previewContentColumn() : QStringLiteral(R"("content")"),
+                                    isPreview ? isContentPrefixColumn() : QStringLiteral("0"), idList.join(QLatin1Char(','))))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    bool status = query.exec();
+    if (status) {
+        while (query.next()) {
+            NodeData node;
+            node.setId(query.value(0).toInt());
+            node.setFullTitle(query.value(1).toString());
+            node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
+            node.setLastModificationMSecs(query.value(3).toLongLong());
+            node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
+            auto const isContentPrefix = query.value(14).toBool();
+            node.setContent(journaledContent(node.id(), query.value(5).toString(), isContentPrefix));
+            node.setIsContentPrefix(isContentPrefix);
+            node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
+            node.setParentId(query.value(7).toInt());
+            node.setRelativePosition(query.value(8).toInt());
+            node.setScrollBarPosition(query.value(9).toInt());
+            node.setAbsolutePath(query.value(10).toString());
+            node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
+            node.setRelativePosAN(query.value(12).toInt());
+            node.setChildNotesCount(query.value(13).toInt());
+            node.setTagIds(getAllTagForNote(node.id()));
+            node.setParentName(m_folders.value(node.parentId()).fullTitle());
+            nodeList.append(node);
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    return nodeList;
+}
+
 void DBManager::moveFolderToTrash(const NodeData &node)
 {
     QSqlQuery query(m_db);
@@ -1170,23 +2057,17 @@ void DBManager::moveFolderToTrash(const NodeData &node)
     if (!status) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
+    uncacheFolder(node.id());
+    emit folderRemoved(node.id());
 }
 
 FolderListType DBManager::getFolderList()
 {
     QMap<int, QString> result;
-    QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT "id", "title" FROM node_table WHERE id > 0 AND node_type = :node_type;)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(":node_type", static_cast<int>(NodeData::Type::Folder));
-    bool status = query.exec();
-    if (status) {
-        while (query.next()) {
-            result[query.value(0).toInt()] = query.value(1).toString();
+    for (const auto &folder : std::as_const(m_folders)) {
+        if (folder.id() > ROOT_FOLDER_ID) {
+            result[folder.id()] = folder.fullTitle();
         }
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     return result;
 }
@@ -1271,7 +2152,12 @@ void DBManager::moveNode(int nodeId, const NodeData &target)
                 qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
             }
         }
+        auto cached = m_folders.value(nodeId, node);
+        cached.setParentId(target.id());
+        cacheFolder(cached);
+        updateCachedFolderPath(nodeId, oldAbsolutePath, newAbsolutePath);
         recalculateChildNotesCount();
+        emit folderMoved(nodeId, target.id());
     } else {
         decreaseChildNotesCountFolder(node.parentId());
         if (node.parentId() != TRASH_FOLDER_ID && target.id() == TRASH_FOLDER_ID) {
@@ -1280,40 +2166,186 @@ void DBManager::moveNode(int nodeId, const NodeData &target)
             for (const auto &tagId : std::as_const(allTagInNote)) {
                 decreaseChildNotesCountTag(tagId);
             }
-        } else if (node.parentId() == TRASH_FOLDER_ID && target.id() != TRASH_FOLDER_ID) {
-            increaseChildNotesCountFolder(ROOT_FOLDER_ID);
-            auto allTagInNote = getAllTagForNote(node.id());
-            for (const auto &tagId : std::as_const(allTagInNote)) {
-                increaseChildNotesCountTag(tagId);
+        } else if (node.parentId() == TRASH_FOLDER_ID && target.id() != TRASH_FOLDER_ID) {
+            increaseChildNotesCountFolder(ROOT_FOLDER_ID);
+            auto allTagInNote = getAllTagForNote(node.id());
+            for (const auto &tagId : std::as_const(allTagInNote)) {
+                increaseChildNotesCountTag(tagId);
+            }
+        }
+        increaseChildNotesCountFolder(target.id());
+    }
+}
+
+/*!
+ * \brief DBManager::moveNotes
+ * Moves a batch of notes into \a target in a single transaction, then updates
+ * the note counters once per affected folder and tag instead of once per note.
+ * Notes that already live in \a target are skipped.
+ */
+void DBManager::moveNotes(const QVector<int> &noteIds, const NodeData &target)
+{
+    if (target.nodeType() != NodeData::Type::Folder) {
+        qDebug() << "moveNotes target is not folder" << target.id();
+        return;
+    }
+    if (noteIds.isEmpty()) {
+        return;
+    }
+    QStringList idList;
+    idList.reserve(noteIds.size());
+    for (const auto &id : noteIds) {
+        idList.append(QString::number(id));
+    }
+    const QString inIds = idList.join(QLatin1Char(','));
+
+    QSqlQuery query(m_db);
+    QMap<int, int> oldParents;
+    if (!query.prepare(QStringLiteral(R"(SELECT id, parent_id FROM node_table )"
+                                      R"(WHERE node_type = (:node_type) AND id IN (%1);)")
+                               .arg(inIds))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    if (query.exec()) {
+        while (query.next()) {
+            auto parentId = query.value(1).toInt();
+            if (parentId != target.id()) {
+                oldParents[query.value(0).toInt()] = parentId;
+            }
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    if (oldParents.isEmpty()) {
+        return;
+    }
+
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    query.clear();
+    if (target.id() == TRASH_FOLDER_ID) {
+        if (!query.prepare(QStringLiteral("UPDATE node_table SET parent_id = :parent_id, absolute_path = :absolute_path, "
+                                          "is_pinned_note = :is_pinned_note, deletion_date = :deletion_date "
+                                          "WHERE id = :id;"))) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    } else {
+        if (!query.prepare(QStringLiteral("UPDATE node_table SET parent_id = :parent_id, absolute_path = :absolute_path "
+                                          "WHERE id = :id;"))) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    }
+    qint64 deletionTime = QDateTime::currentMSecsSinceEpoch();
+    QSet<int> affectedFolders{ target.id() };
+    QStringList trashCrossingIds;
+    for (auto it = oldParents.constBegin(); it != oldParents.constEnd(); ++it) {
+        query.bindValue(QStringLiteral(":parent_id"), target.id());
+        query.bindValue(QStringLiteral(":absolute_path"), QStringLiteral("%1%2%3").arg(target.absolutePath(), PATH_SEPARATOR).arg(it.key()));
+        if (target.id() == TRASH_FOLDER_ID) {
+            query.bindValue(QStringLiteral(":is_pinned_note"), false);
+            query.bindValue(QStringLiteral(":deletion_date"), deletionTime);
+        }
+        query.bindValue(QStringLiteral(":id"), it.key());
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError() << query.lastQuery();
+        }
+        affectedFolders.insert(it.value());
+        if ((it.value() == TRASH_FOLDER_ID) != (target.id() == TRASH_FOLDER_ID)) {
+            trashCrossingIds.append(QString::number(it.key()));
+        }
+    }
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+
+    for (const auto &folderId : std::as_const(affectedFolders)) {
+        recalculateChildNotesCountFolder(folderId);
+    }
+    if (!trashCrossingIds.isEmpty()) {
+        recalculateChildNotesCountAllNotes();
+        // tag counters only track notes outside the trash, so shift each tag
+        // by the number of its notes that crossed the trash boundary
+        QMap<int, int> tagDeltas;
+        query.clear();
+        if (!query.prepare(QStringLiteral(R"(SELECT tag_id, COUNT(*) FROM tag_relationship )"
+                                          R"(WHERE node_id IN (%1) GROUP BY tag_id;)")
+                                   .arg(trashCrossingIds.join(QLatin1Char(','))))) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        if (query.exec()) {
+            while (query.next()) {
+                tagDeltas[query.value(0).toInt()] = query.value(1).toInt();
+            }
+        } else {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        int sign = target.id() == TRASH_FOLDER_ID ? -1 : 1;
+        for (auto it = tagDeltas.constBegin(); it != tagDeltas.constEnd(); ++it) {
+            query.clear();
+            if (!query.prepare(QStringLiteral("UPDATE tag_table SET child_notes_count = MAX(child_notes_count + :delta, 0) "
+                                              "WHERE id = :id;"))) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            }
+            query.bindValue(QStringLiteral(":delta"), sign * it.value());
+            query.bindValue(QStringLiteral(":id"), it.key());
+            if (!query.exec()) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+                continue;
+            }
+            query.clear();
+            if (!query.prepare(R"(SELECT child_notes_count FROM "tag_table" WHERE id=:id)")) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            }
+            query.bindValue(QStringLiteral(":id"), it.key());
+            if (query.exec() && query.next()) {
+                emit childNotesCountUpdatedTag(it.key(), query.value(0).toInt());
+            } else {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
             }
         }
-        increaseChildNotesCountFolder(target.id());
     }
 }
 
 void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
 {
+    // the content column of notes with a journal is behind, the queries take
+    // them all and they are matched on their journaled content below
+    const auto journaledIds = notesWithJournal();
+    QString journaledCondition;
+    if (!journaledIds.isEmpty()) {
+        QStringList idList;
+        for (const auto id : journaledIds) {
+            idList.append(QString::number(id));
+        }
+        journaledCondition = QStringLiteral("OR id IN (%1)").arg(idList.join(QLatin1Char(',')));
+    }
     QVector<NodeData> nodeList;
     QSqlQuery query(m_db);
     if (!inf.isInTag && inf.parentFolderId == ROOT_FOLDER_ID) {
-        if (!query.prepare(R"(SELECT )"
-                           R"("id",)"
-                           R"("title",)"
-                           R"("creation_date",)"
-                           R"("modification_date",)"
-                           R"("deletion_date",)"
-                           R"("content",)"
-                           R"("node_type",)"
-                           R"("parent_id",)"
-                           R"("relative_position", )"
-                           R"("scrollbar_position",)"
-                           R"("absolute_path", )"
-                           R"("is_pinned_note", )"
-                           R"("relative_position_an", )"
-                           R"("child_notes_count" )"
-                           R"(FROM node_table )"
-                           R"(WHERE node_type = (:node_type) AND parent_id != (:parent_id) )"
-                           R"(AND content like  '%' || (:search_expr) || '%';)")) {
+        if (!query.prepare(QStringLiteral(R"(SELECT )"
+                                          R"("id",)"
+                                          R"("title",)"
+                                          R"("creation_date",)"
+                                          R"("modification_date",)"
+                                          R"("deletion_date",)"
+                                          R"(%1,)"
+                                          R"("node_type",)"
+                                          R"("parent_id",)"
+                                          R"("relative_position", )"
+                                          R"("scrollbar_position",)"
+                                          R"("absolute_path", )"
+                                          R"("is_pinned_note", )"
+                                          R"("relative_position_an", )"
+                                          R"("child_notes_count", )"
+                                          R"(%2 )"
+                                          R"(FROM node_table )"
+                                          R"(WHERE node_type = (:node_type) AND parent_id != (:parent_id) )"
+                                          R"(AND (content like  '%' || (:search_expr) || '%' %3) )"
+                                          R"(ORDER BY is_pinned_note DESC, modification_date DESC;)")
+                                   .arg(previewContentColumn(), isContentPrefixColumn(), journaledCondition))) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
         query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
@@ -1323,48 +2355,57 @@ void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
         bool status = query.exec();
         if (status) {
             while (query.next()) {
+                if (journaledIds.contains(query.value(0).toInt()) && !journaledContentContains(query.value(0).toInt(), keyword)) {
+                    continue;
+                }
                 NodeData node;
                 node.setId(query.value(0).toInt());
                 node.setFullTitle(query.value(1).toString());
                 node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-                node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+                node.setLastModificationMSecs(query.value(3).toLongLong());
                 node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
+                auto const isContentPrefix = query.value(14).toBool();
+                node.setContent(journaledContent(node.id(), query.value(5).toString(), isContentPrefix));
+                node.setIsContentPrefix(isContentPrefix);
                 node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
                 node.setParentId(query.value(7).toInt());
                 node.setRelativePosition(query.value(8).toInt());
                 node.setScrollBarPosition(query.value(9).toInt());
                 node.setAbsolutePath(query.value(10).toString());
                 node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-                node.setRelativePosAN(query.value(13).toInt());
-                node.setChildNotesCount(query.value(14).toInt());
+                node.setRelativePosAN(query.value(12).toInt());
+                node.setChildNotesCount(query.value(13).toInt());
                 node.setTagIds(getAllTagForNote(node.id()));
-                auto p = getNode(node.parentId());
-                node.setParentName(p.fullTitle());
+                node.setParentName(m_folders.value(node.parentId()).fullTitle());
                 nodeList.append(node);
             }
         } else {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
     } else if (!inf.isInTag) {
-        if (!query.prepare(R"(SELECT )"
-                           R"("id",)"
-                           R"("title",)"
-                           R"("creation_date",)"
-                           R"("modification_date",)"
-                           R"("deletion_date",)"
-                           R"("content",)"
-                           R"("node_type",)"
-                           R"("parent_id",)"
-                           R"("relative_position", )"
-                           R"("scrollbar_position",)"
-                           R"("absolute_path", )"
-                           R"("is_pinned_note", )"
-                           R"("relative_position_an", )"
-                           R"("child_notes_count" )"
-                           R"(FROM node_table )"
-                           R"(WHERE node_type = (:node_type) AND parent_id == (:parent_id) )"
-                           R"(AND content like  '%' || (:search_expr) || '%';)")) {
+        QString orderBy = inf.parentFolderId == TRASH_FOLDER_ID ? QStringLiteral("ORDER BY deletion_date DESC;")
+                                                                : QStringLiteral("ORDER BY is_pinned_note DESC, modification_date DESC;");
+        if (!query.prepare((QStringLiteral(R"(SELECT )"
+                                           R"("id",)"
+                                           R"("title",)"
+                                           R"("creation_date",)"
+                                           R"("modification_date",)"
+                                           R"("deletion_date",)"
+                                           R"(%1,)"
+                                           R"("node_type",)"
+                                           R"("parent_id",)"
+                                           R"("relative_position", )"
+                                           R"("scrollbar_position",)"
+                                           R"("absolute_path", )"
+                                           R"("is_pinned_note", )"
+                                           R"("relative_position_an", )"
+                                           R"("child_notes_count", )"
+                                           R"(%2 )"
+                                           R"(FROM node_table )"
+                                           R"(WHERE node_type = (:node_type) AND parent_id == (:parent_id) )"
+                                           R"(AND (content like  '%' || (:search_expr) || '%' %3) )")
+                            + orderBy)
+                                    .arg(previewContentColumn(), isContentPrefixColumn(), journaledCondition))) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
         query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
@@ -1374,92 +2415,118 @@ void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
         bool status = query.exec();
         if (status) {
             while (query.next()) {
+                if (journaledIds.contains(query.value(0).toInt()) && !journaledContentContains(query.value(0).toInt(), keyword)) {
+                    continue;
+                }
                 NodeData node;
                 node.setId(query.value(0).toInt());
                 node.setFullTitle(query.value(1).toString());
                 node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-                node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+                node.setLastModificationMSecs(query.value(3).toLongLong());
                 node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
+                auto const isContentPrefix = query.value(14).toBool();
+                node.setContent(journaledContent(node.id(), query.value(5).toString(), isContentPrefix));
+                node.setIsContentPrefix(isContentPrefix);
                 node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
                 node.setParentId(query.value(7).toInt());
                 node.setRelativePosition(query.value(8).toInt());
                 node.setScrollBarPosition(query.value(9).toInt());
                 node.setAbsolutePath(query.value(10).toString());
                 node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-                node.setRelativePosAN(query.value(13).toInt());
-                node.setChildNotesCount(query.value(14).toInt());
+                node.setRelativePosAN(query.value(12).toInt());
+                node.setChildNotesCount(query.value(13).toInt());
                 node.setTagIds(getAllTagForNote(node.id()));
-                auto p = getNode(node.parentId());
-                node.setParentName(p.fullTitle());
+                node.setParentName(m_folders.value(node.parentId()).fullTitle());
                 nodeList.append(node);
             }
         } else {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
     } else { // inf.isInTag == true
-        QVector<QSet<int>> nds;
-        for (const auto &tagId : inf.currentTagList) {
-            QSet<int> nd;
-            if (!query.prepare(R"(SELECT "node_id" FROM tag_relationship WHERE tag_id = :tag_id;)")) {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
-            query.bindValue(QStringLiteral(":tag_id"), tagId);
-            bool status = query.exec();
-            if (status) {
-                while (query.next()) {
-                    nd.insert(query.value(0).toInt());
-                }
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
-            nds.append(nd);
-        }
-        if (nds.empty()) {
+        if (inf.tagFilter.isEmpty()) {
             emit notesListReceived(nodeList, inf);
             return;
         }
-        QSet<int> noteIds;
-        int ndsId = 0;
-        for (int i = 1; i < nds.size(); ++i) {
-            if (nds[i].size() < nds[ndsId].size()) {
-                ndsId = i;
-            }
+        const auto noteIds = notesMatchingTags(inf.tagFilter).toVector();
+        QStringList noteIdList;
+        noteIdList.reserve(noteIds.size());
+        for (const auto id : noteIds) {
+            noteIdList.append(QString::number(id));
+        }
+        if (noteIdList.isEmpty()) {
+            // keeps the query valid, no note has this id
+            noteIdList.append(QString::number(INVALID_NODE_ID));
+        }
+        // ids are integers, inlining them avoids SQLite's bound variable limit
+        if (!query.prepare(QStringLiteral(R"(SELECT )"
+                                          R"("id",)"
+                                          R"("title",)"
+                                          R"("creation_date",)"
+                                          R"("modification_date",)"
+                                          R"("deletion_date",)"
+                                          R"(%1,)"
+                                          R"("node_type",)"
+                                          R"("parent_id",)"
+                                          R"("relative_position", )"
+                                          R"("scrollbar_position",)"
+                                          R"("absolute_path", )"
+                                          R"("is_pinned_note", )"
+                                          R"("relative_position_an", )"
+                                          R"("child_notes_count", )"
+                                          R"(%2 )"
+                                          R"(FROM node_table )"
+                                          R"(WHERE node_type = (:node_type) AND id IN (%4) )"
+                                          R"(AND (content like  '%' || (:search_expr) || '%' %3) )"
+                                          R"(ORDER BY modification_date DESC;)")
+                                   .arg(previewContentColumn(), isContentPrefixColumn(), journaledCondition, noteIdList.join(QLatin1Char(','))))) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
-        for (const int id : std::as_const(nds[ndsId])) {
-            bool ok = true;
-            for (int i = 0; i < nds.size(); ++i) {
-                if (i == ndsId) {
+        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+        query.bindValue(QStringLiteral(":search_expr"), keyword);
+
+        bool status = query.exec();
+        if (status) {
+            while (query.next()) {
+                if (journaledIds.contains(query.value(0).toInt()) && !journaledContentContains(query.value(0).toInt(), keyword)) {
                     continue;
                 }
-                if (!nds[i].contains(id)) {
-                    ok = false;
-                }
-            }
-            if (ok) {
-                noteIds.insert(id);
-            }
-        }
-        for (const auto &id : noteIds) {
-            NodeData node = getNode(id);
-            if (node.id() != INVALID_NODE_ID && node.nodeType() == NodeData::Type::Note && node.content().contains(keyword)) {
+                NodeData node;
+                node.setId(query.value(0).toInt());
+                node.setFullTitle(query.value(1).toString());
+                node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
+                node.setLastModificationMSecs(query.value(3).toLongLong());
+                node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
+                auto const isContentPrefix = query.value(14).toBool();
+                node.setContent(journaledContent(node.id(), query.value(5).toString(), isContentPrefix));
+                node.setIsContentPrefix(isContentPrefix);
+                node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
+                node.setParentId(query.value(7).toInt());
+                node.setRelativePosition(query.value(8).toInt());
+                node.setScrollBarPosition(query.value(9).toInt());
+                node.setAbsolutePath(query.value(10).toString());
+                node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
+                node.setRelativePosAN(query.value(12).toInt());
+                node.setChildNotesCount(query.value(13).toInt());
+                node.setTagIds(getAllTagForNote(node.id()));
+                node.setParentName(m_folders.value(node.parentId()).fullTitle());
                 nodeList.append(node);
-            } else {
-                qDebug() << __FUNCTION__ << "Note with id" << id << "is not valid";
             }
+        } else {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
     }
     ListViewInfo inf2 = inf;
     inf2.isInSearch = true;
-    std::sort(nodeList.begin(), nodeList.end(),
-              [](const NodeData &a, const NodeData &b) -> bool { return a.lastModificationdateTime() > b.lastModificationdateTime(); });
+    if (!inf.isInTag && inf.parentFolderId != TRASH_FOLDER_ID) {
+        sortPinnedNotesPrefix(nodeList, inf.parentFolderId == ROOT_FOLDER_ID);
+    }
     emit notesListReceived(nodeList, inf2);
 }
 
 void DBManager::clearSearch(const ListViewInfo &inf)
 {
     if (inf.isInTag) {
-        onNotesListInTagsRequested(inf.currentTagList, inf.needCreateNewNote, inf.scrollToId);
+        onNotesListInTagsRequested(inf.tagFilter, inf.needCreateNewNote, inf.scrollToId);
     } else {
         if (inf.parentFolderId == ROOT_FOLDER_ID) {
             onNotesListInFolderRequested(inf.parentFolderId, true, inf.needCreateNewNote, inf.scrollToId);
@@ -1482,6 +2549,10 @@ void DBManager::updateRelPosNode(int nodeId, int relPos)
     if (!status) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
+    auto it = m_folders.find(nodeId);
+    if (it != m_folders.end()) {
+        it->setRelativePosition(relPos);
+    }
 }
 
 void DBManager::updateRelPosTag(int tagId, int relPos)
@@ -1552,30 +2623,42 @@ NodeData DBManager::getChildNotesCountFolder(int folderId)
     NodeData d;
     d.setNodeType(NodeData::Type::Folder);
     d.setId(folderId);
-    QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT child_notes_count, absolute_path  FROM "node_table" WHERE id=:id)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    auto it = m_folders.constFind(folderId);
+    if (it != m_folders.constEnd()) {
+        d.setChildNotesCount(it->childNotesCount());
+        d.setAbsolutePath(it->absolutePath());
     }
-    query.bindValue(QStringLiteral(":id"), folderId);
-    bool status = query.exec();
-    int childNotesCount = 0;
-    QString absPath;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
-        absPath = query.value(1).toString();
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    return d;
+}
+
+/*!
+ * \brief DBManager::getChildFolders
+ * Direct child folders of \a parentId, marking the ones that have children of their own
+ * \param parentId
+ * \return
+ */
+NodeTagTreeData DBManager::getChildFolders(int parentId)
+{
+    NodeTagTreeData d;
+    const auto childIds = m_folderChildren.value(parentId);
+    d.nodeTreeData.reserve(childIds.size());
+    for (const auto id : childIds) {
+        auto it = m_folders.constFind(id);
+        if (it == m_folders.constEnd()) {
+            continue;
+        }
+        d.nodeTreeData.append(*it);
+        if (!m_folderChildren.value(id).isEmpty()) {
+            d.lazyParentIds.insert(id);
+        }
     }
-    d.setChildNotesCount(childNotesCount);
-    d.setAbsolutePath(absPath);
     return d;
 }
 
 void DBManager::onNodeTagTreeRequested()
 {
-    NodeTagTreeData d;
-    d.nodeTreeData = getAllFolders();
+    // only the top level is sent, deeper folders are fetched as they get expanded
+    NodeTagTreeData d = getChildFolders(ROOT_FOLDER_ID);
     d.tagTreeData = getAllTagInfo();
     emit nodesTagTreeReceived(d);
 }
@@ -1588,23 +2671,26 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
     QVector<NodeData> nodeList;
     QSqlQuery query(m_db);
     if (parentID == ROOT_FOLDER_ID) {
-        if (!query.prepare(R"(SELECT )"
-                           R"("id",)"
-                           R"("title",)"
-                           R"("creation_date",)"
-                           R"("modification_date",)"
-                           R"("deletion_date",)"
-                           R"("content",)"
-                           R"("node_type",)"
-                           R"("parent_id",)"
-                           R"("relative_position",)"
-                           R"("scrollbar_position",)"
-                           R"("absolute_path", )"
-                           R"("is_pinned_note", )"
-                           R"("relative_position_an", )"
-                           R"("child_notes_count" )"
-                           R"(FROM node_table )"
-                           R"(WHERE node_type = (:node_type) AND parent_id != (:parent_id);)")) {
+        if (!query.prepare(QStringLiteral(R"(SELECT )"
+                                          R"("id",)"
+                                          R"("title",)"
+                                          R"("creation_date",)"
+                                          R"("modification_date",)"
+                                          R"("deletion_date",)"
+                                          R"(%1,)"
+                                          R"("node_type",)"
+                                          R"("parent_id",)"
+                                          R"("relative_position",)"
+                                          R"("scrollbar_position",)"
+                                          R"("absolute_path", )"
+                                          R"("is_pinned_note", )"
+                                          R"("relative_position_an", )"
+                                          R"("child_notes_count", )"
+                                          R"(%2 )"
+                                          R"(FROM node_table )"
+                                          R"(WHERE node_type = (:node_type) AND parent_id != (:parent_id) )"
+                                          R"(ORDER BY is_pinned_note DESC, modification_date DESC;)")
+                                   .arg(previewContentColumn(), isContentPrefixColumn()))) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
         query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
@@ -1617,43 +2703,49 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
                 node.setId(query.value(0).toInt());
                 node.setFullTitle(query.value(1).toString());
                 node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-                node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+                node.setLastModificationMSecs(query.value(3).toLongLong());
                 node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
+                auto const isContentPrefix = query.value(14).toBool();
+                node.setContent(journaledContent(node.id(), query.value(5).toString(), isContentPrefix));
+                node.setIsContentPrefix(isContentPrefix);
                 node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
                 node.setParentId(query.value(7).toInt());
                 node.setRelativePosition(query.value(8).toInt());
                 node.setScrollBarPosition(query.value(9).toInt());
                 node.setAbsolutePath(query.value(10).toString());
                 node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-                node.setRelativePosAN(query.value(13).toInt());
-                node.setChildNotesCount(query.value(14).toInt());
+                node.setRelativePosAN(query.value(12).toInt());
+                node.setChildNotesCount(query.value(13).toInt());
                 node.setTagIds(getAllTagForNote(node.id()));
-                auto p = getNode(node.parentId());
-                node.setParentName(p.fullTitle());
+                node.setParentName(m_folders.value(node.parentId()).fullTitle());
                 nodeList.append(node);
             }
         } else {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
     } else if (!isRecursive) {
-        if (!query.prepare(R"(SELECT )"
-                           R"("id",)"
-                           R"("title",)"
-                           R"("creation_date",)"
-                           R"("modification_date",)"
-                           R"("deletion_date",)"
-                           R"("content",)"
-                           R"("node_type",)"
-                           R"("parent_id",)"
-                           R"("relative_position", )"
-                           R"("scrollbar_position",)"
-                           R"("absolute_path", )"
-                           R"("is_pinned_note", )"
-                           R"("relative_position_an", )"
-                           R"("child_notes_count" )"
-                           R"(FROM node_table )"
-                           R"(WHERE parent_id = (:parent_id) AND node_type = (:node_type);)")) {
+        QString orderBy = parentID == TRASH_FOLDER_ID ? QStringLiteral("ORDER BY deletion_date DESC;")
+                                                      : QStringLiteral("ORDER BY is_pinned_note DESC, modification_date DESC;");
+        if (!query.prepare((QStringLiteral(R"(SELECT )"
+                                           R"("id",)"
+                                           R"("title",)"
+                                           R"("creation_date",)"
+                                           R"("modification_date",)"
+                                           R"("deletion_date",)"
+                                           R"(%1,)"
+                                           R"("node_type",)"
+                                           R"("parent_id",)"
+                                           R"("relative_position", )"
+                                           R"("scrollbar_position",)"
+                                           R"("absolute_path", )"
+                                           R"("is_pinned_note", )"
+                                           R"("relative_position_an", )"
+                                           R"("child_notes_count", )"
+                                           R"(%2 )"
+                                           R"(FROM node_table )"
+                                           R"(WHERE parent_id = (:parent_id) AND node_type = (:node_type) )")
+                            + orderBy)
+                                    .arg(previewContentColumn(), isContentPrefixColumn()))) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
         query.bindValue(QStringLiteral(":parent_id"), parentID);
@@ -1665,17 +2757,19 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
                 node.setId(query.value(0).toInt());
                 node.setFullTitle(query.value(1).toString());
                 node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-                node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+                node.setLastModificationMSecs(query.value(3).toLongLong());
                 node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
+                auto const isContentPrefix = query.value(14).toBool();
+                node.setContent(journaledContent(node.id(), query.value(5).toString(), isContentPrefix));
+                node.setIsContentPrefix(isContentPrefix);
                 node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
                 node.setParentId(query.value(7).toInt());
                 node.setRelativePosition(query.value(8).toInt());
                 node.setScrollBarPosition(query.value(9).toInt());
                 node.setAbsolutePath(query.value(10).toString());
                 node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-                node.setRelativePosAN(query.value(13).toInt());
-                node.setChildNotesCount(query.value(14).toInt());
+                node.setRelativePosAN(query.value(12).toInt());
+                node.setChildNotesCount(query.value(13).toInt());
                 node.setTagIds(getAllTagForNote(node.id()));
                 nodeList.append(node);
             }
@@ -1684,23 +2778,26 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
         }
     } else {
         auto parentPath = getNodeAbsolutePath(parentID).path() + PATH_SEPARATOR;
-        if (!query.prepare(R"(SELECT )"
-                           R"("id",)"
-                           R"("title",)"
-                           R"("creation_date",)"
-                           R"("modification_date",)"
-                           R"("deletion_date",)"
-                           R"("content",)"
-                           R"("node_type",)"
-                           R"("parent_id",)"
-                           R"("relative_position", )"
-                           R"("scrollbar_position",)"
-                           R"("absolute_path", )"
-                           R"("is_pinned_note", )"
-                           R"("relative_position_an", )"
-                           R"("child_notes_count" )"
-                           R"(FROM node_table )"
-                           R"(WHERE absolute_path like (:path_expr) || '%' AND node_type = (:node_type);)")) {
+        if (!query.prepare(QStringLiteral(R"(SELECT )"
+                                          R"("id",)"
+                                          R"("title",)"
+                                          R"("creation_date",)"
+                                          R"("modification_date",)"
+                                          R"("deletion_date",)"
+                                          R"(%1,)"
+                                          R"("node_type",)"
+                                          R"("parent_id",)"
+                                          R"("relative_position", )"
+                                          R"("scrollbar_position",)"
+                                          R"("absolute_path", )"
+                                          R"("is_pinned_note", )"
+                                          R"("relative_position_an", )"
+                                          R"("child_notes_count", )"
+                                          R"(%2 )"
+                                          R"(FROM node_table )"
+                                          R"(WHERE absolute_path like (:path_expr) || '%' AND node_type = (:node_type) )"
+                                          R"(ORDER BY is_pinned_note DESC, modification_date DESC;)")
+                                   .arg(previewContentColumn(), isContentPrefixColumn()))) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
         query.bindValue(QStringLiteral(":path_expr"), parentPath);
@@ -1713,17 +2810,19 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
                 node.setId(query.value(0).toInt());
                 node.setFullTitle(query.value(1).toString());
                 node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-                node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+                node.setLastModificationMSecs(query.value(3).toLongLong());
                 node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
+                auto const isContentPrefix = query.value(14).toBool();
+                node.setContent(journaledContent(node.id(), query.value(5).toString(), isContentPrefix));
+                node.setIsContentPrefix(isContentPrefix);
                 node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
                 node.setParentId(query.value(7).toInt());
                 node.setRelativePosition(query.value(8).toInt());
                 node.setScrollBarPosition(query.value(9).toInt());
                 node.setAbsolutePath(query.value(10).toString());
                 node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-                node.setRelativePosAN(query.value(13).toInt());
-                node.setChildNotesCount(query.value(14).toInt());
+                node.setRelativePosAN(query.value(12).toInt());
+                node.setChildNotesCount(query.value(13).toInt());
                 node.setTagIds(getAllTagForNote(node.id()));
                 nodeList.append(node);
             }
@@ -1738,74 +2837,27 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
     inf.currentNotesId = { INVALID_NODE_ID };
     inf.needCreateNewNote = newNote;
     inf.scrollToId = scrollToId;
-    std::sort(nodeList.begin(), nodeList.end(),
-              [](const NodeData &a, const NodeData &b) -> bool { return a.lastModificationdateTime() > b.lastModificationdateTime(); });
+    if (parentID != TRASH_FOLDER_ID) {
+        sortPinnedNotesPrefix(nodeList, parentID == ROOT_FOLDER_ID);
+    }
     emit notesListReceived(nodeList, inf);
 }
 
-void DBManager::onNotesListInTagsRequested(const QSet<int> &tagIds, bool newNote, int scrollToId)
+void DBManager::onNotesListInTagsRequested(const TagFilter &filter, bool newNote, int scrollToId)
 {
     QVector<NodeData> nodeList;
-    QVector<QSet<int>> nds;
     ListViewInfo inf;
     inf.isInSearch = false;
     inf.isInTag = true;
-    inf.currentTagList = tagIds;
+    inf.tagFilter = filter;
     inf.currentNotesId = { INVALID_NODE_ID };
     inf.needCreateNewNote = newNote;
     inf.scrollToId = scrollToId;
-    for (const auto &tagId : tagIds) {
-        QSet<int> nd;
-        QSqlQuery query(m_db);
-        if (!query.prepare(R"(SELECT "node_id" FROM tag_relationship WHERE tag_id = :tag_id;)")) {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
-        query.bindValue(QStringLiteral(":tag_id"), tagId);
-        bool status = query.exec();
-        if (status) {
-            while (query.next()) {
-                nd.insert(query.value(0).toInt());
-            }
-        } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
-        nds.append(nd);
-    }
-    if (nds.empty()) {
+    if (filter.isEmpty()) {
         emit notesListReceived(nodeList, inf);
         return;
     }
-    QSet<int> noteIds;
-    int ndsId = 0;
-    for (int i = 1; i < nds.size(); ++i) {
-        if (nds[i].size() < nds[ndsId].size()) {
-            ndsId = i;
-        }
-    }
-    for (const int id : std::as_const(nds[ndsId])) {
-        bool ok = true;
-        for (int i = 0; i < nds.size(); ++i) {
-            if (i == ndsId) {
-                continue;
-            }
-            if (!nds[i].contains(id)) {
-                ok = false;
-            }
-        }
-        if (ok) {
-            noteIds.insert(id);
-        }
-    }
-    for (const auto &id : noteIds) {
-        NodeData node = getNode(id);
-        if (node.id() != INVALID_NODE_ID && node.nodeType() == NodeData::Type::Note) {
-            nodeList.append(node);
-        } else {
-            qDebug() << __FUNCTION__ << "Note with id" << id << "is not valid";
-        }
-    }
-    std::sort(nodeList.begin(), nodeList.end(),
-              [](const NodeData &a, const NodeData &b) -> bool { return a.lastModificationdateTime() > b.lastModificationdateTime(); });
+    nodeList = getNotesByIds(notesMatchingTags(filter).toVector(), true);
     emit notesListReceived(nodeList, inf);
 }
 
@@ -1833,11 +2885,193 @@ void DBManager::onCreateUpdateRequestedNoteContent(const NodeData &note)
 
     if (exists) {
         updateNoteContent(note);
+    } else if (note.id() != INVALID_NODE_ID) {
+        // new notes from the GUI carry an id from reserveNodeIds()
+        addNodeWithId(note, note.id());
     } else {
         addNode(note);
     }
 }
 
+/*!
+ * \brief DBManager::onNoteContentDeltasRequested
+ * Saves the edits of a note as deltas appended to content_journal instead of
+ * rewriting its whole content. The deltas and the note's metadata are written
+ * in one transaction, so a crash loses at most the deltas of this call.
+ * Deltas that don't fit the stored content are refused with
+ * noteContentOutOfSync(), after which the editor saves the full content.
+ * \param note the metadata (title, dates, scrollbar position) to store
+ * \param deltas in the order they were made
+ * \param baseLength length of the content the first delta applies to
+ */
+void DBManager::onNoteContentDeltasRequested(const NodeData &note, const QVector<ContentDelta> &deltas, int baseLength)
+{
+    auto const id = note.id();
+    if (id == INVALID_NODE_ID || note.nodeType() != NodeData::Type::Note) {
+        qDebug() << "Invalid Note ID";
+        return;
+    }
+    auto length = contentLength(id);
+    if (length != baseLength) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Note" << id << "has" << length << "characters, the deltas expect" << baseLength;
+        emit noteContentOutOfSync(note);
+        return;
+    }
+    qsizetype bytes = 0;
+    for (const auto &delta : deltas) {
+        // content is stored without NUL characters, which would shift the positions
+        if (delta.position < 0 || delta.removed < 0 || delta.position + delta.removed > length || delta.inserted.contains(QChar('\x0'))) {
+            qDebug() << __FUNCTION__ << __LINE__ << "Delta doesn't fit note" << id;
+            emit noteContentOutOfSync(note);
+            return;
+        }
+        length += static_cast<int>(delta.inserted.size()) - delta.removed;
+        bytes += delta.inserted.size() * 2;
+    }
+
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        return;
+    }
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(INSERT INTO "content_journal" ("note_id", "position", "removed", "inserted") )"
+                       R"(VALUES (:note_id, :position, :removed, :inserted);)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    for (const auto &delta : deltas) {
+        query.bindValue(QStringLiteral(":note_id"), id);
+        query.bindValue(QStringLiteral(":position"), delta.position);
+        query.bindValue(QStringLiteral(":removed"), delta.removed);
+        query.bindValue(QStringLiteral(":inserted"), delta.inserted);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            m_db.rollback();
+            return;
+        }
+    }
+    query.clear();
+    QString fullTitle = note.fullTitle();
+    fullTitle.replace(QChar('\x0'), QString());
+    if (!query.prepare(QStringLiteral("UPDATE node_table SET modification_date = :modification_date, title = :title, "
+                                      "scrollbar_position = :scrollbar_position WHERE id = :id AND node_type = :node_type;"))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":modification_date"), note.lastModificationdateTime().toMSecsSinceEpoch());
+    query.bindValue(QStringLiteral(":title"), fullTitle);
+    query.bindValue(QStringLiteral(":scrollbar_position"), note.scrollBarPosition());
+    query.bindValue(QStringLiteral(":id"), id);
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        m_db.rollback();
+        return;
+    }
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        m_db.rollback();
+        return;
+    }
+
+    auto &state = m_contentJournal[id];
+    state.length = length;
+    state.pendingDeltas += deltas.size();
+    state.pendingBytes += bytes;
+    if (state.pendingDeltas >= JOURNAL_COMPACT_DELTAS || state.pendingBytes >= JOURNAL_COMPACT_BYTES) {
+        compactContentJournal(id);
+    } else {
+        m_journalCompactionTimer->start();
+    }
+}
+
+/*!
+ * \brief DBManager::updateNoteScrollBarPosition
+ * Stores where the note was scrolled to, leaving its content and
+ * modification date alone
+ * \param noteId
+ * \param scrollBarPosition
+ */
+void DBManager::updateNoteScrollBarPosition(int noteId, int scrollBarPosition)
+{
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(UPDATE node_table SET scrollbar_position = :scrollbar_position WHERE id = :id AND node_type = :node_type;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":scrollbar_position"), scrollBarPosition);
+    query.bindValue(QStringLiteral(":id"), noteId);
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::updateNoteOutline
+ * Stores the headings the editor found in the note, as of its modification date
+ * \param note
+ * \param outline
+ */
+void DBManager::updateNoteOutline(const NodeData &note, const QVector<NoteHeading> &outline)
+{
+    QByteArray headings;
+    QDataStream stream(&headings, QIODevice::WriteOnly);
+    stream << outline;
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(INSERT OR REPLACE INTO "note_outline" ("note_id", "modification_date", "headings") )"
+                       R"(VALUES (:note_id, :modification_date, :headings);)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":note_id"), note.id());
+    query.bindValue(QStringLiteral(":modification_date"), note.lastModificationdateTime().toMSecsSinceEpoch());
+    query.bindValue(QStringLiteral(":headings"), headings);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::getNoteOutline
+ * The headings of a note without opening it. They are stored by the editor;
+ * a note it didn't save since it was last changed gets them from its content.
+ * \param noteId
+ * \return
+ */
+QVector<NoteHeading> DBManager::getNoteOutline(int noteId)
+{
+    QVector<NoteHeading> outline;
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT n.modification_date, o.modification_date, o.headings FROM node_table n )"
+                       R"(LEFT JOIN note_outline o ON o.note_id = n.id WHERE n.id = :id AND n.node_type = :node_type;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":id"), noteId);
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    if (!query.exec() || !query.next()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return outline;
+    }
+    if (!query.value(1).isNull() && query.value(1).toLongLong() == query.value(0).toLongLong()) {
+        auto const headings = query.value(2).toByteArray();
+        QDataStream stream(headings);
+        stream >> outline;
+        return outline;
+    }
+    NodeData note;
+    note.setId(noteId);
+    note.setLastModificationMSecs(query.value(0).toLongLong());
+    query.clear();
+    if (!query.prepare(R"(SELECT "content" FROM node_table WHERE id = :id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":id"), noteId);
+    if (!query.exec() || !query.next()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return outline;
+    }
+    outline = note_outline::outline(journaledContent(noteId, query.value(0).toString()));
+    updateNoteOutline(note, outline);
+    return outline;
+}
+
 /*!
  * \brief DBManager::onImportNotesRequested
  * \param noteList
@@ -1936,7 +3170,7 @@ void DBManager::onImportNotesRequested(const QString &fileName)
                     node.setId(outQuery.value(0).toInt());
                     node.setFullTitle(outQuery.value(1).toString());
                     node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(2).toLongLong()));
-                    node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(3).toLongLong()));
+                    node.setLastModificationMSecs(outQuery.value(3).toLongLong());
                     node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(4).toLongLong()));
                     node.setContent(outQuery.value(5).toString());
                     node.setNodeType(static_cast<NodeData::Type>(outQuery.value(6).toInt()));
@@ -2071,7 +3305,7 @@ void DBManager::onImportNotesRequested(const QString &fileName)
                     node.setId(outQuery.value(0).toInt());
                     node.setFullTitle(outQuery.value(1).toString());
                     node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(2).toLongLong()));
-                    node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(3).toLongLong()));
+                    node.setLastModificationMSecs(outQuery.value(3).toLongLong());
                     node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(4).toLongLong()));
                     node.setContent(outQuery.value(5).toString());
                     node.setNodeType(static_cast<NodeData::Type>(outQuery.value(6).toInt()));
@@ -2080,15 +3314,18 @@ void DBManager::onImportNotesRequested(const QString &fileName)
                     node.setScrollBarPosition(outQuery.value(9).toInt());
                     node.setAbsolutePath(outQuery.value(10).toString());
                     node.setIsPinnedNote(static_cast<bool>(outQuery.value(11).toInt()));
-                    node.setRelativePosAN(outQuery.value(13).toInt());
-                    node.setChildNotesCount(outQuery.value(14).toInt());
+                    node.setRelativePosAN(outQuery.value(12).toInt());
                     node.setTagIds(getAllTagForNote(node.id()));
                     nodeList.append(node);
                 }
                 if (!m_db.transaction()) {
                     qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
                 }
-                auto nodeId = nextAvailableNodeId();
+                auto nodeId = reserveNodeIds(nodeList.size());
+                if (nodeId == INVALID_NODE_ID) {
+                    qDebug() << __FUNCTION__ << __LINE__ << "can't reserve ids for the imported notes";
+                    nodeList.clear();
+                }
                 for (auto node : std::as_const(nodeList)) {
                     if (folderIdMap.contains(node.parentId()) && parents.contains(folderIdMap[node.parentId()])) {
                         auto parentId = folderIdMap[node.parentId()];
@@ -2106,14 +3343,6 @@ void DBManager::onImportNotesRequested(const QString &fileName)
                         qDebug() << __FUNCTION__ << __LINE__ << "can't find parent for note";
                     }
                 }
-                QSqlQuery query(m_db);
-                if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
-                    qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                }
-                query.bindValue(":value", nodeId + 1);
-                if (!query.exec()) {
-                    qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                }
                 if (!m_db.commit()) {
                     qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
                 }
@@ -2159,7 +3388,11 @@ void DBManager::onImportNotesRequested(const QString &fileName)
             emit showErrorMessage(tr("Invalid file"), "Please select a valid notes export file");
         } else {
             auto defaultNoteFolder = getNode(DEFAULT_NOTES_FOLDER_ID);
-            int nodeId = nextAvailableNodeId();
+            int nodeId = reserveNodeIds(noteList.size());
+            if (nodeId == INVALID_NODE_ID) {
+                qDebug() << __FUNCTION__ << __LINE__ << "can't reserve ids for the imported notes";
+                noteList.clear();
+            }
             int notePos = nextAvailablePosition(defaultNoteFolder.id(), NodeData::Type::Note);
             const QString &parentAbsPath = defaultNoteFolder.absolutePath();
             if (!m_db.transaction()) {
@@ -2177,21 +3410,14 @@ void DBManager::onImportNotesRequested(const QString &fileName)
                 ++nodeId;
                 ++notePos;
             }
-            QSqlQuery query(m_db);
-            if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
-            query.bindValue(":value", nodeId + 1);
-            if (!query.exec()) {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
             if (!m_db.commit()) {
                 qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
             }
         }
     }
+    // new folders and tags were already announced by addNode() and addTag()
     recalculateChildNotesCount();
-    onNodeTagTreeRequested();
+    emit nodesImported();
 }
 
 /*!
@@ -2231,7 +3457,11 @@ void DBManager::onRestoreNotesRequested(const QString &fileName)
             QFile::remove(m_dbpath);
             open(m_dbpath, true);
             auto defaultNoteFolder = getNode(DEFAULT_NOTES_FOLDER_ID);
-            int nodeId = nextAvailableNodeId();
+            int nodeId = reserveNodeIds(noteList.size());
+            if (nodeId == INVALID_NODE_ID) {
+                qDebug() << __FUNCTION__ << __LINE__ << "can't reserve ids for the imported notes";
+                noteList.clear();
+            }
             int notePos = nextAvailablePosition(defaultNoteFolder.id(), NodeData::Type::Note);
             const QString &parentAbsPath = defaultNoteFolder.absolutePath();
             if (!m_db.transaction()) {
@@ -2249,14 +3479,6 @@ void DBManager::onRestoreNotesRequested(const QString &fileName)
                 ++nodeId;
                 ++notePos;
             }
-            QSqlQuery query(m_db);
-            if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
-            query.bindValue(":value", nodeId + 1);
-            if (!query.exec()) {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
             if (!m_db.commit()) {
                 qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
             }
@@ -2272,6 +3494,8 @@ void DBManager::onRestoreNotesRequested(const QString &fileName)
  */
 void DBManager::onExportNotesRequested(const QString &fileName)
 {
+    // older versions restoring the copy don't know about content_journal
+    compactContentJournals();
     QSqlQuery query(m_db);
     if (!query.prepare("BEGIN IMMEDIATE;")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
@@ -2301,7 +3525,11 @@ void DBManager::onExportNotesRequested(const QString &fileName)
 void DBManager::onMigrateNotesFromV0_9_0Requested(QVector<NodeData> &noteList)
 {
     auto defaultNoteFolder = getNode(DEFAULT_NOTES_FOLDER_ID);
-    int nodeId = nextAvailableNodeId();
+    int nodeId = reserveNodeIds(noteList.size());
+    if (nodeId == INVALID_NODE_ID) {
+        qDebug() << __FUNCTION__ << __LINE__ << "can't reserve ids for the migrated notes";
+        return;
+    }
     int notePos = nextAvailablePosition(defaultNoteFolder.id(), NodeData::Type::Note);
     const QString &parentAbsPath = defaultNoteFolder.absolutePath();
 
@@ -2320,14 +3548,6 @@ void DBManager::onMigrateNotesFromV0_9_0Requested(QVector<NodeData> &noteList)
         ++nodeId;
         ++notePos;
     }
-    QSqlQuery query(m_db);
-    if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(":value", nodeId + 1);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
     if (!m_db.commit()) {
         qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
     }
@@ -2341,7 +3561,11 @@ void DBManager::onMigrateNotesFromV0_9_0Requested(QVector<NodeData> &noteList)
 void DBManager::onMigrateTrashFrom0_9_0Requested(QVector<NodeData> &noteList)
 {
     auto trashFolder = getNode(TRASH_FOLDER_ID);
-    int nodeId = nextAvailableNodeId();
+    int nodeId = reserveNodeIds(noteList.size());
+    if (nodeId == INVALID_NODE_ID) {
+        qDebug() << __FUNCTION__ << __LINE__ << "can't reserve ids for the migrated notes";
+        return;
+    }
     int notePos = nextAvailablePosition(trashFolder.id(), NodeData::Type::Note);
     const QString &parentAbsPath = trashFolder.absolutePath();
 
@@ -2360,14 +3584,6 @@ void DBManager::onMigrateTrashFrom0_9_0Requested(QVector<NodeData> &noteList)
         ++nodeId;
         ++notePos;
     }
-    QSqlQuery query(m_db);
-    if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(":value", nodeId + 1);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
     if (!m_db.commit()) {
         qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
     }
@@ -2445,7 +3661,12 @@ void DBManager::onMigrateNotesFrom1_5_0Requested(const QString &fileName)
     }
     auto defaultNoteFolder = getNode(DEFAULT_NOTES_FOLDER_ID);
     auto trashFolder = getNode(TRASH_FOLDER_ID);
-    int nodeId = nextAvailableNodeId();
+    int nodeId = reserveNodeIds(notes.size() + trash.size());
+    if (nodeId == INVALID_NODE_ID) {
+        qDebug() << __FUNCTION__ << __LINE__ << "can't reserve ids for the migrated notes";
+        notes.clear();
+        trash.clear();
+    }
     int notePos = nextAvailablePosition(defaultNoteFolder.id(), NodeData::Type::Note);
     QString parentAbsPath = defaultNoteFolder.absolutePath();
     if (!m_db.transaction()) {
@@ -2477,14 +3698,6 @@ void DBManager::onMigrateNotesFrom1_5_0Requested(const QString &fileName)
         ++nodeId;
         ++notePos;
     }
-    QSqlQuery query(m_db);
-    if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(":value", nodeId + 1);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
     if (!m_db.commit()) {
         qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
     }
@@ -2498,6 +3711,7 @@ void DBManager::onMigrateNotesFrom1_5_0Requested(const QString &fileName)
 
 void DBManager::onChangeDatabasePathRequested(const QString &newPath)
 {
+    compactContentJournals();
     {
         if (!m_db.commit()) {
             qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
@@ -2525,19 +3739,13 @@ void DBManager::addNotesToNewImportedFolder(const QList<QPair<QString, QDateTime
         return;
     }
 
-    NodeData createdFolder = getNode(newFolderId);
-    const QString &parentAbsPath = createdFolder.absolutePath();
-
-    int nodeId = nextAvailableNodeId();
     int notePos = 0;
 
     for (const auto &noteData : fileDatas) {
         NodeData note;
         note.setFullTitle(noteData.first.section('\n', 0, 0, QString::SectionSkipEmpty));
         note.setContent(noteData.first);
-        note.setId(nodeId++);
         note.setRelativePosition(notePos++);
-        note.setAbsolutePath(parentAbsPath + PATH_SEPARATOR + QString::number(note.id()));
         note.setNodeType(NodeData::Type::Note);
         note.setParentId(newFolderId);
         note.setCreationDateTime(noteData.second);
@@ -2547,11 +3755,12 @@ void DBManager::addNotesToNewImportedFolder(const QList<QPair<QString, QDateTime
     }
 
     recalculateChildNotesCount();
-    onNodeTagTreeRequested();
+    emit nodesImported();
 }
 
 void DBManager::exportNotes(const QString &baseExportPath, const QString &extension)
 {
+    compactContentJournals();
     // Ensure the export directory exists
     QString rootFolderName = QStringLiteral("Notes");
     QString exportPathNew = QStringLiteral("%1%2%3").arg(baseExportPath, QDir::separator(), rootFolderName);
@@ -2565,7 +3774,7 @@ void DBManager::exportNotes(const QString &baseExportPath, const QString &extens
     directory.mkpath(exportPathNew);
 
     // Retrieve all folders first to create the directory structure
-    QVector<NodeData> folders = getAllFolders();
+    QVector<NodeData> folders = getCachedFolders();
 
     // Create directories for each folder
     QMap<int, QString> folderPaths;
@@ -2579,8 +3788,7 @@ void DBManager::exportNotes(const QString &baseExportPath, const QString &extens
                 int id = part.toInt();
                 if (id == ROOT_FOLDER_ID)
                     continue;
-                auto folderTemp = getNode(id);
-                folderNames << folderTemp.fullTitle();
+                folderNames << m_folders.value(id).fullTitle();
             }
             QString relativePath = folderNames.join(QDir::separator());
             path += QDir::separator() + relativePath;
@@ -2595,9 +3803,10 @@ void DBManager::exportNotes(const QString &baseExportPath, const QString &extens
         folderPaths.insert(folder.id(), path);
     }
 
-    // Retrieve all notes
+    // Only the ids are read up front, the notes themselves are loaded and
+    // written out in chunks as background work
     QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT "id", "title", "content", "parent_id" FROM node_table WHERE node_type = :note_type)")) {
+    if (!query.prepare(R"(SELECT "id" FROM node_table WHERE node_type = :note_type)")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.bindValue(":note_type", static_cast<int>(NodeData::Type::Note));
@@ -2606,13 +3815,54 @@ void DBManager::exportNotes(const QString &baseExportPath, const QString &extens
         qDebug() << "Failed to retrieve notes for export:" << query.lastError();
         return;
     }
+    QVector<int> noteIds;
+    while (query.next()) {
+        noteIds.append(query.value(0).toInt());
+    }
+
+    int position = 0;
+    m_scheduler->postChunked([this, noteIds, folderPaths, extension, exportPathNew, position]() mutable {
+        exportNoteFiles(noteIds.mid(position, EXPORT_CHUNK_SIZE), folderPaths, extension);
+        position += EXPORT_CHUNK_SIZE;
+        if (position < noteIds.size()) {
+            return true;
+        }
+        qDebug() << "Export completed to:" << exportPathNew;
+        emit notesExported(exportPathNew);
+        return false;
+    });
+}
+
+/*!
+ * \brief DBManager::exportNoteFiles
+ * Writes the given notes as files into the directories of their folders
+ * \param noteIds
+ * \param folderPaths
+ * \param extension
+ */
+void DBManager::exportNoteFiles(const QVector<int> &noteIds, const QMap<int, QString> &folderPaths, const QString &extension)
+{
+    if (noteIds.isEmpty()) {
+        return;
+    }
+    QStringList idList;
+    idList.reserve(noteIds.size());
+    for (const auto id : noteIds) {
+        idList.append(QString::number(id));
+    }
+    QSqlQuery query(m_db);
+    if (!query.exec(QStringLiteral(R"(SELECT "id", "title", "content", "parent_id" FROM node_table WHERE id IN (%1))").arg(idList.join(',')))) {
+        qDebug() << "Failed to retrieve notes for export:" << query.lastError();
+        return;
+    }
 
     // Export each note as a .txt file in its corresponding directory
+    QDir directory;
     QTextDocument doc;
     while (query.next()) {
-        // int noteId = query.value(0).toInt();
         QString title = query.value(1).toString();
-        QString content = query.value(2).toString();
+        // deltas may have been saved since the export started
+        QString content = journaledContent(query.value(0).toInt(), query.value(2).toString());
         int parentId = query.value(3).toInt();
 
         QString notePath = folderPaths[parentId];
@@ -2631,7 +3881,7 @@ void DBManager::exportNotes(const QString &baseExportPath, const QString &extens
             safeTitle = QStringLiteral("Untitled Note");
         }
 
-        counter = 1;
+        int counter = 1;
         while (directory.exists(filePath)) {
             filePath = QStringLiteral("%1%2%3 %4%5").arg(notePath, QDir::separator(), safeTitle, QString::number(counter++), extension);
         }
@@ -2645,6 +3895,4 @@ void DBManager::exportNotes(const QString &baseExportPath, const QString &extens
             qDebug() << "Failed to export note:" << filePath;
         }
     }
-
-    qDebug() << "Export completed to:" << baseExportPath;
 }
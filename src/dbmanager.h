@@ -4,10 +4,12 @@
 #include "nodedata.h"
 #include "tagdata.h"
 #include "nodepath.h"
+#include "notebitmap.h"
 #include <QObject>
 #include <QtSql/QSqlDatabase>
 #include <QPair>
 #include <QSet>
+#include <QHash>
 #include <QVector>
 #include <QTextDocument>
 
@@ -15,13 +17,15 @@ struct NodeTagTreeData
 {
     QVector<NodeData> nodeTreeData;
     QVector<TagData> tagTreeData;
+    // folders in nodeTreeData whose child folders were left out, to be fetched on expand
+    QSet<int> lazyParentIds;
 };
 
 struct ListViewInfo
 {
     bool isInSearch;
     bool isInTag;
-    QSet<int> currentTagList;
+    TagFilter tagFilter;
     int parentFolderId;
     QSet<int> currentNotesId;
     bool needCreateNewNote;
@@ -37,6 +41,9 @@ struct Folder
 
 using FolderListType = QMap<int, QString>;
 
+class DBScheduler;
+class QTimer;
+
 class DBManager : public QObject
 {
     Q_OBJECT
@@ -44,27 +51,56 @@ public:
     explicit DBManager(QObject *parent = nullptr);
     Q_INVOKABLE NodePath getNodeAbsolutePath(int nodeId);
     Q_INVOKABLE NodeData getNode(int nodeId);
+    QVector<NodeData> getNodes(const QVector<int> &nodeIds);
     Q_INVOKABLE void moveFolderToTrash(const NodeData &node);
     Q_INVOKABLE FolderListType getFolderList();
-    void exportNotes(const QString &baseExportPath, const QString &extension);
+    Q_INVOKABLE NodeTagTreeData getChildFolders(int parentId);
+    Q_INVOKABLE QVector<NoteHeading> getNoteOutline(int noteId);
+    Q_INVOKABLE void exportNotes(const QString &baseExportPath, const QString &extension);
     void addNotesToNewImportedFolder(const QList<QPair<QString, QDateTime>> &fileDatas);
+    DBScheduler *scheduler() const;
 
 private:
     void open(const QString &path, bool doCreate = false);
     void createTables();
+    void createIndexes();
 
     bool isNodeExist(const NodeData &node);
     QString m_dbpath;
     QSqlDatabase m_db;
 
     QVector<NodeData> getAllFolders();
+    QVector<NodeData> getCachedFolders() const;
+    void loadFolderGraph();
+    void cacheFolder(const NodeData &folder);
+    void uncacheFolder(int folderId);
+    void updateCachedFolderPath(int folderId, const QString &oldPath, const QString &newPath);
+    void setCachedChildNotesCount(int folderId, int childNotesCount);
+    void loadTagIndex();
+    NoteBitmap notesMatchingTags(const TagFilter &filter);
+    QVector<NodeData> getNotesByIds(const QVector<int> &noteIds, bool isPreview);
     QVector<TagData> getAllTagInfo();
     QSet<int> getAllTagForNote(int noteId);
     bool updateNoteContent(const NodeData &note);
+    void createContentJournal();
+    void loadContentJournal();
+    QString journaledContent(int noteId, QString content, bool isPrefix = false);
+    int contentLength(int noteId);
+    QSet<int> notesWithJournal() const;
+    bool journaledContentContains(int noteId, const QString &keyword);
+    bool compactContentJournal(int noteId);
+    void compactContentJournals();
+    void scheduleContentJournalCompaction();
+    void createNoteOutline();
     QList<NodeData> readOldNBK(const QString &fileName);
     int nextAvailablePosition(int parentId, NodeData::Type nodeType);
     int addNodePreComputed(const NodeData &node);
+    int addNodeWithId(const NodeData &node, int nodeId);
+    int reserveIds(const QString &key, int count);
+    int allocateNodeId();
+    int allocateTagId();
     void recalculateChildNotesCount();
+    void scheduleRecalculateChildNotesCount();
     void recalculateChildNotesCountFolder(int folderId);
     void recalculateChildNotesCountTag(int tagId);
     void recalculateChildNotesCountAllNotes();
@@ -72,11 +108,39 @@ private:
     void decreaseChildNotesCountTag(int tagId);
     void increaseChildNotesCountFolder(int folderId);
     void decreaseChildNotesCountFolder(int folderId);
+    void exportNoteFiles(const QVector<int> &noteIds, const QMap<int, QString> &folderPaths, const QString &extension);
+
+    // Folders change rarely, so their rows (without content) are mirrored here
+    // and kept in sync by every folder mutation; folder lookups don't hit SQL.
+    QHash<int, NodeData> m_folders;
+    QHash<int, QVector<int>> m_folderChildren;
+    // tag id -> notes carrying it, mirrors tag_relationship
+    QHash<int, NoteBitmap> m_tagIndex;
+    // ids reserved in metadata that addNode()/addTag() hand out, [next, end)
+    int m_nextNodeId;
+    int m_nodeIdBlockEnd;
+    int m_nextTagId;
+    int m_tagIdBlockEnd;
+    DBScheduler *m_scheduler;
+    // content_journal of the notes saved with deltas this session
+    struct ContentJournalState
+    {
+        int length = -1; // of the content with the deltas applied, -1 if unknown
+        int pendingDeltas = 0;
+        qsizetype pendingBytes = 0;
+    };
+    QHash<int, ContentJournalState> m_contentJournal;
+    QTimer *m_journalCompactionTimer;
 
 signals:
     void notesListReceived(const QVector<NodeData> &noteList, const ListViewInfo &inf);
     void nodesTagTreeReceived(const NodeTagTreeData &treeData);
 
+    void folderAdded(const NodeData &folder);
+    void folderRenamed(int folderId, const QString &newName);
+    void folderMoved(int folderId, int newParentId);
+    void folderRemoved(int folderId);
+    void nodesImported();
     void tagAdded(const TagData &tag);
     void tagRemoved(int tagId);
     void tagRenamed(int tagId, const QString &newName);
@@ -84,13 +148,19 @@ signals:
     void showErrorMessage(const QString &title, const QString &content);
     void childNotesCountUpdatedTag(int tagId, int childCount);
     void childNotesCountUpdatedFolder(int folderId, const QString &path, int childCount);
+    void nodeIdsReset();
+    void notesExported(const QString &exportPath);
+    void noteContentOutOfSync(const NodeData &note);
 
 public slots:
     void onNodeTagTreeRequested();
     void onNotesListInFolderRequested(int parentID, bool isRecursive, bool newNote = false, int scrollToId = INVALID_NODE_ID);
-    void onNotesListInTagsRequested(const QSet<int> &tagIds, bool newNote = false, int scrollToId = INVALID_NODE_ID);
+    void onNotesListInTagsRequested(const TagFilter &filter, bool newNote = false, int scrollToId = INVALID_NODE_ID);
     void onOpenDBManagerRequested(const QString &path, bool doCreate);
     void onCreateUpdateRequestedNoteContent(const NodeData &note);
+    void onNoteContentDeltasRequested(const NodeData &note, const QVector<ContentDelta> &deltas, int baseLength);
+    void updateNoteScrollBarPosition(int noteId, int scrollBarPosition);
+    void updateNoteOutline(const NodeData &note, const QVector<NoteHeading> &outline);
     void onImportNotesRequested(const QString &fileName);
     void onRestoreNotesRequested(const QString &fileName);
     void onExportNotesRequested(const QString &fileName);
@@ -104,7 +174,9 @@ public slots:
     int addTag(const TagData &tag);
     void addNoteToTag(int noteId, int tagId);
     void removeNoteFromTag(int noteId, int tagId);
-    int nextAvailableNodeId();
+    void addTagToNotes(int tagId, const QVector<int> &noteIds);
+    void removeTagFromNotes(int tagId, const QVector<int> &noteIds);
+    int reserveNodeIds(int count);
     int nextAvailableTagId();
     void renameNode(int id, const QString &newName);
     void renameTag(int id, const QString &newName);
@@ -112,6 +184,7 @@ public slots:
     void removeNote(const NodeData &note);
     void removeTag(int tagId);
     void moveNode(int nodeId, const NodeData &target);
+    void moveNotes(const QVector<int> &noteIds, const NodeData &target);
     void searchForNotes(const QString &keyword, const ListViewInfo &inf);
     void clearSearch(const ListViewInfo &inf);
     void updateRelPosNode(int nodeId, int relPos);
@@ -0,0 +1,48 @@
+#include "dbmanagerasync.h"
+
+DBManagerAsync::DBManagerAsync(DBManager *dbManager) : m_dbManager{ dbManager } { }
+
+QFuture<NodeData> DBManagerAsync::getNode(int nodeId) const
+{
+    return run<NodeData>([nodeId](DBManager *dbManager) { return dbManager->getNode(nodeId); });
+}
+
+QFuture<QVector<NodeData>> DBManagerAsync::getNodes(const QVector<int> &nodeIds) const
+{
+    return run<QVector<NodeData>>([nodeIds](DBManager *dbManager) { return dbManager->getNodes(nodeIds); });
+}
+
+QFuture<NodeData> DBManagerAsync::getChildNotesCountFolder(int folderId) const
+{
+    return run<NodeData>([folderId](DBManager *dbManager) { return dbManager->getChildNotesCountFolder(folderId); });
+}
+
+QFuture<int> DBManagerAsync::addNode(const NodeData &node) const
+{
+    return run<int>([node](DBManager *dbManager) { return dbManager->addNode(node); });
+}
+
+QFuture<int> DBManagerAsync::addTag(const TagData &tag) const
+{
+    return run<int>([tag](DBManager *dbManager) { return dbManager->addTag(tag); });
+}
+
+QFuture<int> DBManagerAsync::reserveNodeIds(int count) const
+{
+    return run<int>([count](DBManager *dbManager) { return dbManager->reserveNodeIds(count); });
+}
+
+QFuture<FolderListType> DBManagerAsync::getFolderList() const
+{
+    return run<FolderListType>([](DBManager *dbManager) { return dbManager->getFolderList(); });
+}
+
+QFuture<NodeTagTreeData> DBManagerAsync::getChildFolders(int parentId) const
+{
+    return run<NodeTagTreeData>([parentId](DBManager *dbManager) { return dbManager->getChildFolders(parentId); });
+}
+
+QFuture<QVector<NoteHeading>> DBManagerAsync::getNoteOutline(int noteId) const
+{
+    return run<QVector<NoteHeading>>([noteId](DBManager *dbManager) { return dbManager->getNoteOutline(noteId); });
+}
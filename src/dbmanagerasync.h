@@ -0,0 +1,75 @@
+#ifndef DBMANAGERASYNC_H
+#define DBMANAGERASYNC_H
+
+#include "dbmanager.h"
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QPromise>
+#include <memory>
+
+// Typed access to DBManager that never blocks the caller. Each call is queued
+// to the DBManager thread and returns a QFuture; DBManagerAsync::then() hands
+// the result back on the caller's thread. A future whose DBManager went away
+// before running the call finishes without a result.
+class DBManagerAsync
+{
+public:
+    explicit DBManagerAsync(DBManager *dbManager);
+
+    QFuture<NodeData> getNode(int nodeId) const;
+    QFuture<QVector<NodeData>> getNodes(const QVector<int> &nodeIds) const;
+    QFuture<NodeData> getChildNotesCountFolder(int folderId) const;
+    QFuture<int> addNode(const NodeData &node) const;
+    QFuture<int> addTag(const TagData &tag) const;
+    QFuture<int> reserveNodeIds(int count) const;
+    QFuture<FolderListType> getFolderList() const;
+    QFuture<NodeTagTreeData> getChildFolders(int parentId) const;
+    QFuture<QVector<NoteHeading>> getNoteOutline(int noteId) const;
+
+    // Calls callback with the result on context's thread once future is done.
+    // Nothing is called if context is destroyed first or there is no result.
+    template<typename T, typename Callback>
+    static void then(QObject *context, const QFuture<T> &future, Callback &&callback);
+
+private:
+    template<typename T, typename Call>
+    QFuture<T> run(Call &&call) const;
+
+    DBManager *m_dbManager;
+};
+
+template<typename T, typename Callback>
+void DBManagerAsync::then(QObject *context, const QFuture<T> &future, Callback &&callback)
+{
+    auto *watcher = new QFutureWatcher<T>(context);
+    QObject::connect(watcher, &QFutureWatcher<T>::finished, context, [watcher, callback = std::forward<Callback>(callback)]() mutable {
+        watcher->deleteLater();
+        if (watcher->future().resultCount() > 0) {
+            callback(watcher->result());
+        }
+    });
+    watcher->setFuture(future);
+}
+
+template<typename T, typename Call>
+QFuture<T> DBManagerAsync::run(Call &&call) const
+{
+    auto promise = std::make_shared<QPromise<T>>();
+    auto future = promise->future();
+    promise->start();
+    if (m_dbManager == nullptr) {
+        promise->finish();
+        return future;
+    }
+    // if the call never runs, the last promise reference cancels the future
+    QMetaObject::invokeMethod(
+            m_dbManager,
+            [dbManager = m_dbManager, promise, call = std::forward<Call>(call)]() {
+                promise->addResult(call(dbManager));
+                promise->finish();
+            },
+            Qt::QueuedConnection);
+    return future;
+}
+
+#endif // DBMANAGERASYNC_H
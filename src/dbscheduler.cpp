@@ -0,0 +1,82 @@
+#include "dbscheduler.h"
+#include <QCoreApplication>
+#include <QEvent>
+#include <QMutexLocker>
+
+namespace {
+class TaskEvent : public QEvent
+{
+public:
+    static const QEvent::Type EventType;
+
+    TaskEvent(std::function<bool()> task, const QString &coalesceKey, quint64 ticket)
+        : QEvent(EventType), task{ std::move(task) }, coalesceKey{ coalesceKey }, ticket{ ticket }
+    {
+    }
+
+    std::function<bool()> task;
+    QString coalesceKey;
+    quint64 ticket;
+};
+
+const QEvent::Type TaskEvent::EventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+int eventPriority(DBScheduler::Priority priority)
+{
+    // user writes run ahead of everything still queued, so a read always sees
+    // the writes posted before it. Interactive reads share the priority of
+    // queued slot calls and background chunks yield to both
+    switch (priority) {
+    case DBScheduler::Priority::UserWrite:
+        return Qt::HighEventPriority;
+    case DBScheduler::Priority::InteractiveRead:
+        return Qt::NormalEventPriority;
+    case DBScheduler::Priority::Background:
+        return Qt::LowEventPriority;
+    }
+    return Qt::NormalEventPriority;
+}
+} // namespace
+
+DBScheduler::DBScheduler(QObject *parent) : QObject(parent), m_nextTicket{ 0 } { }
+
+void DBScheduler::post(Priority priority, std::function<void()> task, const QString &coalesceKey)
+{
+    quint64 ticket = 0;
+    if (!coalesceKey.isEmpty()) {
+        QMutexLocker locker(&m_mutex);
+        ticket = ++m_nextTicket;
+        m_latestTickets[coalesceKey] = ticket;
+    }
+    auto wrapped = [task = std::move(task)]() {
+        task();
+        return false;
+    };
+    QCoreApplication::postEvent(this, new TaskEvent(std::move(wrapped), coalesceKey, ticket), eventPriority(priority));
+}
+
+void DBScheduler::postChunked(std::function<bool()> chunk)
+{
+    QCoreApplication::postEvent(this, new TaskEvent(std::move(chunk), QString(), 0), eventPriority(Priority::Background));
+}
+
+void DBScheduler::customEvent(QEvent *event)
+{
+    if (event->type() != TaskEvent::EventType) {
+        QObject::customEvent(event);
+        return;
+    }
+    auto *taskEvent = static_cast<TaskEvent *>(event);
+    if (!taskEvent->coalesceKey.isEmpty()) {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_latestTickets.find(taskEvent->coalesceKey);
+        if (it == m_latestTickets.end() || it.value() != taskEvent->ticket) {
+            // superseded by a newer request with the same key
+            return;
+        }
+        m_latestTickets.erase(it);
+    }
+    if (taskEvent->task()) {
+        postChunked(std::move(taskEvent->task));
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef DBSCHEDULER_H
+#define DBSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <functional>
+
+// Runs work on the thread of its parent DBManager. Requests carrying the same
+// coalesce key replace each other: one that is superseded before it started
+// is dropped. Background work runs in chunks at low event priority, so any
+// request posted meanwhile gets in between two chunks.
+class DBScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Priority : uint8_t {
+        // edits made by the user, run before any queued read
+        UserWrite,
+        // requests the user waits for, such as the notes list
+        InteractiveRead,
+        Background
+    };
+
+    explicit DBScheduler(QObject *parent = nullptr);
+
+    // Thread safe. An empty key never coalesces.
+    void post(Priority priority, std::function<void()> task, const QString &coalesceKey = QString());
+    // Thread safe. The task is called once per chunk until it returns false.
+    void postChunked(std::function<bool()> chunk);
+
+protected:
+    void customEvent(QEvent *event) override;
+
+private:
+    QMutex m_mutex;
+    QHash<QString, quint64> m_latestTickets;
+    quint64 m_nextTicket;
+};
+
+#endif // DBSCHEDULER_H
@@ -3,12 +3,15 @@
 #include "notelistmodel.h"
 #include "notelistdelegate.h"
 #include "dbmanager.h"
+#include "dbmanagerasync.h"
+#include "dbscheduler.h"
 #include <QDebug>
 #include <QMessageBox>
 #include <QLineEdit>
 #include <QToolButton>
 #include "tagpool.h"
 #include <QTimer>
+#include <QMutexLocker>
 
 static bool isInvalidCurrentNotesId(const QSet<int> &currentNotesId)
 {
@@ -34,7 +37,9 @@ ListViewLogic::ListViewLogic(NoteListView *noteView, NoteListModel *noteModel, Q
       m_dbManager{ dbManager },
       m_tagPool{ tagPool },
       m_needLoadSavedState{ 0 },
-      m_lastSelectedNotes{}
+      m_lastSelectedNotes{},
+      m_pendingListNewNote{ false },
+      m_pendingListScrollToId{ INVALID_NODE_ID }
 {
     m_listDelegate = new NoteListDelegate(m_listView, tagPool, m_listView);
     m_listView->setItemDelegate(m_listDelegate);
@@ -48,12 +53,38 @@ ListViewLogic::ListViewLogic(NoteListView *noteView, NoteListModel *noteModel, Q
     connect(m_listView, &NoteListView::addTagRequested, this, &ListViewLogic::onAddTagRequest);
     connect(m_listView, &NoteListView::removeTagRequested, this, &ListViewLogic::onRemoveTagRequest);
 
-    connect(this, &ListViewLogic::requestAddTagDb, dbManager, &DBManager::addNoteToTag, Qt::QueuedConnection);
-    connect(this, &ListViewLogic::requestRemoveTagDb, dbManager, &DBManager::removeNoteFromTag, Qt::QueuedConnection);
-    connect(this, &ListViewLogic::requestRemoveNoteDb, dbManager, &DBManager::removeNote, Qt::QueuedConnection);
-    connect(this, &ListViewLogic::requestMoveNoteDb, dbManager, &DBManager::moveNode, Qt::QueuedConnection);
-    connect(this, &ListViewLogic::requestSearchInDb, dbManager, &DBManager::searchForNotes, Qt::QueuedConnection);
-    connect(this, &ListViewLogic::requestClearSearchDb, dbManager, &DBManager::clearSearch, Qt::QueuedConnection);
+    // edits made from the list are user writes, see DBScheduler
+    connect(this, &ListViewLogic::requestAddTagDb, this, [dbManager](int noteId, int tagId) {
+        dbManager->scheduler()->post(DBScheduler::Priority::UserWrite, [dbManager, noteId, tagId]() { dbManager->addNoteToTag(noteId, tagId); });
+    });
+    connect(this, &ListViewLogic::requestAddTagToNotesDb, this, [dbManager](int tagId, const QVector<int> &noteIds) {
+        dbManager->scheduler()->post(DBScheduler::Priority::UserWrite, [dbManager, tagId, noteIds]() { dbManager->addTagToNotes(tagId, noteIds); });
+    });
+    connect(this, &ListViewLogic::requestRemoveTagFromNotesDb, this, [dbManager](int tagId, const QVector<int> &noteIds) {
+        dbManager->scheduler()->post(DBScheduler::Priority::UserWrite, [dbManager, tagId, noteIds]() { dbManager->removeTagFromNotes(tagId, noteIds); });
+    });
+    connect(this, &ListViewLogic::requestRemoveNoteDb, this, [dbManager](const NodeData &noteData) {
+        dbManager->scheduler()->post(DBScheduler::Priority::UserWrite, [dbManager, noteData]() { dbManager->removeNote(noteData); });
+    });
+    connect(this, &ListViewLogic::requestMoveNoteDb, this, [dbManager](int noteId, const NodeData &targetFolder) {
+        dbManager->scheduler()->post(DBScheduler::Priority::UserWrite, [dbManager, noteId, targetFolder]() { dbManager->moveNode(noteId, targetFolder); });
+    });
+    // list requests share one coalesce key: when several are queued (typing in
+    // the search box, arrowing through folders) only the newest one runs
+    connect(this, &ListViewLogic::requestSearchInDb, this, [this](const QString &keyword, const ListViewInfo &inf) {
+        postNotesListRequest(inf.needCreateNewNote, inf.scrollToId, [dbManager = m_dbManager, keyword, inf](bool mergedNewNote, int mergedScrollToId) mutable {
+            inf.needCreateNewNote = mergedNewNote;
+            inf.scrollToId = mergedScrollToId;
+            dbManager->searchForNotes(keyword, inf);
+        });
+    });
+    connect(this, &ListViewLogic::requestClearSearchDb, this, [this](const ListViewInfo &inf) {
+        postNotesListRequest(inf.needCreateNewNote, inf.scrollToId, [dbManager = m_dbManager, inf](bool mergedNewNote, int mergedScrollToId) mutable {
+            inf.needCreateNewNote = mergedNewNote;
+            inf.scrollToId = mergedScrollToId;
+            dbManager->clearSearch(inf);
+        });
+    });
     connect(m_listModel, &NoteListModel::requestUpdatePinnedRelPos, dbManager, &DBManager::updateRelPosPinnedNote, Qt::QueuedConnection);
     connect(m_listModel, &NoteListModel::requestUpdatePinnedRelPosAN, dbManager, &DBManager::updateRelPosPinnedNoteAN, Qt::QueuedConnection);
     connect(m_listModel, &NoteListModel::requestUpdatePinned, dbManager, &DBManager::setNoteIsPinned, Qt::QueuedConnection);
@@ -61,7 +92,18 @@ ListViewLogic::ListViewLogic(NoteListView *noteView, NoteListModel *noteModel, Q
     connect(m_listView, &NoteListView::deleteNoteRequested, this, &ListViewLogic::deleteNoteRequestedI);
     connect(m_listView, &NoteListView::restoreNoteRequested, this, &ListViewLogic::restoreNotesRequestedI);
 
+    // drop cached row pixmaps whenever what they show may have changed
+    connect(m_listModel, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+        QSet<int> ids;
+        for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+            ids.insert(m_listModel->index(row).data(NoteListModel::NoteID).toInt());
+        }
+        m_listDelegate->invalidateRowCache(ids);
+    });
+    connect(m_listModel, &QAbstractItemModel::modelReset, m_listDelegate, &NoteListDelegate::clearRowCache);
+    connect(tagPool, &TagPool::dataReset, m_listDelegate, &NoteListDelegate::clearRowCache);
     connect(tagPool, &TagPool::dataUpdated, this, [this](int) {
+        m_listDelegate->clearRowCache();
         if (m_listModel->rowCount() > 0) {
             emit m_listModel->dataChanged(m_listModel->index(0, 0), m_listModel->index(m_listModel->rowCount() - 1, 0));
             emit m_listModel->rowCountChanged();
@@ -91,13 +133,46 @@ ListViewLogic::ListViewLogic(NoteListView *noteView, NoteListModel *noteModel, Q
     });
     connect(m_listDelegate, &NoteListDelegate::animationFinished, m_listView, &NoteListView::onAnimationFinished);
     connect(m_listModel, &NoteListModel::requestRemoveNotes, m_listView, &NoteListView::onRemoveRowRequested);
-    connect(this, &ListViewLogic::requestNotesListInFolder, m_dbManager, &DBManager::onNotesListInFolderRequested, Qt::QueuedConnection);
-    connect(this, &ListViewLogic::requestNotesListInTags, m_dbManager, &DBManager::onNotesListInTagsRequested, Qt::QueuedConnection);
+    connect(this, &ListViewLogic::requestNotesListInFolder, this, [this](int parentID, bool isRecursive, bool newNote, int scrollToId) {
+        postNotesListRequest(newNote, scrollToId, [dbManager = m_dbManager, parentID, isRecursive](bool mergedNewNote, int mergedScrollToId) {
+            dbManager->onNotesListInFolderRequested(parentID, isRecursive, mergedNewNote, mergedScrollToId);
+        });
+    });
+    connect(this, &ListViewLogic::requestNotesListInTags, this, [this](const TagFilter &filter, bool newNote, int scrollToId) {
+        postNotesListRequest(newNote, scrollToId, [dbManager = m_dbManager, filter](bool mergedNewNote, int mergedScrollToId) {
+            dbManager->onNotesListInTagsRequested(filter, mergedNewNote, mergedScrollToId);
+        });
+    });
     connect(m_listModel, &NoteListModel::rowsInsertedC, m_listView, &NoteListView::onRowsInserted);
     connect(m_listModel, &NoteListModel::selectNotes, this, &ListViewLogic::selectNotes);
     connect(m_listView, &NoteListView::noteListViewClicked, this, &ListViewLogic::onListViewClicked);
 }
 
+// A superseded list request is dropped, but what it asked for on arrival
+// (create a note, scroll to one) still has to happen: the flags of all the
+// requests queued since the last one ran are merged into the one that runs
+void ListViewLogic::postNotesListRequest(bool newNote, int scrollToId, std::function<void(bool, int)> request)
+{
+    {
+        QMutexLocker locker(&m_pendingListMutex);
+        m_pendingListNewNote = m_pendingListNewNote || newNote;
+        if (scrollToId != INVALID_NODE_ID) {
+            m_pendingListScrollToId = scrollToId;
+        }
+    }
+    auto task = [this, request = std::move(request)]() {
+        bool pendingNewNote = false;
+        int pendingScrollToId = INVALID_NODE_ID;
+        {
+            QMutexLocker locker(&m_pendingListMutex);
+            std::swap(pendingNewNote, m_pendingListNewNote);
+            std::swap(pendingScrollToId, m_pendingListScrollToId);
+        }
+        request(pendingNewNote, pendingScrollToId);
+    };
+    m_dbManager->scheduler()->post(DBScheduler::Priority::InteractiveRead, std::move(task), QStringLiteral("notesList"));
+}
+
 void ListViewLogic::selectNote(const QModelIndex &noteIndex)
 {
     if (noteIndex.isValid()) {
@@ -143,7 +218,14 @@ void ListViewLogic::setNoteData(const NodeData &note)
     if (noteIndex.isValid()) {
         QMap<int, QVariant> dataValue;
         auto wasTemp = noteIndex.data(NoteListModel::NoteIsTemp).toBool();
-        dataValue[NoteListModel::NoteContent] = QVariant::fromValue(note.content());
+        // the list only needs the start of a large note
+        if (note.content().size() > LARGE_NOTE_SIZE) {
+            dataValue[NoteListModel::NoteContent] = QVariant::fromValue(note.content().left(NOTE_PREVIEW_SIZE));
+            dataValue[NoteListModel::NoteIsContentPrefix] = true;
+        } else {
+            dataValue[NoteListModel::NoteContent] = QVariant::fromValue(note.content());
+            dataValue[NoteListModel::NoteIsContentPrefix] = note.isContentPrefix();
+        }
         dataValue[NoteListModel::NoteFullTitle] = QVariant::fromValue(note.fullTitle());
         dataValue[NoteListModel::NoteLastModificationDateTime] = QVariant::fromValue(note.lastModificationdateTime());
         dataValue[NoteListModel::NoteIsTemp] = QVariant::fromValue(note.isTempNote());
@@ -335,53 +417,31 @@ void ListViewLogic::loadNoteListModel(const QVector<NodeData> &noteList, const L
     selectFirstNote();
 }
 
-void ListViewLogic::onAddTagRequest(const QModelIndex &index, int tagId)
+void ListViewLogic::onAddTagRequest(const QModelIndexList &indexes, int tagId)
 {
-    if (index.isValid()) {
-        auto noteId = index.data(NoteListModel::NoteID).toInt();
-        auto isTemp = index.data(NoteListModel::NoteIsTemp).toBool();
-        if (!isTemp) {
-            emit requestAddTagDb(noteId, tagId);
-        }
-        auto tagIds = index.data(NoteListModel::NoteTagsList).value<QSet<int>>();
-        tagIds.insert(tagId);
-        m_listModel->setData(index, QVariant::fromValue(tagIds), NoteListModel::NoteTagsList);
-        m_listView->closePersistentEditorC(index);
-        m_listView->openPersistentEditorC(index);
-        emit noteTagListChanged(noteId, tagIds);
-    } else {
-        qDebug() << __FUNCTION__ << "index is not valid";
-    }
+    setNotesHaveTag(indexes, tagId, true);
 }
 
-void ListViewLogic::onAddTagRequestD(int noteId, int tagId)
+void ListViewLogic::onAddTagRequestD(const QList<int> &noteIds, int tagId)
 {
-    auto index = m_listModel->getNoteIndex(noteId);
-    onAddTagRequest(index, tagId);
+    onAddTagRequest(m_listModel->getNoteIndexes(noteIds), tagId);
 }
 
-void ListViewLogic::onNoteMovedOut(int nodeId, int targetId)
+void ListViewLogic::onNotesMovedOut(const QList<int> &noteIds, const NodeData &target)
 {
-    auto index = m_listModel->getNoteIndex(nodeId);
-    if (index.isValid()) {
-        if ((!m_listViewInfo.isInTag && m_listViewInfo.parentFolderId != ROOT_FOLDER_ID && m_listViewInfo.parentFolderId != targetId)
-            || targetId == TRASH_FOLDER_ID) {
-            selectNoteDown();
-            m_listModel->removeNotes({ index });
-            if (m_listModel->rowCount() == 0) {
-                emit closeNoteEditor();
-            }
-        } else {
-            NodeData note;
-            QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, note), Q_ARG(int, nodeId));
-            if (note.id() != INVALID_NODE_ID) {
-                m_listView->closePersistentEditorC(index);
-                m_listModel->setNoteData(index, note);
-                m_listView->openPersistentEditorC(index);
-            } else {
-                qDebug() << __FUNCTION__ << "Note id" << nodeId << "not found!";
-            }
+    auto indexes = m_listModel->getNoteIndexes(noteIds);
+    if (indexes.isEmpty()) {
+        return;
+    }
+    if ((!m_listViewInfo.isInTag && m_listViewInfo.parentFolderId != ROOT_FOLDER_ID && m_listViewInfo.parentFolderId != target.id())
+        || target.id() == TRASH_FOLDER_ID) {
+        selectNoteDown();
+        m_listModel->removeNotes(indexes);
+        if (m_listModel->rowCount() == 0) {
+            emit closeNoteEditor();
         }
+    } else {
+        m_listModel->setNotesParentFolder(indexes, target);
     }
 }
 
@@ -409,7 +469,7 @@ void ListViewLogic::onNotesListInFolderRequested(int parentID, bool isRecursive,
         m_listViewInfo.currentNotesId.clear();
         m_listViewInfo.isInTag = false;
         m_listViewInfo.needCreateNewNote = false;
-        m_listViewInfo.currentTagList = {};
+        m_listViewInfo.tagFilter = {};
         m_listViewInfo.scrollToId = INVALID_NODE_ID;
         m_clearButton->show();
         emit requestSearchInDb(m_searchEdit->text(), m_listViewInfo);
@@ -418,18 +478,18 @@ void ListViewLogic::onNotesListInFolderRequested(int parentID, bool isRecursive,
     }
 }
 
-void ListViewLogic::onNotesListInTagsRequested(const QSet<int> &tagIds, bool newNote, int scrollToId)
+void ListViewLogic::onNotesListInTagsRequested(const TagFilter &filter, bool newNote, int scrollToId)
 {
     if (m_listViewInfo.isInSearch && !m_searchEdit->text().isEmpty()) {
         m_listViewInfo.parentFolderId = INVALID_NODE_ID;
         m_listViewInfo.currentNotesId.clear();
         m_listViewInfo.isInTag = true;
         m_listViewInfo.needCreateNewNote = false;
-        m_listViewInfo.currentTagList = tagIds;
+        m_listViewInfo.tagFilter = filter;
         m_listViewInfo.scrollToId = INVALID_NODE_ID;
         emit requestSearchInDb(m_searchEdit->text(), m_listViewInfo);
     } else {
-        emit requestNotesListInTags(tagIds, newNote, scrollToId);
+        emit requestNotesListInTags(filter, newNote, scrollToId);
     }
 }
 
@@ -450,22 +510,43 @@ void ListViewLogic::selectNotes(const QModelIndexList &indexes)
     onNotePressed(indexes);
 }
 
-void ListViewLogic::onRemoveTagRequest(const QModelIndex &index, int tagId)
+void ListViewLogic::onRemoveTagRequest(const QModelIndexList &indexes, int tagId)
+{
+    setNotesHaveTag(indexes, tagId, false);
+}
+
+void ListViewLogic::setNotesHaveTag(const QModelIndexList &indexes, int tagId, bool haveTag)
 {
-    if (index.isValid()) {
-        auto noteId = index.data(NoteListModel::NoteID).toInt();
-        auto isTemp = index.data(NoteListModel::NoteIsTemp).toBool();
-        if (!isTemp) {
-            emit requestRemoveTagDb(noteId, tagId);
+    QVector<int> noteIds;
+    noteIds.reserve(indexes.size());
+    for (const auto &index : indexes) {
+        if (!index.isValid()) {
+            qDebug() << __FUNCTION__ << "index is not valid";
+            continue;
+        }
+        if (!index.data(NoteListModel::NoteIsTemp).toBool()) {
+            noteIds.append(index.data(NoteListModel::NoteID).toInt());
+        }
+    }
+    if (!noteIds.isEmpty()) {
+        if (haveTag) {
+            emit requestAddTagToNotesDb(tagId, noteIds);
+        } else {
+            emit requestRemoveTagFromNotesDb(tagId, noteIds);
+        }
+    }
+    m_listModel->setNotesHaveTag(indexes, tagId, haveTag);
+    // only rows near the viewport have editors, see NoteListView::updateEditorsInViewport()
+    QSet<int> changedIds;
+    for (const auto &index : indexes) {
+        if (index.isValid()) {
+            changedIds.insert(index.data(NoteListModel::NoteID).toInt());
         }
-        auto tagIds = index.data(NoteListModel::NoteTagsList).value<QSet<int>>();
-        tagIds.remove(tagId);
-        m_listModel->setData(index, QVariant::fromValue(tagIds), NoteListModel::NoteTagsList);
-        m_listView->closePersistentEditorC(index);
-        m_listView->openPersistentEditorC(index);
-        emit noteTagListChanged(noteId, tagIds);
-    } else {
-        qDebug() << __FUNCTION__ << "index is not valid";
+    }
+    m_listView->updateEditorsInViewport(changedIds);
+    auto const currentIndex = m_listView->currentIndex();
+    if (currentIndex.isValid() && changedIds.contains(currentIndex.data(NoteListModel::NoteID).toInt())) {
+        emit noteTagListChanged(currentIndex.data(NoteListModel::NoteID).toInt(), currentIndex.data(NoteListModel::NoteTagsList).value<QSet<int>>());
     }
 }
 
@@ -497,88 +578,98 @@ void ListViewLogic::onNotePressed(const QModelIndexList &indexes)
 
 void ListViewLogic::deleteNoteRequestedI(const QModelIndexList &indexes)
 {
-    if (!indexes.empty()) {
+    QVector<int> ids;
+    QList<QPersistentModelIndex> persistentIndexes;
+    for (const auto &index : std::as_const(indexes)) {
+        if (index.isValid()) {
+            ids.append(index.data(NoteListModel::NoteID).toInt());
+            persistentIndexes.append(index);
+        }
+    }
+    if (ids.isEmpty()) {
+        return;
+    }
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getNodes(ids), [this, persistentIndexes](const QVector<NodeData> &notes) {
         bool isInTrash = false;
         QVector<NodeData> needDelete;
         QModelIndexList needDeleteI;
-        for (const auto &index : std::as_const(indexes)) {
-            if (index.isValid()) {
-                auto id = index.data(NoteListModel::NoteID).toInt();
-                NodeData note;
-                QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, note), Q_ARG(int, id));
-                if (note.parentId() == TRASH_FOLDER_ID) {
-                    isInTrash = true;
-                }
-                needDeleteI.append(index);
-                needDelete.append(note);
+        for (int i = 0; i < notes.size(); ++i) {
+            // rows removed while the notes were being fetched are left alone
+            if (!persistentIndexes[i].isValid()) {
+                continue;
             }
+            if (notes[i].parentId() == TRASH_FOLDER_ID) {
+                isInTrash = true;
+            }
+            needDeleteI.append(persistentIndexes[i]);
+            needDelete.append(notes[i]);
+        }
+        if (needDeleteI.isEmpty()) {
+            return;
         }
         if (isInTrash) {
             auto btn = QMessageBox::question(nullptr, "Are you sure you want to delete this note permanently",
                                              "Are you sure you want to delete this note permanently? It will not be "
                                              "recoverable.");
-            if (btn == QMessageBox::Yes) {
-                selectNoteDown();
-                bool needClose = false;
-                if (m_listModel->rowCount() == needDeleteI.size()) {
-                    needClose = true;
-                }
-                m_listModel->removeNotes(needDeleteI);
-                if (needClose) {
-                    emit closeNoteEditor();
-                }
-                for (const auto &note : std::as_const(needDelete)) {
-                    emit requestRemoveNoteDb(note);
-                }
-            }
-        } else {
-            selectNoteDown();
-            bool needClose = false;
-            if (m_listModel->rowCount() == needDeleteI.size()) {
-                needClose = true;
-            }
-            m_listModel->removeNotes(needDeleteI);
-            if (needClose) {
-                emit closeNoteEditor();
-            }
-            for (const auto &note : std::as_const(needDelete)) {
-                emit requestRemoveNoteDb(note);
+            if (btn != QMessageBox::Yes) {
+                return;
             }
         }
-    }
+        selectNoteDown();
+        bool needClose = false;
+        if (m_listModel->rowCount() == needDeleteI.size()) {
+            needClose = true;
+        }
+        m_listModel->removeNotes(needDeleteI);
+        if (needClose) {
+            emit closeNoteEditor();
+        }
+        for (const auto &note : std::as_const(needDelete)) {
+            emit requestRemoveNoteDb(note);
+        }
+    });
 }
 
 void ListViewLogic::restoreNotesRequestedI(const QModelIndexList &indexes)
 {
-    QModelIndexList needRestoredI;
-    QSet<int> needRestored;
+    QVector<int> ids;
+    QList<QPersistentModelIndex> persistentIndexes;
     for (const auto &index : std::as_const(indexes)) {
         if (index.isValid()) {
-            auto id = index.data(NoteListModel::NoteID).toInt();
-            NodeData note;
-            QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, note), Q_ARG(int, id));
+            ids.append(index.data(NoteListModel::NoteID).toInt());
+            persistentIndexes.append(index);
+        }
+    }
+    // the default notes folder rides along as the last node
+    ids.append(DEFAULT_NOTES_FOLDER_ID);
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getNodes(ids), [this, persistentIndexes](const QVector<NodeData> &nodes) {
+        QModelIndexList needRestoredI;
+        QSet<int> needRestored;
+        for (int i = 0; i < persistentIndexes.size(); ++i) {
+            if (!persistentIndexes[i].isValid()) {
+                continue;
+            }
+            auto const &note = nodes[i];
             if (note.parentId() == TRASH_FOLDER_ID) {
-                needRestoredI.append(index);
+                needRestoredI.append(persistentIndexes[i]);
                 needRestored.insert(note.id());
             } else {
-                qDebug() << "Note id" << id << "is currently not in Trash";
+                qDebug() << "Note id" << note.id() << "is currently not in Trash";
             }
         }
-    }
-    bool needClose = false;
-    if (m_listModel->rowCount() == needRestoredI.size()) {
-        needClose = true;
-    }
-    m_listModel->removeNotes(needRestoredI);
-    if (needClose) {
-        emit closeNoteEditor();
-    }
-    NodeData defaultNotesFolder;
-    QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, defaultNotesFolder),
-                              Q_ARG(int, DEFAULT_NOTES_FOLDER_ID));
-    for (const auto &id : std::as_const(needRestored)) {
-        emit requestMoveNoteDb(id, defaultNotesFolder);
-    }
+        bool needClose = false;
+        if (m_listModel->rowCount() == needRestoredI.size()) {
+            needClose = true;
+        }
+        m_listModel->removeNotes(needRestoredI);
+        if (needClose) {
+            emit closeNoteEditor();
+        }
+        auto const &defaultNotesFolder = nodes.last();
+        for (const auto &id : std::as_const(needRestored)) {
+            emit requestMoveNoteDb(id, defaultNotesFolder);
+        }
+    });
 }
 
 void ListViewLogic::updateListViewLabel()
@@ -590,17 +681,25 @@ void ListViewLogic::updateListViewLabel()
     } else if ((!m_listViewInfo.isInTag) && m_listViewInfo.parentFolderId == TRASH_FOLDER_ID) {
         l1 = "Trash";
     } else if (!m_listViewInfo.isInTag) {
-        NodeData parentFolder;
-        QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, parentFolder),
-                                  Q_ARG(int, m_listViewInfo.parentFolderId));
-        l1 = parentFolder.fullTitle();
+        auto folderId = m_listViewInfo.parentFolderId;
+        DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getNode(folderId), [this, folderId](const NodeData &parentFolder) {
+            // a later update already took over the label
+            if (m_listViewInfo.isInTag || m_listViewInfo.parentFolderId != folderId) {
+                return;
+            }
+            emit listViewLabelChanged(parentFolder.fullTitle(), QString::number(m_listModel->rowCount()));
+        });
+        return;
     } else {
-        if (m_listViewInfo.currentTagList.empty()) {
+        const auto &filter = m_listViewInfo.tagFilter;
+        if (filter.isEmpty()) {
             l1 = "Tags ...";
-        } else if (m_listViewInfo.currentTagList.size() > 1) {
-            l1 = "Multiple tags ...";
+        } else if (filter.tagIds.size() > 1) {
+            l1 = QStringLiteral("%1 of %2 tags").arg(filter.mode == TagFilterMode::All ? "All" : "Any").arg(filter.tagIds.size());
+        } else if (filter.tagIds.isEmpty()) {
+            l1 = "All Notes";
         } else {
-            int tagId = *m_listViewInfo.currentTagList.begin();
+            int tagId = *filter.tagIds.begin();
             if (!m_tagPool->contains(tagId)) {
                 l1 = "Tags ...";
             } else {
@@ -608,6 +707,9 @@ void ListViewLogic::updateListViewLabel()
                 l1 = tag.name();
             }
         }
+        if (!filter.excludedTagIds.isEmpty()) {
+            l1 += QStringLiteral(", excluding %1").arg(filter.excludedTagIds.size());
+        }
     }
     l2 = QString::number(m_listModel->rowCount());
     emit listViewLabelChanged(l1, l2);
@@ -615,20 +717,8 @@ void ListViewLogic::updateListViewLabel()
 
 void ListViewLogic::onRowCountChanged()
 {
-    m_listView->closeAllEditor();
     m_listDelegate->clearSizeMap();
-    for (int i = 0; i < m_listModel->rowCount(); ++i) {
-        auto index = m_listModel->index(i, 0);
-        auto y = m_listView->visualRect(index).y();
-        auto range = abs(m_listView->viewport()->height());
-        if (y < -range) {
-            continue;
-        }
-        if (y > 2 * range) {
-            break;
-        }
-        m_listView->openPersistentEditorC(index);
-    }
+    m_listView->updateEditorsInViewport();
 }
 
 void ListViewLogic::onNoteDoubleClicked(const QModelIndex &index)
@@ -7,6 +7,8 @@
 #include "dbmanager.h"
 #include "editorsettingsoptions.h"
 #include <QModelIndex>
+#include <QMutex>
+#include <functional>
 
 class NoteListView;
 class NoteListModel;
@@ -40,17 +42,18 @@ public slots:
     void selectNoteDown();
     void onSearchEditTextChanged(const QString &keyword);
     void clearSearch(bool createNewNote = false, int scrollToId = INVALID_NODE_ID);
-    void onAddTagRequestD(int noteId, int tagId);
-    void onNoteMovedOut(int nodeId, int targetId);
+    void onAddTagRequestD(const QList<int> &noteIds, int tagId);
+    void onNotesMovedOut(const QList<int> &noteIds, const NodeData &target);
     void setLastSelectedNote();
     void loadLastSelectedNoteRequested();
     void onNotesListInFolderRequested(int parentID, bool isRecursive, bool newNote, int scrollToId);
-    void onNotesListInTagsRequested(const QSet<int> &tagIds, bool newNote, int scrollToId);
+    void onNotesListInTagsRequested(const TagFilter &filter, bool newNote, int scrollToId);
     void selectNotes(const QModelIndexList &indexes);
 signals:
     void showNotesInEditor(const QVector<NodeData> &notesData);
     void requestAddTagDb(int noteId, int tagId);
-    void requestRemoveTagDb(int noteId, int tagId);
+    void requestAddTagToNotesDb(int tagId, const QVector<int> &noteIds);
+    void requestRemoveTagFromNotesDb(int tagId, const QVector<int> &noteIds);
     void requestRemoveNoteDb(const NodeData &noteData);
     void requestMoveNoteDb(int noteId, const NodeData &targetFolder);
     void requestHighlightSearch();
@@ -64,12 +67,12 @@ signals:
     void listViewLabelChanged(const QString &label1, const QString &label2);
     void setNewNoteButtonVisible(bool visible);
     void requestNotesListInFolder(int parentID, bool isRecursive, bool newNote, int scrollToId);
-    void requestNotesListInTags(const QSet<int> &tagIds, bool newNote, int scrollToId);
+    void requestNotesListInTags(const TagFilter &filter, bool newNote, int scrollToId);
 
 private slots:
     void loadNoteListModel(const QVector<NodeData> &noteList, const ListViewInfo &inf);
-    void onAddTagRequest(const QModelIndex &index, int tagId);
-    void onRemoveTagRequest(const QModelIndex &index, int tagId);
+    void onAddTagRequest(const QModelIndexList &indexes, int tagId);
+    void onRemoveTagRequest(const QModelIndexList &indexes, int tagId);
     void onNotePressed(const QModelIndexList &indexes);
     void deleteNoteRequestedI(const QModelIndexList &indexes);
     void restoreNotesRequestedI(const QModelIndexList &indexes);
@@ -80,6 +83,9 @@ private slots:
     void onListViewClicked();
 
 private:
+    void setNotesHaveTag(const QModelIndexList &indexes, int tagId, bool haveTag);
+    void postNotesListRequest(bool newNote, int scrollToId, std::function<void(bool, int)> request);
+
     NoteListView *m_listView;
     NoteListModel *m_listModel;
     QLineEdit *m_searchEdit;
@@ -92,6 +98,10 @@ private:
 
     int m_needLoadSavedState;
     QSet<int> m_lastSelectedNotes;
+    // flags of the list requests not run yet, see postNotesListRequest()
+    QMutex m_pendingListMutex;
+    bool m_pendingListNewNote;
+    int m_pendingListScrollToId;
 };
 
 #endif // LISTVIEWLOGIC_H
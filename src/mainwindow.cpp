@@ -11,13 +11,16 @@
 #include "listviewlogic.h"
 #include "noteeditorlogic.h"
 #include "tagpool.h"
+#include "nodeidpool.h"
 #include "splitterstyle.h"
 #include "editorsettingsoptions.h"
 #include "fontloader.h"
+#include "dbmanagerasync.h"
 #include <utils.h>
 
 #include <QScrollBar>
 #include <QShortcut>
+#include <QListWidget>
 #include <QTextStream>
 #include <QScrollArea>
 #include <QtConcurrent>
@@ -70,7 +73,10 @@ MainWindow::MainWindow(QWidget *parent)
 #endif
       m_editorSettingsQuickView(nullptr),
       m_editorSettingsWidget(new QWidget(this)),
+      m_outlinePopup(nullptr),
+      m_largeNoteBanner(nullptr),
       m_tagPool(nullptr),
+      m_nodeIdPool(nullptr),
       m_dbManager(nullptr),
       m_dbThread(nullptr),
       m_aboutWindow(this),
@@ -84,6 +90,7 @@ MainWindow::MainWindow(QWidget *parent)
       m_isTemp(false),
       m_isListViewScrollBarHidden(true),
       m_isOperationRunning(false),
+      m_isCreatingNewNote(false),
 #if defined(UPDATE_CHECKER)
       m_dontShowUpdateWindow(false),
 #endif
@@ -601,6 +608,7 @@ void MainWindow::setupKeyboardShortcuts()
     connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_5), this), &QShortcut::activated, this, [=]() { setHeading(5); });
     connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_6), this), &QShortcut::activated, this, [=]() { setHeading(6); });
     new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_Backslash), this, SLOT(resetBlockFormat()));
+    new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_O), this, SLOT(showOutlinePopup()));
 
     auto *shortcut = new QxtGlobalShortcut(this);
 #if defined(Q_OS_MACOS)
@@ -801,6 +809,7 @@ void MainWindow::setupSignalsSlots()
     connect(m_noteEditorLogic, &NoteEditorLogic::setVisibilityOfFrameRightNonEditor, this, [this](bool vl) { setVisibilityOfFrameRightNonEditor(vl); });
     connect(m_noteEditorLogic, &NoteEditorLogic::moveNoteToListViewTop, m_listViewLogic, &ListViewLogic::moveNoteToTop);
     connect(m_noteEditorLogic, &NoteEditorLogic::updateNoteDataInList, m_listViewLogic, &ListViewLogic::setNoteData);
+    connect(m_noteEditorLogic, &NoteEditorLogic::largeNoteModeChanged, m_largeNoteBanner, &QWidget::setVisible);
     connect(m_noteEditorLogic, &NoteEditorLogic::deleteNoteRequested, m_listViewLogic, &ListViewLogic::deleteNoteRequested);
     connect(m_listViewLogic, &ListViewLogic::noteTagListChanged, m_noteEditorLogic, &NoteEditorLogic::onNoteTagListChanged);
     connect(m_noteEditorLogic, &NoteEditorLogic::noteEditClosed, m_listViewLogic, &ListViewLogic::onNoteEditClosed);
@@ -820,7 +829,7 @@ void MainWindow::setupSignalsSlots()
         m_ui->frameRightTop->show();
     });
     connect(m_listViewLogic, &ListViewLogic::requestClearSearchUI, this, &MainWindow::clearSearch);
-    connect(m_treeViewLogic, &TreeViewLogic::addNoteToTag, m_listViewLogic, &ListViewLogic::onAddTagRequestD);
+    connect(m_treeViewLogic, &TreeViewLogic::addNotesToTag, m_listViewLogic, &ListViewLogic::onAddTagRequestD);
     connect(m_listViewLogic, &ListViewLogic::listViewLabelChanged, this, [this](const QString &l1, const QString &l2) {
         m_ui->listviewLabel1->setText(l1);
         m_ui->listviewLabel2->setText(l2);
@@ -828,13 +837,21 @@ void MainWindow::setupSignalsSlots()
     });
     connect(m_toggleTreeViewButton, &QPushButton::clicked, this, &MainWindow::toggleFolderTree);
     connect(m_dbManager, &DBManager::showErrorMessage, this, &MainWindow::showErrorMessage, Qt::QueuedConnection);
+    connect(
+            m_dbManager, &DBManager::notesExported, this,
+            [](const QString &) {
+                QMessageBox msgBox;
+                msgBox.setText("Notes exported successfully!");
+                msgBox.exec();
+            },
+            Qt::QueuedConnection);
     connect(m_listViewLogic, &ListViewLogic::requestNewNote, this, &MainWindow::onNewNoteButtonClicked);
     connect(m_listViewLogic, &ListViewLogic::moveNoteRequested, this, [this](int id, int target) {
         m_treeViewLogic->onMoveNodeRequested(id, target);
         m_treeViewLogic->openFolder(target);
     });
     connect(m_listViewLogic, &ListViewLogic::setNewNoteButtonVisible, this, [this](bool visible) { m_ui->newNoteButton->setVisible(visible); });
-    connect(m_treeViewLogic, &TreeViewLogic::noteMoved, m_listViewLogic, &ListViewLogic::onNoteMovedOut);
+    connect(m_treeViewLogic, &TreeViewLogic::notesMoved, m_listViewLogic, &ListViewLogic::onNotesMovedOut);
 
     connect(m_listViewLogic, &ListViewLogic::requestClearSearchDb, this, &MainWindow::setNoteListLoading);
     connect(m_treeView, &NodeTreeView::loadNotesInTagsRequested, this, &MainWindow::setNoteListLoading);
@@ -1188,6 +1205,20 @@ void MainWindow::setupTextEdit()
     // and we don't want people to past rich text and get something wrong.
     // In future versions, where we'll support rich text, we'll need to change that.
     m_textEdit->setAcceptRichText(false);
+
+    // shown above the editor while a large note is open without highlighting
+    // and undo
+    m_largeNoteBanner = new QFrame(this);
+    auto *bannerLayout = new QHBoxLayout(m_largeNoteBanner);
+    bannerLayout->setContentsMargins(m_noteEditorLogic->currentMinimumEditorPadding(), 4, m_noteEditorLogic->currentMinimumEditorPadding(), 4);
+    auto *bannerLabel = new QLabel(tr("This note is very large. Highlighting and undo are off to keep editing fast."), m_largeNoteBanner);
+    bannerLabel->setWordWrap(true);
+    auto *fullFeaturesButton = new QPushButton(tr("Turn On"), m_largeNoteBanner);
+    bannerLayout->addWidget(bannerLabel, 1);
+    bannerLayout->addWidget(fullFeaturesButton);
+    m_largeNoteBanner->hide();
+    m_ui->verticalLayout_textEdit->insertWidget(m_ui->verticalLayout_textEdit->indexOf(m_textEdit), m_largeNoteBanner);
+    connect(fullFeaturesButton, &QPushButton::clicked, m_noteEditorLogic, &NoteEditorLogic::enableFullFeatures);
 }
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
@@ -1620,6 +1651,12 @@ void MainWindow::setupModelView()
 {
     m_listView = m_ui->listView;
     m_tagPool = new TagPool(m_dbManager, this);
+    m_nodeIdPool = new NodeIdPool(m_dbManager, this);
+    connect(m_nodeIdPool, &NodeIdPool::idsAvailable, this, [this] {
+        if (m_isCreatingNewNote) {
+            createNewNote();
+        }
+    });
     m_listModel = new NoteListModel(m_listView);
     m_listView->setTagPool(m_tagPool);
     m_listView->setModel(m_listModel);
@@ -1634,6 +1671,9 @@ void MainWindow::setupModelView()
     m_noteEditorLogic = new NoteEditorLogic(m_textEdit, m_editorDateLabel, m_searchEdit, m_ui->tagListView, m_tagPool, m_dbManager, this);
 #endif
     m_editorSettingsQuickView.rootContext()->setContextProperty("noteEditorLogic", m_noteEditorLogic);
+    m_noteEditorLogic->setDocumentCacheLimits(m_settingsDatabase->value(QStringLiteral("editorDocumentCacheCount"), 8).toInt(),
+                                              m_settingsDatabase->value(QStringLiteral("editorDocumentCacheMegabytes"), 64).toLongLong() * 1024 * 1024);
+    m_noteEditorLogic->setUndoMemoryLimit(m_settingsDatabase->value(QStringLiteral("editorUndoMegabytes"), 32).toLongLong() * 1024 * 1024);
 }
 
 /*!
@@ -2346,48 +2386,56 @@ void MainWindow::onClearButtonClicked()
 void MainWindow::createNewNote()
 {
     m_listView->scrollToTop();
-    QModelIndex newNoteIndex;
-    if (!m_noteEditorLogic->isTempNote()) {
-        // clear the textEdit
-        m_noteEditorLogic->closeEditor();
-
-        NodeData tmpNote;
-        tmpNote.setNodeType(NodeData::Type::Note);
-        QDateTime noteDate = QDateTime::currentDateTime();
-        tmpNote.setCreationDateTime(noteDate);
-        tmpNote.setLastModificationDateTime(noteDate);
-        tmpNote.setFullTitle(QStringLiteral("New Note"));
-        auto inf = m_listViewLogic->listViewInfo();
-        if ((!inf.isInTag) && (inf.parentFolderId > ROOT_FOLDER_ID)) {
-            NodeData parent;
-            QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, parent), Q_ARG(int, inf.parentFolderId));
-            if (parent.nodeType() == NodeData::Type::Folder) {
-                tmpNote.setParentId(parent.id());
-                tmpNote.setParentName(parent.fullTitle());
-            } else {
-                tmpNote.setParentId(DEFAULT_NOTES_FOLDER_ID);
-                tmpNote.setParentName("Notes");
-            }
-        } else {
-            tmpNote.setParentId(DEFAULT_NOTES_FOLDER_ID);
-            tmpNote.setParentName("Notes");
-        }
-        int noteId = INVALID_NODE_ID;
-        QMetaObject::invokeMethod(m_dbManager, "nextAvailableNodeId", Qt::BlockingQueuedConnection, Q_RETURN_ARG(int, noteId));
-        tmpNote.setId(noteId);
-        tmpNote.setIsTempNote(true);
-        if (inf.isInTag) {
-            tmpNote.setTagIds(inf.currentTagList);
-        }
-        // insert the new note to NoteListModel
-        newNoteIndex = m_listModel->insertNote(tmpNote, 0);
-
-        // update the editor
-        m_noteEditorLogic->showNotesInEditor({ tmpNote });
-    } else {
-        newNoteIndex = m_listModel->getNoteIndex(m_noteEditorLogic->currentEditingNoteId());
+    if (m_noteEditorLogic->isTempNote()) {
+        auto newNoteIndex = m_listModel->getNoteIndex(m_noteEditorLogic->currentEditingNoteId());
         m_listView->animateAddedRow({ newNoteIndex });
+        // update the current selected index
+        m_listView->setCurrentIndexC(newNoteIndex);
+        m_textEdit->setFocus();
+        return;
+    }
+    int noteId = m_nodeIdPool->takeId();
+    if (noteId == INVALID_NODE_ID) {
+        // no ids reserved yet, createNewNote() runs again once they are
+        m_isCreatingNewNote = true;
+        return;
     }
+    m_isCreatingNewNote = false;
+    // clear the textEdit
+    m_noteEditorLogic->closeEditor();
+
+    NodeData tmpNote;
+    tmpNote.setNodeType(NodeData::Type::Note);
+    QDateTime noteDate = QDateTime::currentDateTime();
+    tmpNote.setCreationDateTime(noteDate);
+    tmpNote.setLastModificationDateTime(noteDate);
+    tmpNote.setFullTitle(QStringLiteral("New Note"));
+    auto inf = m_listViewLogic->listViewInfo();
+    // the folder being listed is selected in the tree, so it is loaded there
+    QModelIndex parentIndex;
+    if ((!inf.isInTag) && (inf.parentFolderId > ROOT_FOLDER_ID)) {
+        parentIndex = m_treeModel->loadedFolderIndexFromId(inf.parentFolderId);
+    }
+    if (parentIndex.isValid()) {
+        tmpNote.setParentId(inf.parentFolderId);
+        tmpNote.setParentName(parentIndex.data(NodeItem::Roles::DisplayText).toString());
+    } else {
+        tmpNote.setParentId(DEFAULT_NOTES_FOLDER_ID);
+        tmpNote.setParentName("Notes");
+    }
+    tmpNote.setId(noteId);
+    tmpNote.setIsTempNote(true);
+    if (inf.isInTag) {
+        // excluded tags would hide the note from the list it is created in
+        auto tagIds = inf.tagFilter.tagIds;
+        tagIds.subtract(inf.tagFilter.excludedTagIds);
+        tmpNote.setTagIds(tagIds);
+    }
+    // insert the new note to NoteListModel
+    auto newNoteIndex = m_listModel->insertNote(tmpNote, 0);
+
+    // update the editor
+    m_noteEditorLogic->showNotesInEditor({ tmpNote });
     // update the current selected index
     m_listView->setCurrentIndexC(newNoteIndex);
     m_textEdit->setFocus();
@@ -2567,6 +2615,7 @@ void MainWindow::quitApplication()
     }
 
     m_noteEditorLogic->saveNoteToDB();
+    m_noteEditorLogic->saveNoteOutline();
 
 #if defined(UPDATE_CHECKER)
     m_settingsDatabase->setValue(QStringLiteral("dontShowUpdateWindow"), m_dontShowUpdateWindow);
@@ -2590,6 +2639,9 @@ void MainWindow::quitApplication()
     m_settingsDatabase->sync();
 
     m_noteEditorLogic->closeEditor();
+    // the database thread stops with its event loop, so wait until it took
+    // the saves queued so far
+    QMetaObject::invokeMethod(m_dbManager, []() {}, Qt::BlockingQueuedConnection);
 
     QCoreApplication::quit();
 }
@@ -2751,11 +2803,8 @@ void MainWindow::exportToPlainTextFiles(const QString &extension)
         return;
     }
 
-    m_dbManager->exportNotes(dir, extension);
-
-    QMessageBox msgBox;
-    msgBox.setText("Notes exported successfully!");
-    msgBox.exec();
+    // runs as background work on the database thread, notesExported() reports back
+    QMetaObject::invokeMethod(m_dbManager, "exportNotes", Qt::QueuedConnection, Q_ARG(QString, dir), Q_ARG(QString, extension));
 }
 
 void MainWindow::toggleFolderTree()
@@ -3954,6 +4003,69 @@ void MainWindow::setHeading(int level)
     cursor.insertText(newText);
 }
 
+/*!
+ * \brief MainWindow::showOutlinePopup
+ * Lists the headings of the note in the editor to jump to. A big note still
+ * being opened lists the headings stored with it.
+ */
+void MainWindow::showOutlinePopup()
+{
+    auto const noteId = m_noteEditorLogic->currentEditingNoteId();
+    if (noteId == INVALID_NODE_ID) {
+        return;
+    }
+    if (m_noteEditorLogic->isNoteDocumentShown()) {
+        showOutline(m_noteEditorLogic->currentOutline());
+        return;
+    }
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getNoteOutline(noteId), [this, noteId](const QVector<NoteHeading> &outline) {
+        if (m_noteEditorLogic->currentEditingNoteId() == noteId) {
+            showOutline(outline);
+        }
+    });
+}
+
+/*!
+ * \brief MainWindow::showOutline
+ * Shows the headings over the editor, indented by level, with the one the
+ * cursor is under selected
+ * \param outline
+ */
+void MainWindow::showOutline(const QVector<NoteHeading> &outline)
+{
+    if (outline.isEmpty()) {
+        return;
+    }
+    if (m_outlinePopup == nullptr) {
+        m_outlinePopup = new QListWidget(this);
+        m_outlinePopup->setWindowFlags(Qt::Popup);
+        m_outlinePopup->setUniformItemSizes(true);
+        auto const jump = [this](QListWidgetItem *item) {
+            m_outlinePopup->hide();
+            m_noteEditorLogic->jumpToBlock(item->data(Qt::UserRole).toInt());
+        };
+        connect(m_outlinePopup, &QListWidget::itemClicked, this, jump);
+        connect(m_outlinePopup, &QListWidget::itemActivated, this, jump);
+    }
+    m_outlinePopup->clear();
+    m_outlinePopup->setFont(m_textEdit->font());
+    auto const cursorBlock = m_noteEditorLogic->isNoteDocumentShown() ? m_textEdit->textCursor().blockNumber() : -1;
+    int currentRow = 0;
+    for (int i = 0; i < outline.size(); ++i) {
+        auto *item = new QListWidgetItem(QStringLiteral("    ").repeated(outline[i].level - 1) + outline[i].title, m_outlinePopup);
+        item->setData(Qt::UserRole, outline[i].blockNumber);
+        if (outline[i].blockNumber <= cursorBlock) {
+            currentRow = i;
+        }
+    }
+    m_outlinePopup->setCurrentRow(currentRow);
+    auto const width = m_textEdit->width() / 2;
+    m_outlinePopup->resize(width, m_textEdit->height() * 2 / 3);
+    m_outlinePopup->move(m_textEdit->mapToGlobal(QPoint((m_textEdit->width() - width) / 2, 0)));
+    m_outlinePopup->show();
+    m_outlinePopup->setFocus();
+}
+
 /*!
  * \brief MainWindow::setUseNativeWindowFrame
  * \param useNativeWindowFrame
@@ -63,7 +63,9 @@ class TreeViewLogic;
 class ListViewLogic;
 class NoteEditorLogic;
 class TagPool;
+class NodeIdPool;
 class SplitterStyle;
+class QListWidget;
 
 #if defined(Q_OS_WINDOWS) || defined(Q_OS_WIN)
 // #if defined(__MINGW32__) || defined(__GNUC__)
@@ -173,7 +175,10 @@ private:
 #endif
     QQuickView m_editorSettingsQuickView;
     QWidget *m_editorSettingsWidget;
+    QListWidget *m_outlinePopup;
+    QFrame *m_largeNoteBanner;
     TagPool *m_tagPool;
+    NodeIdPool *m_nodeIdPool;
     DBManager *m_dbManager;
     QThread *m_dbThread;
     SplitterStyle *m_splitterStyle;
@@ -196,6 +201,7 @@ private:
     bool m_isTemp;
     bool m_isListViewScrollBarHidden;
     bool m_isOperationRunning;
+    bool m_isCreatingNewNote;
 #if defined(UPDATE_CHECKER)
     bool m_dontShowUpdateWindow;
 #endif
@@ -296,6 +302,7 @@ private:
     void dropShadow(QPainter &painter, ShadowType type, ShadowSide side);
     void fillRectWithGradient(QPainter &painter, QRect rect, QGradient &gradient);
     void resizeAndPositionEditorSettingsWindow();
+    void showOutline(const QVector<NoteHeading> &outline);
     void getPaymentDetailsSignalsSlots();
     void verifyLicenseSignalsSlots();
     void getSubscriptionStatus();
@@ -343,6 +350,7 @@ private slots:
     void increaseHeading();
     void decreaseHeading();
     void setHeading(int level);
+    void showOutlinePopup();
     void setUseNativeWindowFrame(bool useNativeWindowFrame);
     void setHideToTray(bool enabled);
     void toggleStayOnTop();
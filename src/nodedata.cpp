@@ -1,8 +1,14 @@
 #include "nodedata.h"
 #include <QDataStream>
+#include <limits>
+
+namespace {
+auto constexpr INVALID_MSECS = std::numeric_limits<qint64>::min();
+} // namespace
 
 NodeData::NodeData()
     : m_id{ INVALID_NODE_ID },
+      m_lastModificationMSecs(INVALID_MSECS),
       m_isModified(false),
       m_isSelected(false),
       m_scrollBarPosition(0),
@@ -13,7 +19,8 @@ NodeData::NodeData()
       m_isPinnedNote{ false },
       m_tagListScrollBarPos{ 0 },
       m_relativePosAN{ 0 },
-      m_childNotesCount{ 0 }
+      m_childNotesCount{ 0 },
+      m_isContentPrefix{ false }
 {
 }
 
@@ -37,14 +44,27 @@ void NodeData::setFullTitle(const QString &fullTitle)
     m_fullTitle = fullTitle;
 }
 
-QDateTime const &NodeData::lastModificationdateTime() const
+QDateTime NodeData::lastModificationdateTime() const
 {
-    return m_lastModificationDateTime;
+    if (m_lastModificationMSecs == INVALID_MSECS) {
+        return QDateTime();
+    }
+    return QDateTime::fromMSecsSinceEpoch(m_lastModificationMSecs);
 }
 
 void NodeData::setLastModificationDateTime(const QDateTime &lastModificationdateTime)
 {
-    m_lastModificationDateTime = lastModificationdateTime;
+    m_lastModificationMSecs = lastModificationdateTime.isValid() ? lastModificationdateTime.toMSecsSinceEpoch() : INVALID_MSECS;
+}
+
+qint64 NodeData::lastModificationMSecs() const
+{
+    return m_lastModificationMSecs;
+}
+
+void NodeData::setLastModificationMSecs(qint64 lastModificationMSecs)
+{
+    m_lastModificationMSecs = lastModificationMSecs;
 }
 
 QString const &NodeData::content() const
@@ -207,6 +227,16 @@ void NodeData::setChildNotesCount(int newChildCount)
     m_childNotesCount = newChildCount;
 }
 
+bool NodeData::isContentPrefix() const
+{
+    return m_isContentPrefix;
+}
+
+void NodeData::setIsContentPrefix(bool newIsContentPrefix)
+{
+    m_isContentPrefix = newIsContentPrefix;
+}
+
 QDateTime NodeData::creationDateTime() const
 {
     return m_creationDateTime;
@@ -249,3 +279,13 @@ QDataStream &operator>>(QDataStream &stream, NodeData *&nodeData)
     nodeData->setContent(content);
     return stream;
 }
+
+QDataStream &operator<<(QDataStream &stream, const NoteHeading &heading)
+{
+    return stream << heading.level << heading.title << heading.blockNumber;
+}
+
+QDataStream &operator>>(QDataStream &stream, NoteHeading &heading)
+{
+    return stream >> heading.level >> heading.title >> heading.blockNumber;
+}
@@ -10,6 +10,11 @@ auto constexpr INVALID_NODE_ID = -1;
 auto constexpr ROOT_FOLDER_ID = 0;
 auto constexpr TRASH_FOLDER_ID = 1;
 auto constexpr DEFAULT_NOTES_FOLDER_ID = 2;
+// notes longer than this (in characters) are large notes: note lists only
+// keep the start of them, for the preview, and the editor opens them with
+// highlighting and undo turned off
+auto constexpr LARGE_NOTE_SIZE = 4 * 1024 * 1024;
+auto constexpr NOTE_PREVIEW_SIZE = 4096;
 } // namespace
 
 class NodeData
@@ -25,8 +30,10 @@ public:
     QString const &fullTitle() const;
     void setFullTitle(const QString &fullTitle);
 
-    QDateTime const &lastModificationdateTime() const;
+    QDateTime lastModificationdateTime() const;
     void setLastModificationDateTime(const QDateTime &lastModificationdateTime);
+    qint64 lastModificationMSecs() const;
+    void setLastModificationMSecs(qint64 lastModificationMSecs);
 
     QDateTime creationDateTime() const;
     void setCreationDateTime(const QDateTime &creationDateTime);
@@ -79,10 +86,14 @@ public:
     int childNotesCount() const;
     void setChildNotesCount(int newChildCount);
 
+    // whether content() only holds the start of a large note
+    bool isContentPrefix() const;
+    void setIsContentPrefix(bool newIsContentPrefix);
+
 private:
     int m_id;
     QString m_fullTitle;
-    QDateTime m_lastModificationDateTime;
+    qint64 m_lastModificationMSecs; // msecs since epoch, stored as is to keep list sorting cheap
     QDateTime m_creationDateTime;
     QDateTime m_deletionDateTime;
     QString m_content;
@@ -100,11 +111,41 @@ private:
     int m_tagListScrollBarPos;
     int m_relativePosAN;
     int m_childNotesCount;
+    bool m_isContentPrefix;
 };
 
 Q_DECLARE_METATYPE(NodeData)
 
+// An edit of a note's content: `removed` characters at `position` were
+// replaced by `inserted`. Saved by DBManager::onNoteContentDeltasRequested()
+struct ContentDelta
+{
+    int position = 0;
+    int removed = 0;
+    QString inserted;
+};
+
+Q_DECLARE_METATYPE(ContentDelta)
+
+// A heading of a note's outline. The block number is the line it is on
+struct NoteHeading
+{
+    int level = 0;
+    QString title;
+    int blockNumber = 0;
+
+    bool operator==(const NoteHeading &other) const
+    {
+        return level == other.level && blockNumber == other.blockNumber && title == other.title;
+    }
+    bool operator!=(const NoteHeading &other) const { return !(*this == other); }
+};
+
+Q_DECLARE_METATYPE(NoteHeading)
+
 QDataStream &operator>>(QDataStream &stream, NodeData &nodeData);
 QDataStream &operator>>(QDataStream &stream, NodeData *&nodeData);
+QDataStream &operator<<(QDataStream &stream, const NoteHeading &heading);
+QDataStream &operator>>(QDataStream &stream, NoteHeading &heading);
 
 #endif // NODEDATA_H
@@ -0,0 +1,72 @@
+#include "nodeidpool.h"
+#include "dbmanager.h"
+#include "dbmanagerasync.h"
+
+namespace {
+auto constexpr BLOCK_SIZE = 256;
+// ask for the next block early enough that a burst of new notes never waits
+auto constexpr LOW_WATER_MARK = BLOCK_SIZE / 4;
+} // namespace
+
+NodeIdPool::NodeIdPool(DBManager *dbManager, QObject *parent)
+    : QObject(parent),
+      m_dbManager{ dbManager },
+      m_nextId{ INVALID_NODE_ID },
+      m_blockEnd{ INVALID_NODE_ID },
+      m_spareBlockStart{ INVALID_NODE_ID },
+      m_isReserving{ false },
+      m_generation{ 0 }
+{
+    connect(m_dbManager, &DBManager::nodeIdsReset, this, &NodeIdPool::onNodeIdsReset, Qt::QueuedConnection);
+}
+
+int NodeIdPool::takeId()
+{
+    if (m_nextId == m_blockEnd && m_spareBlockStart != INVALID_NODE_ID) {
+        m_nextId = m_spareBlockStart;
+        m_blockEnd = m_spareBlockStart + BLOCK_SIZE;
+        m_spareBlockStart = INVALID_NODE_ID;
+    }
+    int id = INVALID_NODE_ID;
+    if (m_nextId != m_blockEnd) {
+        id = m_nextId++;
+    }
+    if (m_blockEnd - m_nextId < LOW_WATER_MARK && m_spareBlockStart == INVALID_NODE_ID) {
+        reserveMore();
+    }
+    return id;
+}
+
+void NodeIdPool::onNodeIdsReset()
+{
+    ++m_generation;
+    m_nextId = m_blockEnd = m_spareBlockStart = INVALID_NODE_ID;
+    m_isReserving = false;
+    reserveMore();
+}
+
+void NodeIdPool::reserveMore()
+{
+    if (m_isReserving) {
+        return;
+    }
+    m_isReserving = true;
+    auto generation = m_generation;
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.reserveNodeIds(BLOCK_SIZE), [this, generation](int firstId) {
+        if (generation != m_generation) {
+            return;
+        }
+        m_isReserving = false;
+        if (firstId == INVALID_NODE_ID) {
+            return;
+        }
+        bool wasEmpty = m_nextId == m_blockEnd;
+        if (wasEmpty) {
+            m_nextId = firstId;
+            m_blockEnd = firstId + BLOCK_SIZE;
+            emit idsAvailable();
+        } else {
+            m_spareBlockStart = firstId;
+        }
+    });
+}
@@ -0,0 +1,38 @@
+#ifndef NODEIDPOOL_H
+#define NODEIDPOOL_H
+
+#include <QObject>
+
+class DBManager;
+
+// Node ids the GUI can hand out without a round trip to the database. They
+// come in blocks DBManager::reserveNodeIds() set aside up front, so a crash
+// or another connection can only leave gaps in the ids, never duplicates.
+class NodeIdPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NodeIdPool(DBManager *dbManager, QObject *parent = nullptr);
+    // INVALID_NODE_ID until the first block arrived, idsAvailable() follows then
+    int takeId();
+
+signals:
+    void idsAvailable();
+
+private slots:
+    void onNodeIdsReset();
+
+private:
+    void reserveMore();
+
+    DBManager *m_dbManager;
+    int m_nextId;
+    int m_blockEnd;
+    // block that arrived while the current one still had ids left
+    int m_spareBlockStart;
+    bool m_isReserving;
+    // bumped on reset so blocks still in flight from before are dropped
+    int m_generation;
+};
+
+#endif // NODEIDPOOL_H
@@ -1,5 +1,6 @@
 #include "nodepath.h"
 #include "nodedata.h"
+#include <QDataStream>
 
 NodePath::NodePath(QString path) : m_path(std::move(path)) { }
 
@@ -29,3 +30,32 @@ QString NodePath::getTrashFolderPath()
 {
     return QStringLiteral("%1%2%1%3").arg(PATH_SEPARATOR).arg(ROOT_FOLDER_ID).arg(TRASH_FOLDER_ID);
 }
+
+QByteArray encodeNoteMimeData(const QList<int> &noteIds)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << static_cast<quint32>(noteIds.size());
+    for (const auto &id : noteIds) {
+        stream << static_cast<qint32>(id);
+    }
+    return data;
+}
+
+QList<int> decodeNoteMimeData(const QByteArray &data)
+{
+    QList<int> noteIds;
+    QDataStream stream(data);
+    quint32 count = 0;
+    stream >> count;
+    // never trust the header beyond what the payload can actually hold
+    noteIds.reserve(static_cast<int>(qMin<qsizetype>(count, data.size() / sizeof(qint32))));
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        qint32 id;
+        stream >> id;
+        if (stream.status() == QDataStream::Ok) {
+            noteIds.append(id);
+        }
+    }
+    return noteIds;
+}
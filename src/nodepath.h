@@ -2,12 +2,17 @@
 
 #include <QString>
 #include <QList>
+#include <QByteArray>
 
 auto constexpr PATH_SEPARATOR = '/';
 auto constexpr FOLDER_MIME = "application/x-foldernode";
 auto constexpr TAG_MIME = "application/x-tagnode";
 auto constexpr NOTE_MIME = "application/x-notenode";
 
+// NOTE_MIME payloads carry the dragged note ids as a packed binary list
+QByteArray encodeNoteMimeData(const QList<int> &noteIds);
+QList<int> decodeNoteMimeData(const QByteArray &data);
+
 class NodePath
 {
 public:
@@ -154,7 +154,9 @@ void NodeTreeDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opti
         } else {
             painter->setPen(m_titleColor);
         }
-        painter->setFont(m_titleFont);
+        auto titleFont = m_titleFont;
+        titleFont.setStrikeOut(isExcluded);
+        painter->setFont(titleFont);
         painter->drawText(nameRect, Qt::AlignLeft | Qt::AlignVCenter, displayName);
         auto childCountRect = option.rect;
         childCountRect.setLeft(nameRect.right() + 5);
@@ -263,11 +265,16 @@ void NodeTreeDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opti
     }
     case NodeItem::Type::TagItem: {
         paintBackgroundSelectable(painter, option, index);
+        auto isExcluded = static_cast<NodeTreeView *>(m_view)->isTagExcluded(index.data(NodeItem::Roles::NodeId).toInt());
         auto iconRect = QRect(option.rect.x() + 22, option.rect.y() + ((option.rect.height() - 14) / 2), 16, 16);
         auto tagColor = index.data(NodeItem::Roles::TagColor).toString();
         painter->setPen(QColor(tagColor));
         painter->setFont(font_loader::loadFont("Font Awesome 6 Free Solid", "", 16 + iconPointSizeOffset));
-        painter->drawText(iconRect, u8"\uf111"); // fa-circle
+        if (isExcluded) {
+            painter->drawText(iconRect, u8"\uf056"); // fa-circle-minus
+        } else {
+            painter->drawText(iconRect, u8"\uf111"); // fa-circle
+        }
         painter->setBrush(Qt::black);
         painter->setPen(Qt::black);
         QRect nameRect(option.rect);
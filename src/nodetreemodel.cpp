@@ -1,13 +1,29 @@
 #include "nodetreemodel.h"
+#include "dbmanagerasync.h"
 #include <QDebug>
 #include <QRegularExpression>
 #include <QMimeData>
+#include <QMetaObject>
+#include <QPointer>
 
 namespace {
 auto constexpr COLUMN_COUNT = 1;
 }
 
-NodeTreeItem::NodeTreeItem(const QHash<NodeItem::Roles, QVariant> &data, NodeTreeItem *parentItem) : m_itemData(data), m_parentItem(parentItem) { }
+NodeTreeItem::NodeTreeItem(NodeItem::Type type, NodeTreeItem *parentItem)
+    : m_parentItem(parentItem), m_row(0), m_type(type), m_id(0), m_relPos(0), m_childNotesCount(0), m_hasUnfetchedChildren(false)
+{
+}
+
+NodeTreeItem::NodeTreeItem(const QHash<NodeItem::Roles, QVariant> &data, NodeTreeItem *parentItem)
+    : NodeTreeItem(static_cast<NodeItem::Type>(data.value(NodeItem::Roles::ItemType).toInt()), parentItem)
+{
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        if (it.key() != NodeItem::Roles::ItemType) {
+            setData(it.key(), it.value());
+        }
+    }
+}
 
 NodeTreeItem::~NodeTreeItem()
 {
@@ -16,12 +32,14 @@ NodeTreeItem::~NodeTreeItem()
 
 void NodeTreeItem::appendChild(NodeTreeItem *child)
 {
+    child->m_row = m_childItems.size();
     m_childItems.append(child);
 }
 
 void NodeTreeItem::insertChild(int row, NodeTreeItem *child)
 {
     m_childItems.insert(row, child);
+    updateChildRows(row, m_childItems.size() - 1);
 }
 
 NodeTreeItem *NodeTreeItem::getChild(int row) const
@@ -38,6 +56,7 @@ void NodeTreeItem::removeChild(int row)
         return;
     }
     delete m_childItems.takeAt(row);
+    updateChildRows(row, m_childItems.size() - 1);
 }
 
 NodeTreeItem *NodeTreeItem::takeChildAt(int row)
@@ -45,7 +64,9 @@ NodeTreeItem *NodeTreeItem::takeChildAt(int row)
     if (row < 0 || row >= m_childItems.size()) {
         return nullptr;
     }
-    return m_childItems.takeAt(row);
+    auto *child = m_childItems.takeAt(row);
+    updateChildRows(row, m_childItems.size() - 1);
+    return child;
 }
 
 int NodeTreeItem::getChildCount() const
@@ -70,13 +91,12 @@ int NodeTreeItem::recursiveNodeCount() const
 void NodeTreeItem::recursiveUpdateFolderPath(const QString &oldP, const QString &newP)
 {
     {
-        auto type = static_cast<NodeItem::Type>(getData(NodeItem::Roles::ItemType).toInt());
-        if (type != NodeItem::Type::FolderItem) {
+        if (type() != NodeItem::Type::FolderItem) {
             return;
         }
-        auto currP = getData(NodeItem::Roles::AbsPath).toString();
+        auto currP = absolutePath();
         currP.replace(currP.indexOf(oldP), oldP.size(), newP);
-        setData(NodeItem::Roles::AbsPath, currP);
+        setAbsolutePath(currP);
     }
     for (auto &child : m_childItems) {
         child->recursiveUpdateFolderPath(oldP, newP);
@@ -85,12 +105,58 @@ void NodeTreeItem::recursiveUpdateFolderPath(const QString &oldP, const QString
 
 QVariant NodeTreeItem::getData(NodeItem::Roles role) const
 {
-    return m_itemData.value(role, QVariant());
+    switch (role) {
+    case NodeItem::Roles::ItemType:
+        return static_cast<int>(m_type);
+    case NodeItem::Roles::DisplayText:
+        return m_displayText;
+    case NodeItem::Roles::Icon:
+        return m_icon.isEmpty() ? QVariant() : QVariant(m_icon);
+    case NodeItem::Roles::TagColor:
+        return m_tagColor;
+    case NodeItem::Roles::AbsPath:
+        return m_absPath;
+    case NodeItem::Roles::RelPos:
+        return m_relPos;
+    case NodeItem::Roles::ChildCount:
+        return m_childNotesCount;
+    case NodeItem::Roles::NodeId:
+        return m_id;
+    default:
+        return {};
+    }
 }
 
 void NodeTreeItem::setData(NodeItem::Roles role, const QVariant &d)
 {
-    m_itemData[role] = d;
+    switch (role) {
+    case NodeItem::Roles::ItemType:
+        m_type = static_cast<NodeItem::Type>(d.toInt());
+        break;
+    case NodeItem::Roles::DisplayText:
+        m_displayText = d.toString();
+        break;
+    case NodeItem::Roles::Icon:
+        m_icon = d.toString();
+        break;
+    case NodeItem::Roles::TagColor:
+        m_tagColor = d.toString();
+        break;
+    case NodeItem::Roles::AbsPath:
+        m_absPath = d.toString();
+        break;
+    case NodeItem::Roles::RelPos:
+        m_relPos = d.toInt();
+        break;
+    case NodeItem::Roles::ChildCount:
+        m_childNotesCount = d.toInt();
+        break;
+    case NodeItem::Roles::NodeId:
+        m_id = d.toInt();
+        break;
+    default:
+        break;
+    }
 }
 
 NodeTreeItem *NodeTreeItem::getParentItem() const
@@ -106,20 +172,31 @@ void NodeTreeItem::setParentItem(NodeTreeItem *parentItem)
 void NodeTreeItem::moveChild(int from, int to)
 {
     m_childItems.move(from, to);
+    updateChildRows(std::min(from, to), std::max(from, to));
+}
+
+void NodeTreeItem::updateChildRows(int first, int last)
+{
+    first = std::max(first, 0);
+    last = std::min(last, static_cast<int>(m_childItems.size()) - 1);
+    for (int i = first; i <= last; ++i) {
+        m_childItems[i]->m_row = i;
+    }
 }
 
 void NodeTreeItem::recursiveSort()
 {
-    auto type = static_cast<NodeItem::Type>(getData(NodeItem::Roles::ItemType).toInt());
+    auto itemType = type();
     auto relPosComparator = [](const NodeTreeItem *a, const NodeTreeItem *b) {
-        return a->getData(NodeItem::Roles::RelPos).toInt() < b->getData(NodeItem::Roles::RelPos).toInt();
+        return a->relativePosition() < b->relativePosition();
     };
-    if (type == NodeItem::Type::FolderItem) {
+    if (itemType == NodeItem::Type::FolderItem) {
         std::sort(m_childItems.begin(), m_childItems.end(), relPosComparator);
+        updateChildRows(0, m_childItems.size() - 1);
         for (auto &child : m_childItems) {
             child->recursiveSort();
         }
-    } else if (type == NodeItem::Type::RootItem) {
+    } else if (itemType == NodeItem::Type::RootItem) {
         QVector<NodeTreeItem *> allNoteButton;
         QVector<NodeTreeItem *> trashFolder;
         QVector<NodeTreeItem *> folderSep;
@@ -127,7 +204,7 @@ void NodeTreeItem::recursiveSort()
         QVector<NodeTreeItem *> tagSep;
         QVector<NodeTreeItem *> tagItems;
         for (auto *const child : std::as_const(m_childItems)) {
-            auto childType = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
+            auto childType = child->type();
             if (childType == NodeItem::Type::AllNoteButton) {
                 allNoteButton.append(child);
             } else if (childType == NodeItem::Type::TrashButton) {
@@ -156,23 +233,22 @@ void NodeTreeItem::recursiveSort()
         m_childItems.append(folderItems);
         m_childItems.append(tagSep);
         m_childItems.append(tagItems);
+        updateChildRows(0, m_childItems.size() - 1);
     }
 }
 
 int NodeTreeItem::getRow() const
 {
     if (m_parentItem != nullptr) {
-        return m_parentItem->m_childItems.indexOf(const_cast<NodeTreeItem *>(this));
+        return m_row;
     }
 
     return 0;
 }
 
-NodeTreeModel::NodeTreeModel(QObject *parent) : QAbstractItemModel(parent), m_rootItem(nullptr)
+NodeTreeModel::NodeTreeModel(QObject *parent) : QAbstractItemModel(parent), m_rootItem(nullptr), m_dbManager(nullptr)
 {
-    auto hs = QHash<NodeItem::Roles, QVariant>{};
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::RootItem;
-    m_rootItem = new NodeTreeItem(hs);
+    m_rootItem = new NodeTreeItem(NodeItem::Type::RootItem);
 }
 
 NodeTreeModel::~NodeTreeModel()
@@ -180,6 +256,11 @@ NodeTreeModel::~NodeTreeModel()
     delete m_rootItem;
 }
 
+void NodeTreeModel::setDbManager(DBManager *dbManager)
+{
+    m_dbManager = dbManager;
+}
+
 void NodeTreeModel::appendChildNodeToParent(const QModelIndex &parentIndex, const QHash<NodeItem::Roles, QVariant> &data)
 {
     if (m_rootItem != nullptr) {
@@ -191,8 +272,8 @@ void NodeTreeModel::appendChildNodeToParent(const QModelIndex &parentIndex, cons
                 int row = 0;
                 for (int i = 0; i < parentItem->getChildCount(); ++i) {
                     auto const *childItem = parentItem->getChild(i);
-                    auto childType = static_cast<NodeItem::Type>(childItem->getData(NodeItem::Roles::ItemType).toInt());
-                    if (childType == NodeItem::Type::FolderItem && childItem->getData(NodeItem::Roles::NodeId).toInt() == DEFAULT_NOTES_FOLDER_ID) {
+                    auto childType = childItem->type();
+                    if (childType == NodeItem::Type::FolderItem && childItem->id() == DEFAULT_NOTES_FOLDER_ID) {
                         row = i + 1;
                         break;
                     }
@@ -201,6 +282,7 @@ void NodeTreeModel::appendChildNodeToParent(const QModelIndex &parentIndex, cons
                 beginInsertRows(parentIndex, row, row);
                 auto *nodeItem = new NodeTreeItem(data, parentItem);
                 parentItem->insertChild(row, nodeItem);
+                registerItem(nodeItem);
                 endInsertRows();
                 emit layoutChanged();
                 emit topLevelItemLayoutChanged();
@@ -209,6 +291,7 @@ void NodeTreeModel::appendChildNodeToParent(const QModelIndex &parentIndex, cons
                 beginInsertRows(parentIndex, 0, 0);
                 auto *nodeItem = new NodeTreeItem(data, parentItem);
                 parentItem->insertChild(0, nodeItem);
+                registerItem(nodeItem);
                 endInsertRows();
                 updateChildRelativePosition(parentItem, NodeItem::Type::FolderItem);
             }
@@ -222,7 +305,7 @@ void NodeTreeModel::appendChildNodeToParent(const QModelIndex &parentIndex, cons
             int row = 0;
             for (int i = 0; i < parentItem->getChildCount(); ++i) {
                 auto const *childItem = parentItem->getChild(i);
-                auto childType = static_cast<NodeItem::Type>(childItem->getData(NodeItem::Roles::ItemType).toInt());
+                auto childType = childItem->type();
                 if (childType == NodeItem::Type::TagSeparator) {
                     row = i + 1;
                     break;
@@ -232,6 +315,7 @@ void NodeTreeModel::appendChildNodeToParent(const QModelIndex &parentIndex, cons
             beginInsertRows(parentIndex, row, row);
             auto *nodeItem = new NodeTreeItem(data, parentItem);
             parentItem->insertChild(row, nodeItem);
+            registerItem(nodeItem);
             endInsertRows();
             emit layoutChanged();
             emit topLevelItemLayoutChanged();
@@ -243,6 +327,16 @@ void NodeTreeModel::appendChildNodeToParent(const QModelIndex &parentIndex, cons
     }
 }
 
+void NodeTreeModel::skipFolderAdded(int parentId, const QString &title)
+{
+    m_skippedFolderAdds.append({ parentId, title });
+}
+
+void NodeTreeModel::skipTagAdded(const QString &name)
+{
+    m_skippedTagAdds.append(name);
+}
+
 QModelIndex NodeTreeModel::index(int row, int column, const QModelIndex &parent) const
 {
     if (!hasIndex(row, column, parent)) {
@@ -300,65 +394,208 @@ QVariant NodeTreeModel::data(const QModelIndex &index, int role) const
 
     auto const *item = static_cast<NodeTreeItem *>(index.internalPointer());
     if (static_cast<NodeItem::Roles>(role) == NodeItem::Roles::IsExpandable) {
-        return item->getChildCount() > 0;
+        return item->getChildCount() > 0 || item->hasUnfetchedChildren();
     }
-    if (item->getData(NodeItem::Roles::ItemType) == NodeItem::Type::RootItem) {
+    if (item->type() == NodeItem::Type::RootItem) {
         return {};
     }
     return item->getData(static_cast<NodeItem::Roles>(role));
 }
 
+bool NodeTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    return rowCount(parent) > 0 || canFetchMore(parent);
+}
+
+bool NodeTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return false;
+    }
+    auto const *item = static_cast<NodeTreeItem *>(parent.internalPointer());
+    return item->hasUnfetchedChildren() && !m_pendingFetches.contains(item->id());
+}
+
+void NodeTreeModel::fetchMore(const QModelIndex &parent)
+{
+    if (!parent.isValid() || m_dbManager == nullptr) {
+        return;
+    }
+    auto parentId = static_cast<NodeTreeItem *>(parent.internalPointer())->id();
+    if (m_pendingFetches.contains(parentId)) {
+        return;
+    }
+    // expanding shouldn't wait on the database, the rows come in when it answers
+    m_pendingFetches.insert(parentId);
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getChildFolders(parentId), [this, parentId](const NodeTagTreeData &branch) {
+        m_pendingFetches.remove(parentId);
+        auto *parentItem = m_folderItems.value(parentId, nullptr);
+        if (parentItem != nullptr && parentItem->hasUnfetchedChildren()) {
+            insertFetchedFolders(parentItem, branch);
+        }
+    });
+}
+
+// Calls callback once the child folders of the folder still in the database
+// are loaded, right away if there are none. Not called if context goes away.
+void NodeTreeModel::fetchChildFolders(int parentId, QObject *context, const std::function<void()> &callback)
+{
+    auto const *parentItem = m_folderItems.value(parentId, nullptr);
+    if (parentItem == nullptr || !parentItem->hasUnfetchedChildren() || m_dbManager == nullptr) {
+        callback();
+        return;
+    }
+    QPointer<QObject> guard = context;
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getChildFolders(parentId), [this, parentId, guard, callback](const NodeTagTreeData &branch) {
+        auto *parentItem = m_folderItems.value(parentId, nullptr);
+        // fetchMore() may have loaded them meanwhile
+        if (parentItem != nullptr && parentItem->hasUnfetchedChildren()) {
+            insertFetchedFolders(parentItem, branch);
+        }
+        if (!guard.isNull()) {
+            callback();
+        }
+    });
+}
+
+void NodeTreeModel::insertFetchedFolders(NodeTreeItem *parentItem, NodeTagTreeData branch)
+{
+    parentItem->setHasUnfetchedChildren(false);
+    auto parentIndex = indexOfItem(parentItem);
+    // children already present were added or dropped here before the fetch
+    bool appendAll = parentItem->getChildCount() == 0;
+    std::sort(branch.nodeTreeData.begin(), branch.nodeTreeData.end(),
+              [](const NodeData &a, const NodeData &b) { return a.relativePosition() < b.relativePosition(); });
+    QVector<NodeTreeItem *> newItems;
+    for (const auto &folder : std::as_const(branch.nodeTreeData)) {
+        if (m_folderItems.contains(folder.id())) {
+            continue;
+        }
+        auto *item = newFolderItem(folder, parentItem);
+        item->setHasUnfetchedChildren(branch.lazyParentIds.contains(folder.id()));
+        if (appendAll) {
+            newItems.append(item);
+            continue;
+        }
+        int row = sortedInsertRow(parentItem, NodeItem::Type::FolderItem, folder.relativePosition());
+        beginInsertRows(parentIndex, row, row);
+        parentItem->insertChild(row, item);
+        registerItem(item);
+        endInsertRows();
+    }
+    if (!newItems.isEmpty()) {
+        beginInsertRows(parentIndex, 0, newItems.size() - 1);
+        for (auto *item : std::as_const(newItems)) {
+            parentItem->appendChild(item);
+            registerItem(item);
+        }
+        endInsertRows();
+    }
+}
+
+NodeTreeItem *NodeTreeModel::newFolderItem(const NodeData &folder, NodeTreeItem *parentItem) const
+{
+    auto *item = new NodeTreeItem(NodeItem::Type::FolderItem, parentItem);
+    item->setId(folder.id());
+    item->setDisplayText(folder.fullTitle());
+    item->setAbsolutePath(folder.absolutePath());
+    item->setRelativePosition(folder.relativePosition());
+    item->setChildNotesCount(folder.childNotesCount());
+    return item;
+}
+
 QModelIndex NodeTreeModel::rootIndex() const
 {
     return createIndex(0, 0, m_rootItem);
 }
 
-QModelIndex NodeTreeModel::folderIndexFromIdPath(const NodePath &idPath)
+// The index of the folder if it's loaded, see loadFolderIndex() otherwise
+QModelIndex NodeTreeModel::folderIndexFromIdPath(const NodePath &idPath) const
 {
     if (m_rootItem == nullptr) {
         return {};
     }
     auto ps = idPath.separate();
-    auto const *item = m_rootItem;
-    for (const auto &ite : std::as_const(ps)) {
-        bool ok = false;
-        auto id = ite.toInt(&ok);
+    if (ps.isEmpty()) {
+        return createIndex(m_rootItem->getRow(), 0, m_rootItem);
+    }
+    bool ok = false;
+    auto id = ps.last().toInt(&ok);
+    if (!ok) {
+        qDebug() << __FUNCTION__ << "Can't convert to id" << ps.last();
+        return {};
+    }
+    NodeTreeItem const *item = (id == m_rootItem->id()) ? m_rootItem : m_folderItems.value(id, nullptr);
+    if (item == nullptr) {
+        return {};
+    }
+    // the path has to match the item's actual ancestry, not just its last id
+    auto const *ancestor = item;
+    for (auto i = ps.size() - 1; i >= 0; --i) {
+        auto ancestorId = ps[i].toInt(&ok);
         if (!ok) {
-            qDebug() << __FUNCTION__ << "Can't convert to id" << ite;
+            qDebug() << __FUNCTION__ << "Can't convert to id" << ps[i];
             return {};
         }
-        if (id == item->getData(NodeItem::Roles::NodeId).toInt()) {
-            continue;
+        if (ancestor == nullptr) {
+            return {};
         }
-        bool foundChild = false;
-        for (int i = 0; i < item->getChildCount(); ++i) {
-            auto *child = item->getChild(i);
-            if (static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt()) != NodeItem::FolderItem) {
-                continue;
-            }
-            if (id == child->getData(NodeItem::Roles::NodeId).toInt()) {
-                item = child;
-                foundChild = true;
-                break;
+        if (ancestor == m_rootItem) {
+            if (ancestorId != m_rootItem->id()) {
+                return {};
             }
+            continue;
         }
-        if (!foundChild) {
+        if (ancestorId != ancestor->id()) {
             return {};
         }
+        ancestor = ancestor->getParentItem();
     }
     return createIndex(item->getRow(), 0, item);
 }
 
-QModelIndex NodeTreeModel::tagIndexFromId(int id)
+// Calls callback with the index of the folder once the collapsed folders on
+// the way down to it are loaded, or with an invalid index if it isn't there.
+// Not called if context goes away first.
+void NodeTreeModel::loadFolderIndex(const NodePath &idPath, QObject *context, const std::function<void(const QModelIndex &)> &callback)
 {
-    for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
-        auto *child = m_rootItem->getChild(i);
-        if (static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt()) == NodeItem::Type::TagItem
-            && (static_cast<int>(child->getData(NodeItem::Roles::NodeId).toInt() == id) != 0)) {
-            return createIndex(i, 0, child);
+    auto const index = folderIndexFromIdPath(idPath);
+    if (index.isValid() || m_rootItem == nullptr || m_dbManager == nullptr) {
+        callback(index);
+        return;
+    }
+    // the first folder on the path whose children aren't loaded yet
+    for (const auto &part : idPath.separate()) {
+        auto const *ancestor = m_folderItems.value(part.toInt(), nullptr);
+        if (ancestor != nullptr && ancestor->hasUnfetchedChildren()) {
+            QPointer<QObject> guard = context;
+            fetchChildFolders(ancestor->id(), this, [this, idPath, guard, callback]() {
+                if (!guard.isNull()) {
+                    loadFolderIndex(idPath, guard, callback);
+                }
+            });
+            return;
         }
     }
-    return {};
+    callback({});
+}
+
+QModelIndex NodeTreeModel::loadedFolderIndexFromId(int id) const
+{
+    auto *item = m_folderItems.value(id, nullptr);
+    if (item == nullptr) {
+        return {};
+    }
+    return createIndex(item->getRow(), 0, item);
+}
+
+QModelIndex NodeTreeModel::tagIndexFromId(int id)
+{
+    auto const *item = m_tagItems.value(id, nullptr);
+    if (item == nullptr) {
+        return {};
+    }
+    return createIndex(item->getRow(), 0, item);
 }
 
 QString NodeTreeModel::getNewFolderPlaceholderName(const QModelIndex &parentIndex)
@@ -371,7 +608,7 @@ QString NodeTreeModel::getNewFolderPlaceholderName(const QModelIndex &parentInde
             int n = 0;
             for (int i = 0; i < parentItem->getChildCount(); ++i) {
                 auto const *child = parentItem->getChild(i);
-                QString title = child->getData(NodeItem::Roles::DisplayText).toString();
+                QString title = child->displayText();
                 if (title.compare("New Folder", Qt::CaseInsensitive) == 0 && n == 0) {
                     n = 1;
                 }
@@ -399,7 +636,7 @@ QString NodeTreeModel::getNewTagPlaceholderName()
         int n = 0;
         for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
             auto const *child = m_rootItem->getChild(i);
-            auto title = child->getData(NodeItem::Roles::DisplayText).toString();
+            auto title = child->displayText();
             if (title.compare("New Tag", Qt::CaseInsensitive) == 0 && n == 0) {
                 n = 1;
             }
@@ -425,7 +662,7 @@ QVector<QModelIndex> NodeTreeModel::getSeparatorIndex()
     if (m_rootItem != nullptr) {
         for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
             auto *child = m_rootItem->getChild(i);
-            auto type = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
+            auto type = child->type();
             if (type == NodeItem::Type::FolderSeparator || type == NodeItem::Type::TagSeparator) {
                 result.append(createIndex(i, 0, child));
             }
@@ -436,14 +673,9 @@ QVector<QModelIndex> NodeTreeModel::getSeparatorIndex()
 
 QModelIndex NodeTreeModel::getDefaultNotesIndex()
 {
-    if (m_rootItem != nullptr) {
-        for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
-            auto *child = m_rootItem->getChild(i);
-            auto type = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
-            if (type == NodeItem::Type::FolderItem && child->getData(NodeItem::Roles::NodeId).toInt() == DEFAULT_NOTES_FOLDER_ID) {
-                return createIndex(i, 0, child);
-            }
-        }
+    auto const *item = m_folderItems.value(DEFAULT_NOTES_FOLDER_ID, nullptr);
+    if (item != nullptr && item->getParentItem() == m_rootItem) {
+        return createIndex(item->getRow(), 0, item);
     }
     return QModelIndex{};
 }
@@ -453,7 +685,7 @@ QModelIndex NodeTreeModel::getAllNotesButtonIndex()
     if (m_rootItem != nullptr) {
         for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
             auto *child = m_rootItem->getChild(i);
-            auto type = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
+            auto type = child->type();
             if (type == NodeItem::Type::AllNoteButton) {
                 return createIndex(i, 0, child);
             }
@@ -467,7 +699,7 @@ QModelIndex NodeTreeModel::getTrashButtonIndex()
     if (m_rootItem != nullptr) {
         for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
             auto *child = m_rootItem->getChild(i);
-            auto type = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
+            auto type = child->type();
             if (type == NodeItem::Type::TrashButton) {
                 return createIndex(i, 0, child);
             }
@@ -489,6 +721,7 @@ void NodeTreeModel::deleteRow(const QModelIndex &rowIndex, const QModelIndex &pa
     int row = item->getRow();
 
     setData(rowIndex, "deleted", NodeItem::DisplayText);
+    unregisterItem(parentItem->getChild(row));
     if (parentItem == m_rootItem) {
         beginResetModel();
         parentItem->removeChild(row);
@@ -506,40 +739,226 @@ void NodeTreeModel::setTreeData(const NodeTagTreeData &treeData)
 {
     beginResetModel();
     delete m_rootItem;
-    auto hs = QHash<NodeItem::Roles, QVariant>{};
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::RootItem;
-    m_rootItem = new NodeTreeItem(hs);
+    m_rootItem = new NodeTreeItem(NodeItem::Type::RootItem);
+    m_folderItems.clear();
+    m_tagItems.clear();
     appendAllNotesAndTrashButton(m_rootItem);
     appendFolderSeparator(m_rootItem);
-    loadNodeTree(treeData.nodeTreeData, m_rootItem);
+    loadNodeTree(treeData.nodeTreeData, treeData.lazyParentIds, m_rootItem);
     appendTagsSeparator(m_rootItem);
     loadTagList(treeData.tagTreeData, m_rootItem);
     m_rootItem->recursiveSort();
     endResetModel();
 }
 
-void NodeTreeModel::loadNodeTree(const QVector<NodeData> &nodeData, NodeTreeItem *rootNode)
+// The slots below apply single database changes as row operations so the view
+// keeps its expansion and selection state. Changes made from the tree itself are
+// already reflected and are ignored; anything that can't be placed falls back to
+// a full reload through requestTreeReload().
+void NodeTreeModel::onFolderAdded(const NodeData &folder)
+{
+    if (m_skippedFolderAdds.removeOne({ folder.parentId(), folder.fullTitle() })) {
+        return;
+    }
+    // root and trash are never shown as folder rows, same as in loadNodeTree()
+    if (folder.id() == ROOT_FOLDER_ID || folder.id() == TRASH_FOLDER_ID || folder.parentId() == TRASH_FOLDER_ID
+        || m_folderItems.contains(folder.id())) {
+        return;
+    }
+    auto *parentItem = (folder.parentId() == ROOT_FOLDER_ID) ? m_rootItem : m_folderItems.value(folder.parentId(), nullptr);
+    if (parentItem == nullptr || parentItem->hasUnfetchedChildren()) {
+        // the parent's children aren't loaded yet, this one comes along when they are
+        return;
+    }
+    int row = sortedInsertRow(parentItem, NodeItem::Type::FolderItem, folder.relativePosition());
+    beginInsertRows(indexOfItem(parentItem), row, row);
+    auto *item = newFolderItem(folder, parentItem);
+    parentItem->insertChild(row, item);
+    registerItem(item);
+    endInsertRows();
+    if (parentItem == m_rootItem) {
+        emit topLevelItemLayoutChanged();
+    }
+}
+
+void NodeTreeModel::onFolderRenamed(int folderId, const QString &newName)
+{
+    auto *item = m_folderItems.value(folderId, nullptr);
+    if (item == nullptr || item->displayText() == newName) {
+        return;
+    }
+    item->setDisplayText(newName);
+    auto index = indexOfItem(item);
+    emit dataChanged(index, index, { NodeItem::Roles::DisplayText });
+}
+
+void NodeTreeModel::onFolderMoved(int folderId, int newParentId)
+{
+    if (newParentId == TRASH_FOLDER_ID) {
+        onFolderRemoved(folderId);
+        return;
+    }
+    auto *item = m_folderItems.value(folderId, nullptr);
+    auto *newParent = (newParentId == ROOT_FOLDER_ID) ? m_rootItem : m_folderItems.value(newParentId, nullptr);
+    if (item != nullptr && item->getParentItem() == newParent) {
+        return;
+    }
+    if (item == nullptr) {
+        // moved out of a subtree that isn't loaded, show it if its new parent is
+        if (newParent != nullptr && !newParent->hasUnfetchedChildren() && m_dbManager != nullptr) {
+            DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getNode(folderId), [this](const NodeData &folder) { onFolderAdded(folder); });
+        }
+        return;
+    }
+    if (newParent == nullptr || newParent->hasUnfetchedChildren()) {
+        removeItem(item);
+        return;
+    }
+    auto *oldParent = item->getParentItem();
+    int from = item->getRow();
+    int to = sortedInsertRow(newParent, NodeItem::Type::FolderItem, item->relativePosition());
+    // refuses moves into the item's own subtree
+    if (!beginMoveRows(indexOfItem(oldParent), from, from, indexOfItem(newParent), to)) {
+        emit requestTreeReload();
+        return;
+    }
+    auto oldAbsolutePath = item->absolutePath();
+    QString newAbsolutePath = (newParent == m_rootItem ? NodePath::getAllNoteFolderPath() : newParent->absolutePath())
+            + PATH_SEPARATOR + QString::number(item->id());
+    oldParent->takeChildAt(from);
+    item->setParentItem(newParent);
+    item->recursiveUpdateFolderPath(oldAbsolutePath, newAbsolutePath);
+    newParent->insertChild(to, item);
+    endMoveRows();
+    if (oldParent == m_rootItem || newParent == m_rootItem) {
+        emit topLevelItemLayoutChanged();
+    }
+}
+
+void NodeTreeModel::onFolderRemoved(int folderId)
+{
+    removeItem(m_folderItems.value(folderId, nullptr));
+}
+
+void NodeTreeModel::onTagAdded(const TagData &tag)
+{
+    if (m_skippedTagAdds.removeOne(tag.name())) {
+        return;
+    }
+    if (m_tagItems.contains(tag.id())) {
+        return;
+    }
+    int row = sortedInsertRow(m_rootItem, NodeItem::Type::TagItem, tag.relativePosition());
+    beginInsertRows(QModelIndex(), row, row);
+    auto *item = new NodeTreeItem(NodeItem::Type::TagItem, m_rootItem);
+    item->setId(tag.id());
+    item->setDisplayText(tag.name());
+    item->setTagColor(tag.color());
+    item->setRelativePosition(tag.relativePosition());
+    item->setChildNotesCount(tag.childNotesCount());
+    m_rootItem->insertChild(row, item);
+    registerItem(item);
+    endInsertRows();
+    emit topLevelItemLayoutChanged();
+}
+
+void NodeTreeModel::onTagRenamed(int tagId, const QString &newName)
+{
+    auto *item = m_tagItems.value(tagId, nullptr);
+    if (item == nullptr || item->displayText() == newName) {
+        return;
+    }
+    item->setDisplayText(newName);
+    auto index = indexOfItem(item);
+    emit dataChanged(index, index, { NodeItem::Roles::DisplayText });
+}
+
+void NodeTreeModel::onTagColorChanged(int tagId, const QString &tagColor)
+{
+    auto *item = m_tagItems.value(tagId, nullptr);
+    if (item == nullptr || item->tagColor() == tagColor) {
+        return;
+    }
+    item->setTagColor(tagColor);
+    auto index = indexOfItem(item);
+    emit dataChanged(index, index, { NodeItem::Roles::TagColor });
+}
+
+void NodeTreeModel::onTagRemoved(int tagId)
+{
+    removeItem(m_tagItems.value(tagId, nullptr));
+}
+
+QModelIndex NodeTreeModel::indexOfItem(NodeTreeItem *item) const
+{
+    if (item == nullptr || item == m_rootItem) {
+        return {};
+    }
+    return createIndex(item->getRow(), 0, item);
+}
+
+int NodeTreeModel::sortedInsertRow(NodeTreeItem *parentItem, NodeItem::Type type, int relativePosition) const
+{
+    // folders at the top level live between the two separators, tags after the last one
+    int row = 0;
+    if (parentItem == m_rootItem) {
+        auto sepType = (type == NodeItem::Type::TagItem) ? NodeItem::Type::TagSeparator : NodeItem::Type::FolderSeparator;
+        for (int i = 0; i < parentItem->getChildCount(); ++i) {
+            if (parentItem->getChild(i)->type() == sepType) {
+                row = i + 1;
+                break;
+            }
+        }
+    }
+    while (row < parentItem->getChildCount()) {
+        auto const *child = parentItem->getChild(row);
+        if (child->type() != type || child->relativePosition() > relativePosition) {
+            break;
+        }
+        ++row;
+    }
+    return row;
+}
+
+void NodeTreeModel::removeItem(NodeTreeItem *item)
+{
+    if (item == nullptr) {
+        return;
+    }
+    auto *parentItem = item->getParentItem();
+    int row = item->getRow();
+    unregisterItem(item);
+    beginRemoveRows(indexOfItem(parentItem), row, row);
+    parentItem->removeChild(row);
+    endRemoveRows();
+    if (parentItem == m_rootItem) {
+        emit topLevelItemLayoutChanged();
+    }
+}
+
+void NodeTreeModel::loadNodeTree(const QVector<NodeData> &nodeData, const QSet<int> &lazyParentIds, NodeTreeItem *rootNode)
 {
     QHash<int, NodeTreeItem *> itemMap;
     itemMap[ROOT_FOLDER_ID] = rootNode;
     for (const auto &node : nodeData) {
         if (node.id() != ROOT_FOLDER_ID && node.id() != TRASH_FOLDER_ID && node.parentId() != TRASH_FOLDER_ID) {
-            auto hs = QHash<NodeItem::Roles, QVariant>{};
+            NodeTreeItem *nodeItem;
             if (node.nodeType() == NodeData::Type::Folder) {
-                hs[NodeItem::Roles::ItemType] = NodeItem::Type::FolderItem;
-                hs[NodeItem::Roles::AbsPath] = node.absolutePath();
-                hs[NodeItem::Roles::RelPos] = node.relativePosition();
-                hs[NodeItem::Roles::ChildCount] = node.childNotesCount();
+                nodeItem = new NodeTreeItem(NodeItem::Type::FolderItem, rootNode);
+                nodeItem->setAbsolutePath(node.absolutePath());
+                nodeItem->setRelativePosition(node.relativePosition());
+                nodeItem->setChildNotesCount(node.childNotesCount());
+                nodeItem->setHasUnfetchedChildren(lazyParentIds.contains(node.id()));
             } else if (node.nodeType() == NodeData::Type::Note) {
-                hs[NodeItem::Roles::ItemType] = NodeItem::Type::NoteItem;
+                nodeItem = new NodeTreeItem(NodeItem::Type::NoteItem, rootNode);
             } else {
                 qDebug() << "Wrong node type";
                 continue;
             }
-            hs[NodeItem::Roles::DisplayText] = node.fullTitle();
-            hs[NodeItem::Roles::NodeId] = node.id();
-            auto *nodeItem = new NodeTreeItem(hs, rootNode);
+            nodeItem->setDisplayText(node.fullTitle());
+            nodeItem->setId(node.id());
             itemMap[node.id()] = nodeItem;
+            registerItem(nodeItem);
         }
     }
 
@@ -558,56 +977,70 @@ void NodeTreeModel::loadNodeTree(const QVector<NodeData> &nodeData, NodeTreeItem
     }
 }
 
+void NodeTreeModel::registerItem(NodeTreeItem *item)
+{
+    if (item->type() == NodeItem::Type::FolderItem) {
+        m_folderItems[item->id()] = item;
+    } else if (item->type() == NodeItem::Type::TagItem) {
+        m_tagItems[item->id()] = item;
+    }
+}
+
+void NodeTreeModel::unregisterItem(NodeTreeItem *item)
+{
+    if (item == nullptr) {
+        return;
+    }
+    if (item->type() == NodeItem::Type::FolderItem) {
+        m_folderItems.remove(item->id());
+        for (int i = 0; i < item->getChildCount(); ++i) {
+            unregisterItem(item->getChild(i));
+        }
+    } else if (item->type() == NodeItem::Type::TagItem) {
+        m_tagItems.remove(item->id());
+    }
+}
+
 void NodeTreeModel::appendAllNotesAndTrashButton(NodeTreeItem *rootNode)
 {
     {
-        auto hs = QHash<NodeItem::Roles, QVariant>{};
-        hs[NodeItem::Roles::ItemType] = NodeItem::Type::AllNoteButton;
-        hs[NodeItem::Roles::DisplayText] = tr("All Notes");
-        hs[NodeItem::Roles::Icon] = u8"\ue2c7"; // folder
-        auto *allNodeButton = new NodeTreeItem(hs, rootNode);
+        auto *allNodeButton = new NodeTreeItem(NodeItem::Type::AllNoteButton, rootNode);
+        allNodeButton->setDisplayText(tr("All Notes"));
+        allNodeButton->setIcon(QString::fromUtf8(u8"\ue2c7")); // folder
         rootNode->appendChild(allNodeButton);
     }
     {
-        auto hs = QHash<NodeItem::Roles, QVariant>{};
-        hs[NodeItem::Roles::ItemType] = NodeItem::Type::TrashButton;
-        hs[NodeItem::Roles::DisplayText] = tr("Trash");
-        hs[NodeItem::Roles::Icon] = u8"\uf1f8"; // fa-trash
-        auto *trashButton = new NodeTreeItem(hs, rootNode);
+        auto *trashButton = new NodeTreeItem(NodeItem::Type::TrashButton, rootNode);
+        trashButton->setDisplayText(tr("Trash"));
+        trashButton->setIcon(QString::fromUtf8(u8"\uf1f8")); // fa-trash
         rootNode->appendChild(trashButton);
     }
 }
 
 void NodeTreeModel::appendFolderSeparator(NodeTreeItem *rootNode)
 {
-    auto hs = QHash<NodeItem::Roles, QVariant>{};
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::FolderSeparator;
-    hs[NodeItem::Roles::DisplayText] = tr("Folders");
-    auto *folderSepButton = new NodeTreeItem(hs, rootNode);
+    auto *folderSepButton = new NodeTreeItem(NodeItem::Type::FolderSeparator, rootNode);
+    folderSepButton->setDisplayText(tr("Folders"));
     rootNode->appendChild(folderSepButton);
 }
 
 void NodeTreeModel::appendTagsSeparator(NodeTreeItem *rootNode)
 {
-    auto hs = QHash<NodeItem::Roles, QVariant>{};
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::TagSeparator;
-    hs[NodeItem::Roles::DisplayText] = tr("Tags");
-    auto *tagSepButton = new NodeTreeItem(hs, rootNode);
+    auto *tagSepButton = new NodeTreeItem(NodeItem::Type::TagSeparator, rootNode);
+    tagSepButton->setDisplayText(tr("Tags"));
     rootNode->appendChild(tagSepButton);
 }
 
 void NodeTreeModel::loadTagList(const QVector<TagData> &tagData, NodeTreeItem *rootNode)
 {
     for (const auto &tag : tagData) {
-        auto hs = QHash<NodeItem::Roles, QVariant>{};
-        hs[NodeItem::Roles::ItemType] = NodeItem::Type::TagItem;
-        hs[NodeItem::Roles::DisplayText] = tag.name();
-        hs[NodeItem::Roles::TagColor] = tag.color();
-        hs[NodeItem::Roles::NodeId] = tag.id();
-        hs[NodeItem::Roles::RelPos] = tag.relativePosition();
-        hs[NodeItem::Roles::ChildCount] = tag.childNotesCount();
-
-        auto *tagItem = new NodeTreeItem(hs, rootNode);
+        auto *tagItem = new NodeTreeItem(NodeItem::Type::TagItem, rootNode);
+        tagItem->setDisplayText(tag.name());
+        tagItem->setTagColor(tag.color());
+        tagItem->setId(tag.id());
+        tagItem->setRelativePosition(tag.relativePosition());
+        tagItem->setChildNotesCount(tag.childNotesCount());
+        registerItem(tagItem);
         rootNode->appendChild(tagItem);
     }
 }
@@ -617,13 +1050,13 @@ void NodeTreeModel::updateChildRelativePosition(NodeTreeItem *parent, const Node
     int relId = 0;
     for (int i = 0; i < parent->getChildCount(); ++i) {
         auto const *child = parent->getChild(i);
-        auto childType = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
+        auto childType = child->type();
         if (childType == type) {
             if (type == NodeItem::Type::FolderItem) {
-                emit requestUpdateNodeRelativePosition(child->getData(NodeItem::Roles::NodeId).toInt(), relId);
+                emit requestUpdateNodeRelativePosition(child->id(), relId);
                 ++relId;
             } else if (type == NodeItem::Type::TagItem) {
-                emit requestUpdateTagRelativePosition(child->getData(NodeItem::Roles::NodeId).toInt(), relId);
+                emit requestUpdateTagRelativePosition(child->id(), relId);
                 ++relId;
             } else {
                 qDebug() << __FUNCTION__ << "Wrong type";
@@ -743,8 +1176,8 @@ bool NodeTreeModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
             auto id = idString.toInt();
             for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
                 auto const *child = m_rootItem->getChild(i);
-                auto childType = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
-                if (childType == NodeItem::Type::TagItem && child->getData(NodeItem::Roles::NodeId).toInt() == id) {
+                auto childType = child->type();
+                if (childType == NodeItem::Type::TagItem && child->id() == id) {
                     if (row >= m_rootItem->getChildCount()) {
                         row = m_rootItem->getChildCount() - 1;
                     }
@@ -782,13 +1215,13 @@ bool NodeTreeModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
         } else {
             parentItem = static_cast<NodeTreeItem *>(parent.internalPointer());
         }
-        auto parentType = static_cast<NodeItem::Type>(parentItem->getData(NodeItem::Roles::ItemType).toInt());
+        auto parentType = parentItem->type();
         if (parentType != NodeItem::Type::FolderItem && parentType != NodeItem::Type::RootItem && parentType != NodeItem::Type::TrashButton) {
             return false;
         }
         movingItem = static_cast<NodeTreeItem *>(idx.internalPointer());
         if (parentType == NodeItem::Type::TrashButton) {
-            auto abs = movingItem->getData(NodeItem::Roles::AbsPath).toString();
+            auto abs = movingItem->absolutePath();
             auto movingIndex = folderIndexFromIdPath(abs);
             emit requestMoveFolderToTrash(movingIndex);
             return false;
@@ -811,8 +1244,8 @@ bool NodeTreeModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
             beginResetModel();
             for (int i = 0; i < parentItem->getChildCount(); ++i) {
                 auto const *child = parentItem->getChild(i);
-                auto childType = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
-                if (childType == NodeItem::Type::FolderItem && child->getData(NodeItem::Roles::NodeId) == movingItem->getData(NodeItem::Roles::NodeId)) {
+                auto childType = child->type();
+                if (childType == NodeItem::Type::FolderItem && child->id() == movingItem->id()) {
                     int targetRow = row;
                     if (row > i && row > 0) {
                         targetRow -= 1;
@@ -824,15 +1257,15 @@ bool NodeTreeModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
             endResetModel();
             emit topLevelItemLayoutChanged();
             updateChildRelativePosition(parentItem, NodeItem::Type::FolderItem);
-            emit dropFolderSuccessful(movingItem->getData(NodeItem::Roles::AbsPath).toString());
+            emit dropFolderSuccessful(movingItem->absolutePath());
         } else {
             auto *movingParent = movingItem->getParentItem();
             int r = -1;
             for (int i = 0; i < movingParent->getChildCount(); ++i) {
                 auto const *child = movingParent->getChild(i);
-                auto childType = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
+                auto childType = child->type();
                 if ((childType == NodeItem::Type::FolderItem)
-                    && (child->getData(NodeItem::Roles::NodeId).toInt() == movingItem->getData(NodeItem::Roles::NodeId).toInt())) {
+                    && (child->id() == movingItem->id())) {
                     r = i;
                     break;
                 }
@@ -841,9 +1274,9 @@ bool NodeTreeModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
                 return false;
             }
             movingItem = movingParent->getChild(r);
-            auto oldAbsolutePath = movingItem->getData(NodeItem::Roles::AbsPath).toString();
-            QString newAbsolutePath = parentItem->getData(NodeItem::Roles::AbsPath).toString() + PATH_SEPARATOR
-                    + QString::number(movingItem->getData(NodeItem::Roles::NodeId).toInt());
+            auto oldAbsolutePath = movingItem->absolutePath();
+            QString newAbsolutePath = parentItem->absolutePath() + PATH_SEPARATOR
+                    + QString::number(movingItem->id());
             emit requestUpdateAbsPath(oldAbsolutePath, newAbsolutePath);
             beginResetModel();
             movingParent->takeChildAt(r);
@@ -852,10 +1285,10 @@ bool NodeTreeModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
             parentItem->insertChild(row, movingItem);
             endResetModel();
             emit topLevelItemLayoutChanged();
-            emit requestExpand(parentItem->getData(NodeItem::Roles::AbsPath).toString());
-            emit requestMoveNode(movingItem->getData(NodeItem::Roles::NodeId).toInt(), parentItem->getData(NodeItem::Roles::NodeId).toInt());
+            emit requestExpand(parentItem->absolutePath());
+            emit requestMoveNode(movingItem->id(), parentItem->id());
             updateChildRelativePosition(parentItem, NodeItem::Type::FolderItem);
-            emit dropFolderSuccessful(movingItem->getData(NodeItem::Roles::AbsPath).toString());
+            emit dropFolderSuccessful(movingItem->absolutePath());
         }
         return true;
     }
@@ -6,6 +6,7 @@
 #include <QVariant>
 #include <QHash>
 #include <QVector>
+#include <functional>
 
 #include "nodedata.h"
 #include "dbmanager.h"
@@ -40,6 +41,7 @@ enum Type {
 class NodeTreeItem
 {
 public:
+    explicit NodeTreeItem(NodeItem::Type type, NodeTreeItem *parentItem = nullptr);
     explicit NodeTreeItem(const QHash<NodeItem::Roles, QVariant> &data, NodeTreeItem *parentItem = nullptr);
     ~NodeTreeItem();
 
@@ -54,6 +56,22 @@ public:
     void recursiveUpdateFolderPath(const QString &oldP, const QString &newP);
     QVariant getData(NodeItem::Roles role) const;
     void setData(NodeItem::Roles role, const QVariant &d);
+    NodeItem::Type type() const { return m_type; }
+    int id() const { return m_id; }
+    int relativePosition() const { return m_relPos; }
+    int childNotesCount() const { return m_childNotesCount; }
+    const QString &displayText() const { return m_displayText; }
+    const QString &absolutePath() const { return m_absPath; }
+    const QString &tagColor() const { return m_tagColor; }
+    void setId(int id) { m_id = id; }
+    void setRelativePosition(int relPos) { m_relPos = relPos; }
+    void setChildNotesCount(int count) { m_childNotesCount = count; }
+    void setDisplayText(const QString &text) { m_displayText = text; }
+    void setAbsolutePath(const QString &path) { m_absPath = path; }
+    void setTagColor(const QString &color) { m_tagColor = color; }
+    void setIcon(const QString &icon) { m_icon = icon; }
+    bool hasUnfetchedChildren() const { return m_hasUnfetchedChildren; }
+    void setHasUnfetchedChildren(bool unfetched) { m_hasUnfetchedChildren = unfetched; }
     int getRow() const;
     NodeTreeItem *getParentItem() const;
     void setParentItem(NodeTreeItem *parentItem);
@@ -61,9 +79,23 @@ public:
     void recursiveSort();
 
 private:
+    void updateChildRows(int first, int last);
+
     QVector<NodeTreeItem *> m_childItems;
-    QHash<NodeItem::Roles, QVariant> m_itemData;
     NodeTreeItem *m_parentItem;
+    // position inside m_parentItem->m_childItems, kept in sync by the parent
+    int m_row;
+    // Typed fields instead of a role hash; which ones are meaningful depends on m_type
+    NodeItem::Type m_type;
+    int m_id;
+    int m_relPos;
+    int m_childNotesCount;
+    QString m_displayText;
+    QString m_absPath;
+    QString m_tagColor;
+    QString m_icon;
+    // folder has child folders in the database that aren't loaded yet
+    bool m_hasUnfetchedChildren;
 };
 
 class NodeTreeModel : public QAbstractItemModel
@@ -73,9 +105,18 @@ public:
     explicit NodeTreeModel(QObject *parent = nullptr);
     ~NodeTreeModel() override;
 
+    void setDbManager(DBManager *dbManager);
+
     void appendChildNodeToParent(const QModelIndex &parentIndex, const QHash<NodeItem::Roles, QVariant> &data);
+    // folders and tags created from the tree are put on top by their creator
+    // with appendChildNodeToParent(), so the database's echo of them is skipped
+    void skipFolderAdded(int parentId, const QString &title);
+    void skipTagAdded(const QString &name);
     QModelIndex rootIndex() const;
-    QModelIndex folderIndexFromIdPath(const NodePath &idPath);
+    QModelIndex folderIndexFromIdPath(const NodePath &idPath) const;
+    void loadFolderIndex(const NodePath &idPath, QObject *context, const std::function<void(const QModelIndex &)> &callback);
+    void fetchChildFolders(int parentId, QObject *context, const std::function<void()> &callback);
+    QModelIndex loadedFolderIndexFromId(int id) const;
     QModelIndex tagIndexFromId(int id);
     QString getNewFolderPlaceholderName(const QModelIndex &parentIndex);
     QString getNewTagPlaceholderName();
@@ -87,6 +128,14 @@ public:
 
 public slots:
     void setTreeData(const NodeTagTreeData &treeData);
+    void onFolderAdded(const NodeData &folder);
+    void onFolderRenamed(int folderId, const QString &newName);
+    void onFolderMoved(int folderId, int newParentId);
+    void onFolderRemoved(int folderId);
+    void onTagAdded(const TagData &tag);
+    void onTagRenamed(int tagId, const QString &newName);
+    void onTagColorChanged(int tagId, const QString &tagColor);
+    void onTagRemoved(int tagId);
 
     // QAbstractItemModel interface
 public:
@@ -95,6 +144,9 @@ public:
     int rowCount(const QModelIndex &parent) const override;
     int columnCount(const QModelIndex &parent) const override;
     QVariant data(const QModelIndex &index, int role) const override;
+    bool hasChildren(const QModelIndex &parent) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
     Qt::ItemFlags flags(const QModelIndex &index) const override;
     bool setData(const QModelIndex &index, const QVariant &value, int role) override;
     Qt::DropActions supportedDropActions() const override;
@@ -113,10 +165,25 @@ signals:
     void dropFolderSuccessful(const QString &paths);
     void dropTagsSuccessful(const QSet<int> &ids);
     void requestMoveFolderToTrash(const QModelIndex &index);
+    void requestTreeReload();
 
 private:
     NodeTreeItem *m_rootItem;
-    void loadNodeTree(const QVector<NodeData> &nodeData, NodeTreeItem *rootNode);
+    DBManager *m_dbManager;
+    QHash<int, NodeTreeItem *> m_folderItems;
+    QHash<int, NodeTreeItem *> m_tagItems;
+    // folders whose children are being fetched in the background
+    QSet<int> m_pendingFetches;
+    QVector<QPair<int, QString>> m_skippedFolderAdds;
+    QStringList m_skippedTagAdds;
+    void registerItem(NodeTreeItem *item);
+    void unregisterItem(NodeTreeItem *item);
+    QModelIndex indexOfItem(NodeTreeItem *item) const;
+    NodeTreeItem *newFolderItem(const NodeData &folder, NodeTreeItem *parentItem) const;
+    void insertFetchedFolders(NodeTreeItem *parentItem, NodeTagTreeData branch);
+    int sortedInsertRow(NodeTreeItem *parentItem, NodeItem::Type type, int relativePosition) const;
+    void removeItem(NodeTreeItem *item);
+    void loadNodeTree(const QVector<NodeData> &nodeData, const QSet<int> &lazyParentIds, NodeTreeItem *rootNode);
     void appendAllNotesAndTrashButton(NodeTreeItem *rootNode);
     void appendFolderSeparator(NodeTreeItem *rootNode);
     void appendTagsSeparator(NodeTreeItem *rootNode);
@@ -2,6 +2,7 @@
 #include "nodetreemodel.h"
 #include <QMenu>
 #include <QAction>
+#include <QActionGroup>
 #include <QMouseEvent>
 #include <QDebug>
 #include <QMimeData>
@@ -11,7 +12,8 @@
 #include "nodetreeview_p.h"
 
 NodeTreeView::NodeTreeView(QWidget *parent)
-    : QTreeView(parent), m_isContextMenuOpened{ false }, m_isEditing{ false }, m_ignoreThisCurrentLoad{ false }, m_isLastSelectedFolder{ false }
+    : QTreeView(parent), m_isContextMenuOpened{ false }, m_isEditing{ false }, m_ignoreThisCurrentLoad{ false }, m_isLastSelectedFolder{ false },
+      m_tagFilterMode{ TagFilterMode::All }
 {
     setHeaderHidden(true);
 
@@ -57,6 +59,32 @@ NodeTreeView::NodeTreeView(QWidget *parent)
         clearSelection();
         setCurrentIndexC(static_cast<NodeTreeModel *>(model())->getAllNotesButtonIndex());
     });
+    auto tagFilterModeGroup = new QActionGroup(this);
+    m_matchAllTagsAction = new QAction(tr("Match All Selected Tags"), tagFilterModeGroup);
+    m_matchAllTagsAction->setCheckable(true);
+    m_matchAllTagsAction->setChecked(true);
+    connect(m_matchAllTagsAction, &QAction::triggered, this, [this] {
+        m_tagFilterMode = TagFilterMode::All;
+        reloadSelectedTags();
+    });
+    m_matchAnyTagAction = new QAction(tr("Match Any Selected Tag"), tagFilterModeGroup);
+    m_matchAnyTagAction->setCheckable(true);
+    connect(m_matchAnyTagAction, &QAction::triggered, this, [this] {
+        m_tagFilterMode = TagFilterMode::Any;
+        reloadSelectedTags();
+    });
+    m_excludeTagAction = new QAction(tr("Exclude Notes With This Tag"), this);
+    m_excludeTagAction->setCheckable(true);
+    connect(m_excludeTagAction, &QAction::triggered, this, [this](bool checked) {
+        auto tagId = m_currentEditingIndex.data(NodeItem::Roles::NodeId).toInt();
+        if (checked) {
+            m_excludedTagIds.insert(tagId);
+        } else {
+            m_excludedTagIds.remove(tagId);
+        }
+        viewport()->update();
+        reloadSelectedTags();
+    });
 
     m_contextMenuTimer.setInterval(100);
     m_contextMenuTimer.setSingleShot(true);
@@ -111,6 +139,11 @@ const QModelIndex &NodeTreeView::currentEditingIndex() const
     return m_currentEditingIndex;
 }
 
+bool NodeTreeView::isTagExcluded(int tagId) const
+{
+    return m_excludedTagIds.contains(tagId);
+}
+
 void NodeTreeView::setIgnoreThisCurrentLoad(bool newIgnoreThisCurrentLoad)
 {
     m_ignoreThisCurrentLoad = newIgnoreThisCurrentLoad;
@@ -127,6 +160,11 @@ void NodeTreeView::onFolderDropSuccessful(const QString &path)
     }
 }
 
+void NodeTreeView::onTagRemoved(int tagId)
+{
+    m_excludedTagIds.remove(tagId);
+}
+
 void NodeTreeView::onTagsDropSuccessful(const QSet<int> &ids)
 {
     auto *nodeTreeModel = static_cast<NodeTreeModel *>(model());
@@ -161,12 +199,14 @@ void NodeTreeView::reExpandC()
 {
     auto needExpand = std::move(m_expanded);
     QTreeView::reset();
+    auto *m = static_cast<NodeTreeModel *>(model());
     for (const auto &path : needExpand) {
-        auto *m = static_cast<NodeTreeModel *>(model());
-        auto index = m->folderIndexFromIdPath(path);
-        if (index.isValid()) {
-            expand(index);
-        }
+        // folders under collapsed ones expand once they are loaded
+        m->loadFolderIndex(path, this, [this](const QModelIndex &index) {
+            if (index.isValid()) {
+                expand(index);
+            }
+        });
     }
 }
 
@@ -188,7 +228,7 @@ void NodeTreeView::onChangeTagColorAction()
 void NodeTreeView::onRequestExpand(const QString &folderPath)
 {
     auto *nodeTreeModel = static_cast<NodeTreeModel *>(model());
-    expand(nodeTreeModel->folderIndexFromIdPath(folderPath));
+    nodeTreeModel->loadFolderIndex(folderPath, this, [this](const QModelIndex &index) { expand(index); });
 }
 
 void NodeTreeView::onUpdateAbsPath(const QString &oldPath, const QString &newPath)
@@ -275,7 +315,42 @@ void NodeTreeView::selectionChanged(const QItemSelection &selected, const QItemS
         }
         m_isLastSelectedFolder = false;
         emit saveSelected(false, {}, tagIds);
-        emit loadNotesInTagsRequested(tagIds);
+        emit loadNotesInTagsRequested(tagFilterFor(tagIds));
+    }
+}
+
+QSet<int> NodeTreeView::selectedTagIds() const
+{
+    QSet<int> tagIds;
+    const auto indexes = selectedIndexes();
+    for (const auto &index : indexes) {
+        auto itemType = static_cast<NodeItem::Type>(index.data(NodeItem::Roles::ItemType).toInt());
+        if (itemType == NodeItem::Type::TagItem) {
+            tagIds.insert(index.data(NodeItem::Roles::NodeId).toInt());
+        }
+    }
+    return tagIds;
+}
+
+TagFilter NodeTreeView::tagFilterFor(const QSet<int> &selectedTagIds) const
+{
+    TagFilter filter;
+    filter.mode = m_tagFilterMode;
+    for (const auto tagId : selectedTagIds) {
+        if (m_excludedTagIds.contains(tagId)) {
+            filter.excludedTagIds.insert(tagId);
+        } else {
+            filter.tagIds.insert(tagId);
+        }
+    }
+    return filter;
+}
+
+void NodeTreeView::reloadSelectedTags()
+{
+    auto tagIds = selectedTagIds();
+    if (!tagIds.isEmpty()) {
+        emit loadNotesInTagsRequested(tagFilterFor(tagIds));
     }
 }
 
@@ -349,21 +424,18 @@ void NodeTreeView::dropEvent(QDropEvent *event)
         auto dropIndex = indexAt(event->position().toPoint());
         if (dropIndex.isValid()) {
             auto itemType = static_cast<NodeItem::Type>(dropIndex.data(NodeItem::Roles::ItemType).toInt());
-            bool ok = false;
-            auto idl = QString::fromUtf8(event->mimeData()->data(NOTE_MIME)).split(PATH_SEPARATOR);
-            for (const auto &s : std::as_const(idl)) {
-                auto nodeId = s.toInt(&ok);
-                if (ok) {
-                    if (itemType == NodeItem::Type::FolderItem) {
-                        emit moveNodeRequested(nodeId, dropIndex.data(NodeItem::NodeId).toInt());
-                        event->acceptProposedAction();
-                    } else if (itemType == NodeItem::Type::TagItem) {
-                        emit addNoteToTag(nodeId, dropIndex.data(NodeItem::NodeId).toInt());
-                    } else if (itemType == NodeItem::Type::TrashButton) {
-                        emit moveNodeRequested(nodeId, TRASH_FOLDER_ID);
-                        event->acceptProposedAction();
-                    }
-                }
+            auto noteIds = decodeNoteMimeData(event->mimeData()->data(NOTE_MIME));
+            if (noteIds.isEmpty()) {
+                return;
+            }
+            if (itemType == NodeItem::Type::FolderItem) {
+                emit moveNotesRequested(noteIds, dropIndex.data(NodeItem::NodeId).toInt());
+                event->acceptProposedAction();
+            } else if (itemType == NodeItem::Type::TagItem) {
+                emit addNotesToTag(noteIds, dropIndex.data(NodeItem::NodeId).toInt());
+            } else if (itemType == NodeItem::Type::TrashButton) {
+                emit moveNotesRequested(noteIds, TRASH_FOLDER_ID);
+                event->acceptProposedAction();
             }
         }
     } else {
@@ -449,6 +521,13 @@ void NodeTreeView::onCustomContextMenu(QPoint point)
             m_contextMenu->addAction(m_changeTagColorAction);
             m_contextMenu->addAction(m_clearSelectionAction);
             m_contextMenu->addSeparator();
+            m_matchAllTagsAction->setChecked(m_tagFilterMode == TagFilterMode::All);
+            m_matchAnyTagAction->setChecked(m_tagFilterMode == TagFilterMode::Any);
+            m_excludeTagAction->setChecked(m_excludedTagIds.contains(index.data(NodeItem::Roles::NodeId).toInt()));
+            m_contextMenu->addAction(m_matchAllTagsAction);
+            m_contextMenu->addAction(m_matchAnyTagAction);
+            m_contextMenu->addAction(m_excludeTagAction);
+            m_contextMenu->addSeparator();
             m_contextMenu->addAction(m_deleteTagAction);
             m_contextMenu->exec(viewport()->mapToGlobal(point));
         }
@@ -4,6 +4,7 @@
 #include <QTreeView>
 #include <QTimer>
 #include "nodedata.h"
+#include "tagdata.h"
 #include "editorsettingsoptions.h"
 
 class QMenu;
@@ -37,6 +38,7 @@ public:
 
     void setIgnoreThisCurrentLoad(bool newIgnoreThisCurrentLoad);
     const QModelIndex &currentEditingIndex() const;
+    bool isTagExcluded(int tagId) const;
 
 public slots:
     void onCustomContextMenu(QPoint point);
@@ -45,6 +47,7 @@ public slots:
     void onUpdateAbsPath(const QString &oldPath, const QString &newPath);
     void onFolderDropSuccessful(const QString &path);
     void onTagsDropSuccessful(const QSet<int> &ids);
+    void onTagRemoved(int tagId);
 
 signals:
     void addFolderRequested();
@@ -53,12 +56,12 @@ signals:
     void renameTagInDatabase(const QModelIndex &index, const QString &newName);
     void deleteNodeRequested(const QModelIndex &index);
     void loadNotesInFolderRequested(int folderID, bool isRecursive, bool notInterested = false, int scrollToId = INVALID_NODE_ID);
-    void loadNotesInTagsRequested(const QSet<int> &tagIds, bool notInterested = false, int scrollToId = INVALID_NODE_ID);
-    void moveNodeRequested(int node, int target);
+    void loadNotesInTagsRequested(const TagFilter &filter, bool notInterested = false, int scrollToId = INVALID_NODE_ID);
+    void moveNotesRequested(const QList<int> &noteIds, int target);
     void renameTagRequested();
     void changeTagColorRequested(const QModelIndex &index);
     void deleteTagRequested(const QModelIndex &index);
-    void addNoteToTag(int noteId, int tagId);
+    void addNotesToTag(const QList<int> &noteIds, int tagId);
     void saveExpand(const QStringList &ex);
     void saveSelected(bool isSelectingFolder, const QString &folder, const QSet<int> &tags);
     void saveLastSelectedNote();
@@ -78,6 +81,9 @@ private:
     QAction *m_changeTagColorAction;
     QAction *m_deleteTagAction;
     QAction *m_clearSelectionAction;
+    QAction *m_matchAllTagsAction;
+    QAction *m_matchAnyTagAction;
+    QAction *m_excludeTagAction;
     QTimer m_contextMenuTimer;
     QVector<QModelIndex> m_treeSeparator;
     QModelIndex m_defaultNotesIndex;
@@ -90,8 +96,13 @@ private:
     bool m_ignoreThisCurrentLoad;
     QString m_lastSelectFolder;
     bool m_isLastSelectedFolder;
+    TagFilterMode m_tagFilterMode;
+    QSet<int> m_excludedTagIds;
     void updateEditingIndex(QPoint pos);
     void closeCurrentEditor();
+    QSet<int> selectedTagIds() const;
+    TagFilter tagFilterFor(const QSet<int> &selectedTagIds) const;
+    void reloadSelectedTags();
 
     // QAbstractItemView interface
 protected slots:
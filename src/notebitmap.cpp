@@ -0,0 +1,280 @@
+#include "notebitmap.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+auto constexpr CHUNK_BITS = 16;
+auto constexpr WORDS_PER_CHUNK = (1 << CHUNK_BITS) / 64;
+// above this many entries a bitset (8 KiB) is smaller than the sorted array
+auto constexpr SPARSE_LIMIT = 4096;
+
+quint16 highBits(int id)
+{
+    return static_cast<quint16>(static_cast<quint32>(id) >> CHUNK_BITS);
+}
+
+quint16 lowBits(int id)
+{
+    return static_cast<quint16>(static_cast<quint32>(id) & 0xFFFF);
+}
+} // namespace
+
+bool NoteBitmap::Chunk::contains(quint16 low) const
+{
+    if (isDense()) {
+        return (words[low >> 6] >> (low & 63)) & 1U;
+    }
+    return std::binary_search(values.cbegin(), values.cend(), low);
+}
+
+void NoteBitmap::Chunk::add(quint16 low)
+{
+    if (isDense()) {
+        auto &word = words[low >> 6];
+        auto const mask = quint64(1) << (low & 63);
+        if ((word & mask) == 0) {
+            word |= mask;
+            ++count;
+        }
+        return;
+    }
+    auto it = std::lower_bound(values.begin(), values.end(), low);
+    if (it != values.end() && *it == low) {
+        return;
+    }
+    values.insert(it, low);
+    ++count;
+    if (count > SPARSE_LIMIT) {
+        *this = fromWords(toWords());
+    }
+}
+
+void NoteBitmap::Chunk::remove(quint16 low)
+{
+    if (isDense()) {
+        auto &word = words[low >> 6];
+        auto const mask = quint64(1) << (low & 63);
+        if ((word & mask) != 0) {
+            word &= ~mask;
+            --count;
+            if (count <= SPARSE_LIMIT) {
+                *this = fromWords(words);
+            }
+        }
+        return;
+    }
+    auto it = std::lower_bound(values.begin(), values.end(), low);
+    if (it != values.end() && *it == low) {
+        values.erase(it);
+        --count;
+    }
+}
+
+QVector<quint64> NoteBitmap::Chunk::toWords() const
+{
+    if (isDense()) {
+        return words;
+    }
+    QVector<quint64> result(WORDS_PER_CHUNK, 0);
+    for (const auto low : values) {
+        result[low >> 6] |= quint64(1) << (low & 63);
+    }
+    return result;
+}
+
+NoteBitmap::Chunk NoteBitmap::Chunk::fromWords(const QVector<quint64> &words)
+{
+    Chunk chunk;
+    for (const auto word : words) {
+        chunk.count += qPopulationCount(word);
+    }
+    if (chunk.count > SPARSE_LIMIT) {
+        chunk.words = words;
+        return chunk;
+    }
+    chunk.values.reserve(chunk.count);
+    for (int i = 0; i < words.size(); ++i) {
+        auto word = words[i];
+        while (word != 0) {
+            chunk.values.append(static_cast<quint16>(i * 64 + qCountTrailingZeroBits(word)));
+            word &= word - 1;
+        }
+    }
+    return chunk;
+}
+
+NoteBitmap::Chunk NoteBitmap::Chunk::fromValues(QVector<quint16> &&values)
+{
+    Chunk chunk;
+    chunk.count = values.size();
+    chunk.values = std::move(values);
+    if (chunk.count > SPARSE_LIMIT) {
+        return fromWords(chunk.toWords());
+    }
+    return chunk;
+}
+
+void NoteBitmap::add(int id)
+{
+    if (id < 0) {
+        return;
+    }
+    m_chunks[highBits(id)].add(lowBits(id));
+}
+
+void NoteBitmap::remove(int id)
+{
+    if (id < 0) {
+        return;
+    }
+    auto it = m_chunks.find(highBits(id));
+    if (it == m_chunks.end()) {
+        return;
+    }
+    it->remove(lowBits(id));
+    if (it->count == 0) {
+        m_chunks.erase(it);
+    }
+}
+
+bool NoteBitmap::contains(int id) const
+{
+    if (id < 0) {
+        return false;
+    }
+    auto it = m_chunks.constFind(highBits(id));
+    return it != m_chunks.constEnd() && it->contains(lowBits(id));
+}
+
+bool NoteBitmap::isEmpty() const
+{
+    return m_chunks.isEmpty();
+}
+
+int NoteBitmap::count() const
+{
+    int result = 0;
+    for (const auto &chunk : m_chunks) {
+        result += chunk.count;
+    }
+    return result;
+}
+
+QVector<int> NoteBitmap::toVector() const
+{
+    QVector<int> result;
+    result.reserve(count());
+    for (auto it = m_chunks.constBegin(); it != m_chunks.constEnd(); ++it) {
+        auto const base = static_cast<int>(static_cast<quint32>(it.key()) << CHUNK_BITS);
+        if (it->isDense()) {
+            for (int i = 0; i < it->words.size(); ++i) {
+                auto word = it->words[i];
+                while (word != 0) {
+                    result.append(base + i * 64 + qCountTrailingZeroBits(word));
+                    word &= word - 1;
+                }
+            }
+        } else {
+            for (const auto low : it->values) {
+                result.append(base + low);
+            }
+        }
+    }
+    return result;
+}
+
+NoteBitmap NoteBitmap::operator&(const NoteBitmap &other) const
+{
+    NoteBitmap result;
+    for (auto it = m_chunks.constBegin(); it != m_chunks.constEnd(); ++it) {
+        auto otherIt = other.m_chunks.constFind(it.key());
+        if (otherIt == other.m_chunks.constEnd()) {
+            continue;
+        }
+        Chunk chunk;
+        if (it->isDense() && otherIt->isDense()) {
+            QVector<quint64> words(WORDS_PER_CHUNK);
+            for (int i = 0; i < WORDS_PER_CHUNK; ++i) {
+                words[i] = it->words[i] & otherIt->words[i];
+            }
+            chunk = Chunk::fromWords(words);
+        } else {
+            // at least one side is sparse, so the result is too
+            auto const &sparse = it->isDense() ? *otherIt : *it;
+            auto const &probe = it->isDense() ? *it : *otherIt;
+            QVector<quint16> values;
+            values.reserve(sparse.count);
+            if (probe.isDense()) {
+                std::copy_if(sparse.values.cbegin(), sparse.values.cend(), std::back_inserter(values),
+                             [&probe](quint16 low) { return probe.contains(low); });
+            } else {
+                std::set_intersection(sparse.values.cbegin(), sparse.values.cend(), probe.values.cbegin(), probe.values.cend(),
+                                      std::back_inserter(values));
+            }
+            chunk = Chunk::fromValues(std::move(values));
+        }
+        if (chunk.count > 0) {
+            result.m_chunks.insert(it.key(), chunk);
+        }
+    }
+    return result;
+}
+
+NoteBitmap NoteBitmap::operator|(const NoteBitmap &other) const
+{
+    NoteBitmap result = *this;
+    for (auto otherIt = other.m_chunks.constBegin(); otherIt != other.m_chunks.constEnd(); ++otherIt) {
+        auto it = result.m_chunks.find(otherIt.key());
+        if (it == result.m_chunks.end()) {
+            result.m_chunks.insert(otherIt.key(), *otherIt);
+            continue;
+        }
+        if (!it->isDense() && !otherIt->isDense()) {
+            QVector<quint16> values;
+            values.reserve(it->count + otherIt->count);
+            std::set_union(it->values.cbegin(), it->values.cend(), otherIt->values.cbegin(), otherIt->values.cend(),
+                           std::back_inserter(values));
+            *it = Chunk::fromValues(std::move(values));
+        } else {
+            auto words = it->toWords();
+            auto const otherWords = otherIt->toWords();
+            for (int i = 0; i < WORDS_PER_CHUNK; ++i) {
+                words[i] |= otherWords[i];
+            }
+            *it = Chunk::fromWords(words);
+        }
+    }
+    return result;
+}
+
+NoteBitmap NoteBitmap::operator-(const NoteBitmap &other) const
+{
+    NoteBitmap result;
+    for (auto it = m_chunks.constBegin(); it != m_chunks.constEnd(); ++it) {
+        auto otherIt = other.m_chunks.constFind(it.key());
+        if (otherIt == other.m_chunks.constEnd()) {
+            result.m_chunks.insert(it.key(), *it);
+            continue;
+        }
+        Chunk chunk;
+        if (it->isDense()) {
+            auto words = it->words;
+            auto const otherWords = otherIt->toWords();
+            for (int i = 0; i < WORDS_PER_CHUNK; ++i) {
+                words[i] &= ~otherWords[i];
+            }
+            chunk = Chunk::fromWords(words);
+        } else {
+            QVector<quint16> values;
+            values.reserve(it->count);
+            std::copy_if(it->values.cbegin(), it->values.cend(), std::back_inserter(values),
+                         [&otherIt](quint16 low) { return !otherIt->contains(low); });
+            chunk = Chunk::fromValues(std::move(values));
+        }
+        if (chunk.count > 0) {
+            result.m_chunks.insert(it.key(), chunk);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef NOTEBITMAP_H
+#define NOTEBITMAP_H
+
+#include <QMap>
+#include <QVector>
+
+// Compressed set of note ids, used by the in-memory tag index. Ids are split
+// into 65536 wide chunks by their high bits; a chunk keeps a sorted array of
+// the low bits while sparse and switches to a plain bitset once dense, the
+// same layout roaring bitmaps use.
+class NoteBitmap
+{
+public:
+    void add(int id);
+    void remove(int id);
+    bool contains(int id) const;
+    bool isEmpty() const;
+    int count() const;
+    QVector<int> toVector() const;
+
+    NoteBitmap operator&(const NoteBitmap &other) const;
+    NoteBitmap operator|(const NoteBitmap &other) const;
+    NoteBitmap operator-(const NoteBitmap &other) const;
+
+private:
+    struct Chunk
+    {
+        QVector<quint16> values; // sorted, while the chunk is sparse
+        QVector<quint64> words; // bitset, once the chunk is dense
+        int count = 0;
+
+        bool isDense() const { return !words.isEmpty(); }
+        bool contains(quint16 low) const;
+        void add(quint16 low);
+        void remove(quint16 low);
+        QVector<quint64> toWords() const;
+        static Chunk fromWords(const QVector<quint64> &words);
+        static Chunk fromValues(QVector<quint16> &&values);
+    };
+
+    QMap<quint16, Chunk> m_chunks;
+};
+
+#endif // NOTEBITMAP_H
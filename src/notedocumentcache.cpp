@@ -0,0 +1,146 @@
+#include "notedocumentcache.h"
+#include <QTextDocument>
+
+NoteDocumentCache::NoteDocumentCache(int maxCount, qsizetype maxBytes, qsizetype maxUndoBytes)
+    : m_maxCount{ maxCount }, m_maxBytes{ maxBytes }, m_maxUndoBytes{ maxUndoBytes }
+{
+}
+
+NoteDocumentCache::~NoteDocumentCache()
+{
+    for (const auto &entry : std::as_const(m_entries)) {
+        delete entry.document;
+    }
+}
+
+void NoteDocumentCache::setLimits(int maxCount, qsizetype maxBytes)
+{
+    m_maxCount = maxCount;
+    m_maxBytes = maxBytes;
+}
+
+void NoteDocumentCache::setUndoLimit(qsizetype maxUndoBytes)
+{
+    m_maxUndoBytes = maxUndoBytes;
+}
+
+NoteDocumentCache::Entry *NoteDocumentCache::find(int noteId)
+{
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].noteId == noteId) {
+            if (i > 0) {
+                m_entries.move(i, 0);
+            }
+            return &m_entries[0];
+        }
+    }
+    return nullptr;
+}
+
+NoteDocumentCache::Entry *NoteDocumentCache::insert(int noteId, QTextDocument *document, CustomMarkdownHighlighter *highlighter, const QString &content)
+{
+    remove(noteId);
+    m_entries.prepend({ noteId, document, highlighter, content, 0, 0, false });
+    return &m_entries[0];
+}
+
+void NoteDocumentCache::remove(int noteId)
+{
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].noteId == noteId) {
+            delete m_entries[i].document;
+            m_entries.removeAt(i);
+            return;
+        }
+    }
+}
+
+void NoteDocumentCache::evict(int keepNoteId)
+{
+    qsizetype totalBytes = 0;
+    for (const auto &entry : std::as_const(m_entries)) {
+        totalBytes += entryBytes(entry);
+    }
+    for (int i = m_entries.size() - 1; i >= 0 && (m_entries.size() > m_maxCount || totalBytes > m_maxBytes); --i) {
+        if (m_entries[i].noteId == keepNoteId) {
+            continue;
+        }
+        totalBytes -= entryBytes(m_entries[i]);
+        delete m_entries[i].document;
+        m_entries.removeAt(i);
+    }
+}
+
+void NoteDocumentCache::clear(int keepNoteId)
+{
+    for (int i = m_entries.size() - 1; i >= 0; --i) {
+        if (m_entries[i].noteId != keepNoteId) {
+            delete m_entries[i].document;
+            m_entries.removeAt(i);
+        }
+    }
+}
+
+// QTextDocument can't drop single undo steps, so a history over the budget
+// collapses into a checkpoint at the current text. The least recently used
+// documents lose theirs first.
+void NoteDocumentCache::trimUndo(int keepNoteId)
+{
+    auto total = undoBytes();
+    for (int i = m_entries.size() - 1; i >= 0 && total > m_maxUndoBytes; --i) {
+        if (m_entries[i].noteId != keepNoteId) {
+            total -= clearUndo(m_entries[i]);
+        }
+    }
+}
+
+void NoteDocumentCache::trimOpenUndo(int openNoteId)
+{
+    trimUndo(openNoteId);
+    for (auto &entry : m_entries) {
+        if (entry.noteId == openNoteId && entry.undoBytes > m_maxUndoBytes) {
+            clearUndo(entry);
+        }
+    }
+}
+
+int NoteDocumentCache::count() const
+{
+    return static_cast<int>(m_entries.size());
+}
+
+int NoteDocumentCache::undoSteps() const
+{
+    int steps = 0;
+    for (const auto &entry : m_entries) {
+        steps += entry.document->availableUndoSteps() + entry.document->availableRedoSteps();
+    }
+    return steps;
+}
+
+qsizetype NoteDocumentCache::undoBytes() const
+{
+    qsizetype total = 0;
+    for (const auto &entry : m_entries) {
+        total += entry.undoBytes;
+    }
+    return total;
+}
+
+qsizetype NoteDocumentCache::clearUndo(Entry &entry)
+{
+    auto const freed = entry.undoBytes;
+    if (freed == 0) {
+        return 0;
+    }
+    entry.document->clearUndoRedoStacks();
+    entry.undoBytes = 0;
+    return freed;
+}
+
+// Layout and formats grow with the text, so the text size plus the undo
+// history is used as the measure of a document.
+qsizetype NoteDocumentCache::entryBytes(const Entry &entry)
+{
+    return qsizetype(entry.document->characterCount()) * qsizetype(sizeof(QChar)) + entry.undoBytes;
+}
@@ -0,0 +1,68 @@
+#ifndef NOTEDOCUMENTCACHE_H
+#define NOTEDOCUMENTCACHE_H
+
+#include <QString>
+#include <QVector>
+
+class QTextDocument;
+class CustomMarkdownHighlighter;
+
+// Keeps the documents of recently edited notes alive, with their layout,
+// highlighting and undo history, so switching back to a note doesn't parse
+// it again. Bounded by a number of documents and by their total text size;
+// the least recently used documents go first. The cache owns the documents.
+// Undo histories have a budget of their own, see trimUndo().
+class NoteDocumentCache
+{
+public:
+    struct Entry
+    {
+        int noteId;
+        QTextDocument *document;
+        CustomMarkdownHighlighter *highlighter;
+        // the note content the document was last in sync with
+        QString content;
+        int cursorPosition;
+        // estimated memory of the undo history, grown by the editor
+        qsizetype undoBytes;
+        // shown without highlighting and undo, see NoteEditorLogic
+        bool isLargeNote;
+    };
+
+    NoteDocumentCache(int maxCount, qsizetype maxBytes, qsizetype maxUndoBytes);
+    ~NoteDocumentCache();
+    NoteDocumentCache(const NoteDocumentCache &) = delete;
+    NoteDocumentCache &operator=(const NoteDocumentCache &) = delete;
+
+    void setLimits(int maxCount, qsizetype maxBytes);
+    void setUndoLimit(qsizetype maxUndoBytes);
+    // Marks the entry as most recently used. The pointer is valid until the
+    // next call that inserts or removes entries.
+    Entry *find(int noteId);
+    Entry *insert(int noteId, QTextDocument *document, CustomMarkdownHighlighter *highlighter, const QString &content);
+    void remove(int noteId);
+    // Drops entries over the limits, never the one of keepNoteId (the note
+    // in the editor, whose document must stay alive).
+    void evict(int keepNoteId);
+    void clear(int keepNoteId);
+    // Clears undo histories while they are over the budget, never the one of
+    // keepNoteId (the note in the editor), see trimOpenUndo().
+    void trimUndo(int keepNoteId);
+    // Like trimUndo(), then also clears the history of openNoteId once it
+    // alone is over the budget. Must not run inside an edit block.
+    void trimOpenUndo(int openNoteId);
+    int count() const;
+    int undoSteps() const;
+    qsizetype undoBytes() const;
+
+private:
+    static qsizetype entryBytes(const Entry &entry);
+    static qsizetype clearUndo(Entry &entry);
+
+    int m_maxCount;
+    qsizetype m_maxBytes;
+    qsizetype m_maxUndoBytes;
+    QVector<Entry> m_entries; // most recently used first
+};
+
+#endif // NOTEDOCUMENTCACHE_H
@@ -2,6 +2,8 @@
 #include "customDocument.h"
 #include "customMarkdownHighlighter.h"
 #include "dbmanager.h"
+#include "dbmanagerasync.h"
+#include "dbscheduler.h"
 #include "taglistview.h"
 #include "taglistmodel.h"
 #include "tagpool.h"
@@ -12,11 +14,78 @@
 #include <QListWidget>
 #include <QDebug>
 #include <QCursor>
+#include <QTextCursor>
+#include <QTextBlock>
+#include <QAbstractTextDocumentLayout>
+#include <QTextDocument>
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+#include <algorithm>
 
 namespace {
 auto constexpr FIRST_LINE_MAX = 80;
+auto constexpr DEFAULT_DOCUMENT_CACHE_COUNT = 8;
+auto constexpr DEFAULT_DOCUMENT_CACHE_BYTES = qsizetype(64) * 1024 * 1024;
+auto constexpr DEFAULT_UNDO_BYTES = qsizetype(32) * 1024 * 1024;
+// what the undo history keeps per edit besides the text, roughly
+auto constexpr UNDO_STEP_BYTES = 64;
+// notes at least this long (in characters) are opened off the GUI thread
+auto constexpr BACKGROUND_PREPARE_SIZE = 256 * 1024;
+// content is saved this long after the last edit, and at most this long
+// after the first unsaved one
+auto constexpr AUTOSAVE_IDLE_MS = 750;
+auto constexpr AUTOSAVE_MAX_LATENCY_MS = 5000;
+auto constexpr METADATA_SAVE_IDLE_MS = 3000;
+
+// same as QTextEdit::setText(); a large note is always plain text and keeps
+// no undo history, which would hold on to a copy of every edit
+void setDocumentContent(QTextDocument *document, const QString &content, bool isLargeNote)
+{
+    document->setUndoRedoEnabled(!isLargeNote);
+    if (!isLargeNote && Qt::mightBeRichText(content)) {
+        document->setHtml(content);
+    } else {
+        document->setPlainText(content);
+    }
 }
 
+// the text toPlainText() has for [position, position + length)
+QString plainTextAt(QTextDocument *document, int position, int length)
+{
+    if (length == 0) {
+        return QString();
+    }
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(position + length, QTextCursor::KeepAnchor);
+    auto text = cursor.selectedText();
+    for (auto &c : text) {
+        switch (c.unicode()) {
+        case 0xfdd0: // QTextBeginningOfFrame
+        case 0xfdd1: // QTextEndOfFrame
+        case QChar::ParagraphSeparator:
+        case QChar::LineSeparator:
+            c = QLatin1Char('\n');
+            break;
+        case QChar::Nbsp:
+            c = QLatin1Char(' ');
+            break;
+        default:
+            break;
+        }
+    }
+    return text;
+}
+
+// lines getNthLine() would pick as title or preview
+bool isTextLine(const QString &line)
+{
+    auto const trimmed = line.trimmed();
+    return !trimmed.isEmpty() && !trimmed.startsWith("---") && !trimmed.startsWith("```");
+}
+} // namespace
+
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
 
 NoteEditorLogic::NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLabel, QLineEdit *searchEdit, QWidget *kanbanWidget, TagListView *tagListView,
@@ -27,7 +96,13 @@ NoteEditorLogic::NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLab
 #endif
     : QObject(parent),
       m_textEdit{ textEdit },
-      m_highlighter{ new CustomMarkdownHighlighter{ m_textEdit->document() } },
+      m_scratchDocument{ new QTextDocument{ this } },
+      m_highlighter{ new CustomMarkdownHighlighter{ m_scratchDocument } },
+      m_scratchHighlighter{ m_highlighter },
+      m_documentCache{ DEFAULT_DOCUMENT_CACHE_COUNT, DEFAULT_DOCUMENT_CACHE_BYTES, DEFAULT_UNDO_BYTES },
+      m_markdownEnabled{ true },
+      m_theme{ Theme::Light },
+      m_editorFontSize{ 0 },
       m_editorDateLabel{ editorDateLabel },
       m_searchEdit{ searchEdit },
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
@@ -36,28 +111,69 @@ NoteEditorLogic::NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLab
       m_tagListView{ tagListView },
       m_dbManager{ dbManager },
       m_isContentModified{ false },
+      m_isMetadataModified{ false },
+      m_isOutlineModified{ false },
+      m_documentRevision{ -1 },
+      m_hasUnsyncedEdits{ false },
+      m_isMovedToListTop{ false },
+      m_leadingTextEnd{ 0 },
+      m_unsavedDeltaSize{ 0 },
+      m_savedLength{ 0 },
+      m_contentLength{ 0 },
+      m_canSaveDeltas{ false },
+      m_pendingJumpNoteId{ INVALID_NODE_ID },
+      m_pendingJumpBlock{ 0 },
+      m_isLargeNoteMode{ false },
       m_spacerColor{ 191, 191, 191 },
       m_currentAdaptableEditorPadding{ 0 },
       m_currentMinimumEditorPadding{ 0 }
 {
-    connect(m_textEdit, &QTextEdit::textChanged, this, &NoteEditorLogic::onTextEditTextChanged);
-    connect(this, &NoteEditorLogic::requestCreateUpdateNote, m_dbManager, &DBManager::onCreateUpdateRequestedNoteContent, Qt::QueuedConnection);
-    // auto save timer
+    // notes get documents of their own, see showNoteDocument(); this one is
+    // for everything else (nothing or several notes shown)
+    matchEditorDocumentSettings(m_scratchDocument);
+    m_textEdit->setDocument(m_scratchDocument);
+    connect(m_textEdit->document(), &QTextDocument::contentsChange, this, &NoteEditorLogic::onDocumentContentsChange);
+    // saves go through the scheduler so they get ahead of queued list reads
+    connect(this, &NoteEditorLogic::requestCreateUpdateNote, this, [dbManager = m_dbManager](const NodeData &note) {
+        dbManager->scheduler()->post(DBScheduler::Priority::UserWrite, [dbManager, note]() { dbManager->onCreateUpdateRequestedNoteContent(note); });
+    });
+    connect(this, &NoteEditorLogic::requestSaveNoteDeltas, this,
+            [dbManager = m_dbManager](const NodeData &note, const QVector<ContentDelta> &deltas, int baseLength) {
+                dbManager->scheduler()->post(DBScheduler::Priority::UserWrite,
+                                             [dbManager, note, deltas, baseLength]() { dbManager->onNoteContentDeltasRequested(note, deltas, baseLength); });
+            });
+    connect(m_dbManager, &DBManager::noteContentOutOfSync, this, &NoteEditorLogic::onNoteContentOutOfSync, Qt::QueuedConnection);
+    connect(this, &NoteEditorLogic::requestUpdateNoteScrollBarPosition, this, [dbManager = m_dbManager](int noteId, int scrollBarPosition) {
+        dbManager->scheduler()->post(DBScheduler::Priority::UserWrite,
+                                     [dbManager, noteId, scrollBarPosition]() { dbManager->updateNoteScrollBarPosition(noteId, scrollBarPosition); });
+    });
+    connect(this, &NoteEditorLogic::requestUpdateNoteOutline, this, [dbManager = m_dbManager](const NodeData &note, const QVector<NoteHeading> &outline) {
+        dbManager->scheduler()->post(DBScheduler::Priority::UserWrite, [dbManager, note, outline]() { dbManager->updateNoteOutline(note, outline); });
+    });
+    // auto save timers
     m_autoSaveTimer.setSingleShot(true);
-    m_autoSaveTimer.setInterval(50);
+    m_autoSaveTimer.setInterval(AUTOSAVE_IDLE_MS);
     connect(&m_autoSaveTimer, &QTimer::timeout, this, [this]() { saveNoteToDB(); });
+    m_autoSaveDeadlineTimer.setSingleShot(true);
+    m_autoSaveDeadlineTimer.setInterval(AUTOSAVE_MAX_LATENCY_MS);
+    connect(&m_autoSaveDeadlineTimer, &QTimer::timeout, this, [this]() { saveNoteToDB(); });
+    m_metadataSaveTimer.setSingleShot(true);
+    m_metadataSaveTimer.setInterval(METADATA_SAVE_IDLE_MS);
+    connect(&m_metadataSaveTimer, &QTimer::timeout, this, [this]() { saveNoteToDB(); });
+    connect(m_textEdit, &CustomDocument::focusLost, this, [this]() { saveNoteToDB(); });
     m_tagListModel = new TagListModel{ this };
     m_tagListModel->setTagPool(tagPool);
     m_tagListView->setModel(m_tagListModel);
     m_tagListDelegate = new TagListDelegate{ this };
     m_tagListView->setItemDelegate(m_tagListDelegate);
     connect(tagPool, &TagPool::dataUpdated, this, [this](int) { showTagListForCurrentNote(); });
+    connect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, &NoteEditorLogic::updateHighlightingPriority);
     connect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
-        if (m_currentNotes.size() == 1 && m_currentNotes[0].id() != INVALID_NODE_ID) {
+        if (m_currentNotes.size() == 1 && m_currentNotes[0].id() != INVALID_NODE_ID && m_currentNotes[0].scrollBarPosition() != value) {
             m_currentNotes[0].setScrollBarPosition(value);
             emit updateNoteDataInList(m_currentNotes[0]);
-            m_isContentModified = true;
-            m_autoSaveTimer.start();
+            m_isMetadataModified = true;
+            m_metadataSaveTimer.start();
         }
     });
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
@@ -88,19 +204,379 @@ NoteEditorLogic::NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLab
 
 bool NoteEditorLogic::markdownEnabled() const
 {
-    return m_highlighter->document() != nullptr;
+    return m_markdownEnabled;
 }
 
 void NoteEditorLogic::setMarkdownEnabled(bool enabled)
 {
-    m_highlighter->setDocument(enabled ? m_textEdit->document() : nullptr);
+    m_markdownEnabled = enabled;
+    m_highlighter->setDocument(enabled && !m_isLargeNoteMode ? m_textEdit->document() : nullptr);
+    if (m_scratchHighlighter != m_highlighter) {
+        m_scratchHighlighter->setDocument(enabled ? m_scratchDocument : nullptr);
+    }
+    // the other cached documents are still highlighted the old way
+    m_documentCache.clear(currentEditingNoteId());
+}
+
+void NoteEditorLogic::setDocumentCacheLimits(int maxCount, qsizetype maxBytes)
+{
+    m_documentCache.setLimits(maxCount, maxBytes);
+    m_documentCache.evict(currentEditingNoteId());
+}
+
+void NoteEditorLogic::setUndoMemoryLimit(qsizetype maxBytes)
+{
+    m_documentCache.setUndoLimit(maxBytes);
+    m_documentCache.trimUndo(currentEditingNoteId());
+}
+
+// Undo histories of the cached documents, for diagnostics
+QVariantMap NoteEditorLogic::undoMemoryInfo() const
+{
+    return { { QStringLiteral("documents"), m_documentCache.count() },
+             { QStringLiteral("undoSteps"), m_documentCache.undoSteps() },
+             { QStringLiteral("undoBytes"), static_cast<qlonglong>(m_documentCache.undoBytes()) } };
+}
+
+// Documents of big notes built in the background, for diagnostics
+QVariantMap NoteEditorLogic::documentPrepareInfo() const
+{
+    return { { QStringLiteral("documents"), m_prepareStats.documents },
+             { QStringLiteral("prepareMs"), m_prepareStats.prepareTime },
+             { QStringLiteral("attachMs"), m_prepareStats.attachTime },
+             { QStringLiteral("maxAttachMs"), m_prepareStats.maxAttachTime } };
+}
+
+// Autosaves of the notes that were edited, for diagnostics
+QVariantMap NoteEditorLogic::autoSaveInfo() const
+{
+    return { { QStringLiteral("notes"), m_saveTotals.notes },
+             { QStringLiteral("contentSaves"), m_saveTotals.contentSaves },
+             { QStringLiteral("metadataSaves"), m_saveTotals.metadataSaves },
+             { QStringLiteral("bytes"), m_saveTotals.bytes },
+             { QStringLiteral("shownMs"), m_saveTotals.shownTime } };
+}
+
+// Second half of showing a single note, once its document is in the editor.
+void NoteEditorLogic::finishShowingNote()
+{
+    if (!m_saveStats.shownTimer.isValid()) {
+        m_saveStats.shownTimer.start();
+    }
+    m_textEdit->blockSignals(true);
+    //     fixing bug #202
+    m_textEdit->setTextBackgroundColor(QColor(247, 247, 247, 0));
+    resetEditTracking();
+    // set scrollbar position
+    m_textEdit->verticalScrollBar()->setValue(m_currentNotes[0].scrollBarPosition());
+    updateHighlightingPriority();
+    attachHighlighter();
+    m_textEdit->blockSignals(false);
+    m_textEdit->setReadOnly(false);
+    m_textEdit->setTextInteractionFlags(Qt::TextEditorInteraction);
+    m_textEdit->setFocusPolicy(Qt::StrongFocus);
+    highlightSearch();
+    if (m_pendingJumpNoteId == currentEditingNoteId()) {
+        jumpToBlock(m_pendingJumpBlock);
+    }
+    m_pendingJumpNoteId = INVALID_NODE_ID;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    if (m_kanbanWidget != nullptr && m_kanbanWidget->isVisible()) {
+        emit clearKanbanModel();
+        bool shouldRecheck = checkForTasksInEditor();
+        if (shouldRecheck) {
+            checkForTasksInEditor();
+        }
+        m_textEdit->setVisible(false);
+        return;
+    }
+    m_textEdit->setVisible(true);
+
+#else
+    m_textEdit->setVisible(true);
+#endif
+    emit textShown();
+}
+
+// Shows the cached document of the note, or a new one if the note isn't
+// cached or its content was changed outside of the editor. A big note gets
+// its document built on a worker thread: false means a placeholder is shown
+// until onDocumentPrepared() attaches it.
+bool NoteEditorLogic::showNoteDocument(const NodeData &note)
+{
+    if (note.isContentPrefix()) {
+        loadNoteContent(note);
+        showPlaceholder();
+        return false;
+    }
+    auto *entry = m_documentCache.find(note.id());
+    if (entry != nullptr && entry->content != note.content()) {
+        if (entry->document == m_textEdit->document()) {
+            setEditorDocument(m_scratchDocument, m_scratchHighlighter);
+        }
+        m_documentCache.remove(note.id());
+        entry = nullptr;
+    }
+    if (entry == nullptr) {
+        if (note.content().size() >= BACKGROUND_PREPARE_SIZE) {
+            prepareDocument(note);
+            showPlaceholder();
+            return false;
+        }
+        auto const isLargeNote = opensAsLargeNote(note);
+        auto *document = new QTextDocument;
+        matchEditorDocumentSettings(document);
+        setDocumentContent(document, note.content(), isLargeNote);
+        entry = m_documentCache.insert(note.id(), document, createHighlighter(document), note.content());
+        entry->isLargeNote = isLargeNote;
+    }
+    setEditorDocument(entry->document, entry->highlighter);
+    setLargeNoteMode(entry->isLargeNote);
+    QTextCursor cursor(entry->document);
+    cursor.setPosition(std::min(entry->cursorPosition, entry->document->characterCount() - 1));
+    m_textEdit->setTextCursor(cursor);
+    m_documentCache.evict(note.id());
+    m_documentCache.trimUndo(note.id());
+    return true;
+}
+
+// Notes over LARGE_NOTE_SIZE open without highlighting and undo, unless the
+// user turned them back on for the note, see enableFullFeatures().
+bool NoteEditorLogic::opensAsLargeNote(const NodeData &note) const
+{
+    return note.content().size() > LARGE_NOTE_SIZE && !m_fullFeatureNoteIds.contains(note.id());
+}
+
+bool NoteEditorLogic::isLargeNoteMode() const
+{
+    return m_isLargeNoteMode;
+}
+
+void NoteEditorLogic::setLargeNoteMode(bool isLargeNoteMode)
+{
+    if (m_isLargeNoteMode != isLargeNoteMode) {
+        m_isLargeNoteMode = isLargeNoteMode;
+        emit largeNoteModeChanged(isLargeNoteMode);
+    }
+}
+
+// Turns highlighting and undo back on for the large note shown
+void NoteEditorLogic::enableFullFeatures()
+{
+    if (!m_isLargeNoteMode || !isNoteDocumentShown()) {
+        return;
+    }
+    auto *entry = m_documentCache.find(currentEditingNoteId());
+    if (entry == nullptr || entry->document != m_textEdit->document()) {
+        return;
+    }
+    m_fullFeatureNoteIds.insert(entry->noteId);
+    entry->isLargeNote = false;
+    entry->document->setUndoRedoEnabled(true);
+    setLargeNoteMode(false);
+    updateHighlightingPriority();
+    attachHighlighter();
+}
+
+// The highlighter is owned by the document but only highlights it once it's
+// shown, see attachHighlighter()
+CustomMarkdownHighlighter *NoteEditorLogic::createHighlighter(QTextDocument *document) const
+{
+    auto *highlighter = new CustomMarkdownHighlighter{ nullptr };
+    highlighter->setParent(document);
+    if (m_editorFontSize > 0) {
+        highlighter->setTheme(m_theme, m_editorTextColor, m_editorFontSize);
+    }
+    return highlighter;
+}
+
+// Called once the priority range is set for the document in the editor, so
+// the first pass over it starts with the visible blocks.
+void NoteEditorLogic::attachHighlighter()
+{
+    auto *document = m_textEdit->document();
+    if (m_markdownEnabled && !m_isLargeNoteMode && m_highlighter->document() != document) {
+        m_highlighter->setDocument(document);
+    }
+}
+
+// A large note comes from the list with only the start of its content, the
+// rest is read on the DBManager thread when the note is opened.
+void NoteEditorLogic::loadNoteContent(const NodeData &note)
+{
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getNode(note.id()), [this, noteId = note.id()](const NodeData &node) {
+        // the note may have been left, or loaded already, meanwhile
+        if (currentEditingNoteId() != noteId || !m_currentNotes[0].isContentPrefix() || node.id() != noteId) {
+            return;
+        }
+        m_currentNotes[0].setContent(node.content());
+        m_currentNotes[0].setIsContentPrefix(false);
+        m_textEdit->blockSignals(true);
+        auto const isShown = showNoteDocument(m_currentNotes[0]);
+        m_textEdit->blockSignals(false);
+        if (isShown) {
+            finishShowingNote();
+        }
+    });
+}
+
+// Builds the document with the text on a worker thread. Highlighting stays
+// on the GUI thread: the bundled highlighter shares its format tables
+// between instances, and it already starts with the visible blocks.
+void NoteEditorLogic::prepareDocument(const NodeData &note)
+{
+    auto const *current = m_textEdit->document();
+    auto const font = current->defaultFont();
+    auto const tabStopDistance = current->defaultTextOption().tabStopDistance();
+    auto const content = note.content();
+    auto const isLargeNote = opensAsLargeNote(note);
+    auto *guiThread = thread();
+    auto future = QtConcurrent::run([font, tabStopDistance, content, isLargeNote, guiThread]() {
+        QElapsedTimer timer;
+        timer.start();
+        auto *document = new QTextDocument;
+        document->setDefaultFont(font);
+        auto option = document->defaultTextOption();
+        option.setTabStopDistance(tabStopDistance);
+        document->setDefaultTextOption(option);
+        setDocumentContent(document, content, isLargeNote);
+        document->moveToThread(guiThread);
+        return PreparedDocument{ document, timer.elapsed(), isLargeNote };
+    });
+    auto *watcher = new QFutureWatcher<PreparedDocument>(this);
+    connect(watcher, &QFutureWatcher<PreparedDocument>::finished, this, [this, watcher, note]() {
+        watcher->deleteLater();
+        onDocumentPrepared(note, watcher->result());
+    });
+    watcher->setFuture(future);
+}
+
+void NoteEditorLogic::onDocumentPrepared(const NodeData &note, const PreparedDocument &prepared)
+{
+    QElapsedTimer attachTimer;
+    attachTimer.start();
+    auto *entry = m_documentCache.find(note.id());
+    if (entry != nullptr && (entry->content == note.content() || entry->document == m_textEdit->document())) {
+        // prepared twice (the note was left and opened again meanwhile), or
+        // already open for editing
+        delete prepared.document;
+    } else {
+        entry = m_documentCache.insert(note.id(), prepared.document, createHighlighter(prepared.document), note.content());
+        entry->isLargeNote = prepared.isLargeNote;
+    }
+    // the placeholder is still up if the note wasn't left meanwhile
+    if (currentEditingNoteId() == note.id() && m_textEdit->document() == m_scratchDocument) {
+        m_textEdit->blockSignals(true);
+        auto const isShown = showNoteDocument(m_currentNotes[0]);
+        m_textEdit->blockSignals(false);
+        if (isShown) {
+            finishShowingNote();
+        }
+    } else {
+        m_documentCache.evict(currentEditingNoteId());
+        m_documentCache.trimUndo(currentEditingNoteId());
+    }
+    auto const attachTime = attachTimer.elapsed();
+    ++m_prepareStats.documents;
+    m_prepareStats.prepareTime += prepared.prepareTime;
+    m_prepareStats.attachTime += attachTime;
+    m_prepareStats.maxAttachTime = std::max(m_prepareStats.maxAttachTime, attachTime);
+}
+
+void NoteEditorLogic::showPlaceholder()
+{
+    setEditorDocument(m_scratchDocument, m_scratchHighlighter);
+    m_textEdit->setPlainText(tr("Opening note..."));
+    m_textEdit->setReadOnly(true);
+    m_textEdit->setTextInteractionFlags(Qt::NoTextInteraction);
+    resetEditTracking();
+}
+
+void NoteEditorLogic::setEditorDocument(QTextDocument *document, CustomMarkdownHighlighter *highlighter)
+{
+    if (document == m_scratchDocument) {
+        setLargeNoteMode(false);
+    }
+    auto *current = m_textEdit->document();
+    if (current == document) {
+        return;
+    }
+    disconnect(current, &QTextDocument::contentsChange, this, &NoteEditorLogic::onDocumentContentsChange);
+    matchEditorDocumentSettings(document);
+    m_textEdit->setDocument(document);
+    connect(document, &QTextDocument::contentsChange, this, &NoteEditorLogic::onDocumentContentsChange);
+    m_highlighter = highlighter;
+}
+
+// The editor applies its font and tab stops to the document it shows, so a
+// detached document may have missed changes to them.
+void NoteEditorLogic::matchEditorDocumentSettings(QTextDocument *document) const
+{
+    auto const *current = m_textEdit->document();
+    if (document == current) {
+        return;
+    }
+    if (document->defaultFont() != current->defaultFont()) {
+        document->setDefaultFont(current->defaultFont());
+    }
+    auto option = document->defaultTextOption();
+    if (option.tabStopDistance() != current->defaultTextOption().tabStopDistance()) {
+        option.setTabStopDistance(current->defaultTextOption().tabStopDistance());
+        document->setDefaultTextOption(option);
+    }
 }
 
-void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &notes)
+void NoteEditorLogic::rememberCursorPosition()
+{
+    auto *entry = m_documentCache.find(currentEditingNoteId());
+    if (entry != nullptr && entry->document == m_textEdit->document()) {
+        entry->cursorPosition = m_textEdit->textCursor().position();
+    }
+}
+
+// The visible blocks, plus a screen above and below, are highlighted first;
+// the rest of a big note is highlighted in the background.
+void NoteEditorLogic::updateHighlightingPriority()
+{
+    auto *viewport = m_textEdit->viewport();
+    auto const first = m_textEdit->cursorForPosition(QPoint(0, 0)).blockNumber();
+    auto const last = m_textEdit->cursorForPosition(QPoint(viewport->width(), viewport->height())).blockNumber();
+    auto const margin = last - first + 1;
+    m_highlighter->setPriorityRange(std::max(0, first - margin), last + margin);
+}
+
+void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &listNotes)
 {
     auto currentId = currentEditingNoteId();
+    // the list only has the leading lines of a note with unsaved edits
+    auto notes = listNotes;
+    if (currentId != INVALID_NODE_ID && m_hasUnsyncedEdits) {
+        syncContentFromDocument();
+        for (auto &note : notes) {
+            if (note.id() == currentId) {
+                note.setContent(m_currentNotes[0].content());
+            }
+        }
+    }
+    // and only the start of a large note
+    for (auto &note : notes) {
+        if (!note.isContentPrefix()) {
+            continue;
+        }
+        if (note.id() == currentId) {
+            note.setContent(m_currentNotes[0].content());
+            note.setIsContentPrefix(m_currentNotes[0].isContentPrefix());
+        } else if (auto *entry = m_documentCache.find(note.id())) {
+            note.setContent(entry->content);
+            note.setIsContentPrefix(false);
+        }
+    }
+    rememberCursorPosition();
     if (notes.size() == 1 && notes[0].id() != INVALID_NODE_ID) {
         if (currentId != INVALID_NODE_ID && notes[0].id() != currentId) {
+            saveNoteToDB();
+            saveNoteOutline();
+            collectSaveStats();
             emit noteEditClosed(m_currentNotes[0], false);
         }
 
@@ -113,52 +589,30 @@ void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &notes)
 
         m_currentNotes = notes;
         showTagListForCurrentNote();
-        //     fixing bug #202
-        m_textEdit->setTextBackgroundColor(QColor(247, 247, 247, 0));
 
-        QString content = notes[0].content();
+        // set date
         QDateTime dateTime = notes[0].lastModificationdateTime();
-        int scrollbarPos = notes[0].scrollBarPosition();
-
-        // set text and date
-        bool isTextChanged = content != m_textEdit->toPlainText();
-        if (isTextChanged) {
-            m_textEdit->setText(content);
-        }
         QString noteDate = dateTime.toString(Qt::ISODate);
         QString noteDateEditor = getNoteDateEditor(noteDate);
         m_editorDateLabel->setText(noteDateEditor);
-        // set scrollbar position
-        m_textEdit->verticalScrollBar()->setValue(scrollbarPos);
+        // set text, a big note shows a placeholder until its document is ready
+        auto const isShown = showNoteDocument(notes[0]);
         m_textEdit->blockSignals(false);
-        m_textEdit->setReadOnly(false);
-        m_textEdit->setTextInteractionFlags(Qt::TextEditorInteraction);
-        m_textEdit->setFocusPolicy(Qt::StrongFocus);
-        highlightSearch();
-#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
-        if (m_kanbanWidget != nullptr && m_kanbanWidget->isVisible()) {
-            emit clearKanbanModel();
-            bool shouldRecheck = checkForTasksInEditor();
-            if (shouldRecheck) {
-                checkForTasksInEditor();
-            }
-            m_textEdit->setVisible(false);
-            return;
+        if (isShown) {
+            finishShowingNote();
         }
-        m_textEdit->setVisible(true);
-
-#else
-        m_textEdit->setVisible(true);
-#endif
-        emit textShown();
     } else if (notes.size() > 1) {
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
         emit checkMultipleNotesSelected(QVariant(true));
 #endif
+        saveNoteToDB();
+        saveNoteOutline();
+        collectSaveStats();
         m_currentNotes = notes;
         m_tagListView->setVisible(false);
         m_textEdit->blockSignals(true);
         auto verticalScrollBarValueToRestore = m_textEdit->verticalScrollBar()->value();
+        setEditorDocument(m_scratchDocument, m_scratchHighlighter);
         m_textEdit->clear();
         auto padding = m_currentAdaptableEditorPadding > m_currentMinimumEditorPadding ? m_currentAdaptableEditorPadding : m_currentMinimumEditorPadding;
         QPixmap sep(QSize{ m_textEdit->width() - (padding * 2) - 12, 4 });
@@ -188,6 +642,7 @@ void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &notes)
         }
         m_textEdit->verticalScrollBar()->setValue(verticalScrollBarValueToRestore);
         m_textEdit->blockSignals(false);
+        resetEditTracking();
         m_textEdit->setReadOnly(true);
         m_textEdit->setTextInteractionFlags(Qt::TextSelectableByMouse);
         m_textEdit->setFocusPolicy(Qt::NoFocus);
@@ -195,36 +650,153 @@ void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &notes)
     }
 }
 
-void NoteEditorLogic::onTextEditTextChanged()
+// Keystrokes only record what changed: the document is serialized when the
+// note is saved, and the title is re-derived only when the edit touches the
+// leading lines it comes from.
+void NoteEditorLogic::onDocumentContentsChange(int position, int charsRemoved, int charsAdded)
 {
-    if (currentEditingNoteId() != INVALID_NODE_ID) {
-        m_textEdit->blockSignals(true);
-        QString content = m_currentNotes[0].content();
-        if (m_textEdit->toPlainText() != content) {
-            // move note to the top of the list
-            emit moveNoteToListViewTop(m_currentNotes[0]);
-
-            // Get the new data
-            QString firstline = getFirstLine(m_textEdit->toPlainText());
-            QDateTime dateTime = QDateTime::currentDateTime();
-            QString noteDate = dateTime.toString(Qt::ISODate);
-            m_editorDateLabel->setText(NoteEditorLogic::getNoteDateEditor(noteDate));
-            // update note data
-            m_currentNotes[0].setContent(m_textEdit->toPlainText());
-            m_currentNotes[0].setFullTitle(firstline);
-            m_currentNotes[0].setLastModificationDateTime(dateTime);
-            m_currentNotes[0].setIsTempNote(false);
-            m_currentNotes[0].setScrollBarPosition(m_textEdit->verticalScrollBar()->value());
-            // update note data in list view
-            emit updateNoteDataInList(m_currentNotes[0]);
-            m_isContentModified = true;
-            m_autoSaveTimer.start();
-            emit setVisibilityOfFrameRightWidgets(false);
+    // without undo (a large note) the revision stays as it is, but such a
+    // document has no highlighter either, so every change is an edit
+    if (auto const *document = m_textEdit->document(); document->isUndoRedoEnabled()) {
+        auto const revision = document->revision();
+        if (revision == m_documentRevision) {
+            // only formats changed, e.g. by the highlighter
+            return;
         }
-        m_textEdit->blockSignals(false);
+        m_documentRevision = revision;
+    }
+    if (m_textEdit->signalsBlocked()) {
+        // the text was replaced by us, not edited
+        m_canSaveDeltas = false;
+        return;
+    }
+    if (currentEditingNoteId() == INVALID_NODE_ID) {
+        qDebug() << "NoteEditorLogic::onDocumentContentsChange() : m_currentNote is not valid";
+        return;
+    }
+    recordContentDelta(position, charsRemoved, charsAdded);
+    if (auto *entry = m_documentCache.find(m_currentNotes[0].id());
+        entry != nullptr && entry->document == m_textEdit->document() && entry->document->isUndoRedoEnabled()) {
+        entry->undoBytes += qsizetype(charsRemoved + charsAdded) * qsizetype(sizeof(QChar)) + UNDO_STEP_BYTES;
+    }
+
+    m_hasUnsyncedEdits = true;
+    auto const touchesLeadingText = position <= m_leadingTextEnd;
+
+    // move note to the top of the list, once until the edits are saved
+    if (!m_isMovedToListTop) {
+        m_isMovedToListTop = true;
+        emit moveNoteToListViewTop(m_currentNotes[0]);
+    }
+
+    QDateTime dateTime = QDateTime::currentDateTime();
+    QString noteDate = dateTime.toString(Qt::ISODate);
+    m_editorDateLabel->setText(NoteEditorLogic::getNoteDateEditor(noteDate));
+    // update note data
+    if (touchesLeadingText) {
+        updateLeadingText();
+        m_currentNotes[0].setFullTitle(getFirstLine(m_leadingText));
+    }
+    m_currentNotes[0].setLastModificationDateTime(dateTime);
+    m_currentNotes[0].setIsTempNote(false);
+    m_currentNotes[0].setScrollBarPosition(m_textEdit->verticalScrollBar()->value());
+    // the list only shows the first lines of the content, the full content
+    // reaches it on save
+    NodeData listNote = m_currentNotes[0];
+    listNote.setContent(m_leadingText);
+    listNote.setIsContentPrefix(true);
+    emit updateNoteDataInList(listNote);
+    scheduleAutoSave();
+    emit setVisibilityOfFrameRightWidgets(false);
+}
+
+// Collects the leading lines getFirstLine() and getSecondLine() read from:
+// up to the first line with text that isn't the very first line.
+void NoteEditorLogic::updateLeadingText()
+{
+    QStringList lines;
+    auto block = m_textEdit->document()->begin();
+    for (; block.isValid(); block = block.next()) {
+        lines.append(block.text());
+        if (block.blockNumber() > 0 && isTextLine(block.text())) {
+            break;
+        }
+    }
+    m_leadingText = lines.join('\n');
+    m_leadingTextEnd = block.isValid() ? block.position() + block.length() : m_textEdit->document()->characterCount();
+}
+
+void NoteEditorLogic::resetEditTracking()
+{
+    m_hasUnsyncedEdits = false;
+    m_isMovedToListTop = false;
+    m_documentRevision = m_textEdit->document()->revision();
+    updateLeadingText();
+    m_unsavedDeltas.clear();
+    m_unsavedDeltaSize = 0;
+    m_savedLength = m_contentLength = m_textEdit->document()->characterCount() - 1;
+    // the content the note was shown with may not be what the database has
+    m_canSaveDeltas = false;
+}
+
+void NoteEditorLogic::syncContentFromDocument()
+{
+    if (!m_hasUnsyncedEdits || currentEditingNoteId() == INVALID_NODE_ID) {
+        return;
+    }
+    m_currentNotes[0].setContent(m_textEdit->toPlainText());
+    m_hasUnsyncedEdits = false;
+    if (auto *entry = m_documentCache.find(m_currentNotes[0].id())) {
+        entry->content = m_currentNotes[0].content();
+    }
+    emit updateNoteDataInList(m_currentNotes[0]);
+}
+
+// Keeps the edit for the next saveNoteToDB(). When a delta can't describe
+// it, or the deltas would be about as big as the content, the next save
+// sends the whole content instead.
+void NoteEditorLogic::recordContentDelta(int position, int charsRemoved, int charsAdded)
+{
+    auto *document = m_textEdit->document();
+    auto const length = document->characterCount() - 1;
+    // the ranges may include text whose format changed with the edit, and
+    // replacing all text counts the final block separator too
+    if (!m_canSaveDeltas || position + charsRemoved > m_contentLength || position + charsAdded > length
+        || m_contentLength - charsRemoved + charsAdded != length || m_unsavedDeltaSize + charsAdded > length / 2) {
+        m_canSaveDeltas = false;
+        m_unsavedDeltas.clear();
+        m_unsavedDeltaSize = 0;
+        m_contentLength = length;
+        return;
+    }
+    auto const inserted = plainTextAt(document, position, charsAdded);
+    if (charsRemoved == 0 && !m_unsavedDeltas.isEmpty() && m_unsavedDeltas.last().position + m_unsavedDeltas.last().inserted.size() == position) {
+        // typing on at the end of the previous insertion
+        m_unsavedDeltas.last().inserted += inserted;
     } else {
-        qDebug() << "NoteEditorLogic::onTextEditTextChanged() : m_currentNote is not valid";
+        m_unsavedDeltas.append(ContentDelta{ position, charsRemoved, inserted });
+    }
+    m_unsavedDeltaSize += inserted.size();
+    m_contentLength = length;
+}
+
+// The database refused deltas of the note, so it gets its full content.
+void NoteEditorLogic::onNoteContentOutOfSync(const NodeData &note)
+{
+    if (currentEditingNoteId() == note.id()) {
+        m_canSaveDeltas = false;
+        scheduleAutoSave();
+        return;
+    }
+    // the note was left meanwhile, its document still has the text
+    auto *entry = m_documentCache.find(note.id());
+    if (entry == nullptr) {
+        qDebug() << "NoteEditorLogic::onNoteContentOutOfSync() : no content left for note" << note.id();
+        return;
     }
+    auto fullNote = note;
+    fullNote.setContent(entry->document->toPlainText());
+    emit requestCreateUpdateNote(fullNote);
 }
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
@@ -689,26 +1261,138 @@ int NoteEditorLogic::currentEditingNoteId() const
     return INVALID_NODE_ID;
 }
 
+// Saves the edits as deltas when possible; the content of m_currentNotes is
+// then left as it was until it's needed. Also flushes the pending autosave
+// when the note is left, the editor loses focus or the app quits.
 void NoteEditorLogic::saveNoteToDB()
 {
-    if (currentEditingNoteId() != INVALID_NODE_ID && m_isContentModified && !m_currentNotes[0].isTempNote()) {
-        emit requestCreateUpdateNote(m_currentNotes[0]);
+    m_autoSaveTimer.stop();
+    m_autoSaveDeadlineTimer.stop();
+    m_metadataSaveTimer.stop();
+    if (currentEditingNoteId() == INVALID_NODE_ID || m_currentNotes[0].isTempNote()) {
+        return;
+    }
+    if (m_isContentModified) {
+        if (m_canSaveDeltas) {
+            emit requestSaveNoteDeltas(m_currentNotes[0], m_unsavedDeltas, m_savedLength);
+            for (const auto &delta : std::as_const(m_unsavedDeltas)) {
+                m_saveStats.bytes += delta.inserted.size() * 2;
+            }
+        } else {
+            syncContentFromDocument();
+            emit requestCreateUpdateNote(m_currentNotes[0]);
+            m_contentLength = m_textEdit->document()->characterCount() - 1;
+            m_canSaveDeltas = true;
+            m_saveStats.bytes += m_currentNotes[0].content().size() * 2;
+        }
+        m_isOutlineModified = true;
+        m_isMovedToListTop = false;
+        ++m_saveStats.contentSaves;
+        m_unsavedDeltas.clear();
+        m_unsavedDeltaSize = 0;
+        m_savedLength = m_contentLength;
+        // the scrollbar position was saved along
         m_isContentModified = false;
+        m_isMetadataModified = false;
+        // a long session in one note would otherwise grow its history forever
+        m_documentCache.trimOpenUndo(m_currentNotes[0].id());
+    } else if (m_isMetadataModified) {
+        emit requestUpdateNoteScrollBarPosition(m_currentNotes[0].id(), m_currentNotes[0].scrollBarPosition());
+        ++m_saveStats.metadataSaves;
+        m_isMetadataModified = false;
+    }
+}
+
+// Whether the editor shows the document of the note being edited, rather
+// than the placeholder of a big note being opened
+bool NoteEditorLogic::isNoteDocumentShown() const
+{
+    return currentEditingNoteId() != INVALID_NODE_ID && m_textEdit->document() != m_scratchDocument;
+}
+
+QVector<NoteHeading> NoteEditorLogic::currentOutline() const
+{
+    if (!isNoteDocumentShown()) {
+        return {};
+    }
+    return m_textEdit->outline();
+}
+
+// Puts the cursor at the start of the block and scrolls it to the top. A
+// note still being opened jumps once its document is shown.
+void NoteEditorLogic::jumpToBlock(int blockNumber)
+{
+    if (currentEditingNoteId() == INVALID_NODE_ID) {
+        return;
+    }
+    if (!isNoteDocumentShown()) {
+        m_pendingJumpNoteId = currentEditingNoteId();
+        m_pendingJumpBlock = blockNumber;
+        return;
+    }
+    auto *document = m_textEdit->document();
+    auto const block = document->findBlockByNumber(blockNumber);
+    if (!block.isValid()) {
+        return;
+    }
+    m_textEdit->setTextCursor(QTextCursor(block));
+    auto const top = document->documentLayout()->blockBoundingRect(block).top();
+    m_textEdit->verticalScrollBar()->setValue(static_cast<int>(top));
+    m_textEdit->ensureCursorVisible();
+    m_textEdit->setFocus();
+}
+
+void NoteEditorLogic::scheduleAutoSave()
+{
+    m_isContentModified = true;
+    m_autoSaveTimer.start();
+    if (!m_autoSaveDeadlineTimer.isActive()) {
+        m_autoSaveDeadlineTimer.start();
+    }
+}
+
+// The outline is stored once the note is left, for the modification date
+// of its last save. Until then it comes from the editor, and
+// DBManager::getNoteOutline() rebuilds an outdated one from the content.
+void NoteEditorLogic::saveNoteOutline()
+{
+    if (m_isOutlineModified && currentEditingNoteId() != INVALID_NODE_ID) {
+        emit requestUpdateNoteOutline(m_currentNotes[0], m_textEdit->outline());
+    }
+    m_isOutlineModified = false;
+}
+
+// Autosave metrics of the note being left, see autoSaveInfo()
+void NoteEditorLogic::collectSaveStats()
+{
+    if (m_saveStats.contentSaves + m_saveStats.metadataSaves > 0 && m_saveStats.shownTimer.isValid()) {
+        ++m_saveTotals.notes;
+        m_saveTotals.contentSaves += m_saveStats.contentSaves;
+        m_saveTotals.metadataSaves += m_saveStats.metadataSaves;
+        m_saveTotals.bytes += m_saveStats.bytes;
+        m_saveTotals.shownTime += m_saveStats.shownTimer.elapsed();
     }
+    m_saveStats = SaveStats();
 }
 
 void NoteEditorLogic::closeEditor()
 {
     if (currentEditingNoteId() != INVALID_NODE_ID) {
+        syncContentFromDocument();
         saveNoteToDB();
+        saveNoteOutline();
+        collectSaveStats();
         emit noteEditClosed(m_currentNotes[0], false);
+        rememberCursorPosition();
     }
     m_currentNotes.clear();
 
     m_textEdit->blockSignals(true);
+    setEditorDocument(m_scratchDocument, m_scratchHighlighter);
     m_textEdit->clear();
     m_textEdit->clearFocus();
     m_textEdit->blockSignals(false);
+    resetEditTracking();
     m_tagListModel->setModelData({});
 }
 
@@ -724,17 +1408,26 @@ void NoteEditorLogic::deleteCurrentNote()
 {
     if (isTempNote()) {
         auto noteNeedDeleted = m_currentNotes[0];
+        m_isOutlineModified = false;
+        collectSaveStats();
         m_currentNotes.clear();
         m_textEdit->blockSignals(true);
+        setEditorDocument(m_scratchDocument, m_scratchHighlighter);
+        m_documentCache.remove(noteNeedDeleted.id());
         m_textEdit->clear();
         m_textEdit->clearFocus();
         m_textEdit->blockSignals(false);
         emit noteEditClosed(noteNeedDeleted, true);
     } else if (currentEditingNoteId() != INVALID_NODE_ID) {
+        syncContentFromDocument();
         auto noteNeedDeleted = m_currentNotes[0];
         saveNoteToDB();
+        m_isOutlineModified = false;
+        collectSaveStats();
         m_currentNotes.clear();
         m_textEdit->blockSignals(true);
+        setEditorDocument(m_scratchDocument, m_scratchHighlighter);
+        m_documentCache.remove(noteNeedDeleted.id());
         m_textEdit->clear();
         m_textEdit->clearFocus();
         m_textEdit->blockSignals(false);
@@ -798,8 +1491,16 @@ QString NoteEditorLogic::getSecondLine(const QString &str)
 
 void NoteEditorLogic::setTheme(Theme::Value theme, QColor textColor, qreal fontSize)
 {
+    m_theme = theme;
+    m_editorTextColor = textColor;
+    m_editorFontSize = fontSize;
     m_tagListDelegate->setTheme(theme);
     m_highlighter->setTheme(theme, textColor, fontSize);
+    if (m_scratchHighlighter != m_highlighter) {
+        m_scratchHighlighter->setTheme(theme, textColor, fontSize);
+    }
+    // the other cached documents still have the old theme's formats
+    m_documentCache.clear(currentEditingNoteId());
     switch (theme) {
     case Theme::Light: {
         m_spacerColor = QColor(191, 191, 191);
@@ -815,9 +1516,20 @@ void NoteEditorLogic::setTheme(Theme::Value theme, QColor textColor, qreal fontS
     }
     }
     if (currentEditingNoteId() != INVALID_NODE_ID) {
-        int verticalScrollBarValueToRestore = m_textEdit->verticalScrollBar()->value();
-        m_textEdit->setText(m_textEdit->toPlainText()); // TODO: Update the text color without setting the text
-        m_textEdit->verticalScrollBar()->setValue(verticalScrollBarValueToRestore);
+        // a large note has no highlighting formats to redo
+        if (!m_isLargeNoteMode) {
+            int verticalScrollBarValueToRestore = m_textEdit->verticalScrollBar()->value();
+            // same text, so any unsaved edits stay tracked
+            auto *document = m_textEdit->document();
+            m_textEdit->blockSignals(true);
+            setDocumentContent(document, document->toPlainText(), m_isLargeNoteMode); // TODO: Update the text color without setting the text
+            m_textEdit->blockSignals(false);
+            // setting the content cleared the undo history
+            if (auto *entry = m_documentCache.find(currentEditingNoteId())) {
+                entry->undoBytes = 0;
+            }
+            m_textEdit->verticalScrollBar()->setValue(verticalScrollBarValueToRestore);
+        }
     } else {
         int verticalScrollBarValueToRestore = m_textEdit->verticalScrollBar()->value();
         showNotesInEditor(m_currentNotes);
@@ -3,6 +3,8 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QVariantMap>
 #include <QColor>
 #include <QVector>
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
@@ -15,6 +17,7 @@
 
 #include "nodedata.h"
 #include "editorsettingsoptions.h"
+#include "notedocumentcache.h"
 
 class CustomDocument;
 class CustomMarkdownHighlighter;
@@ -26,6 +29,7 @@ class TagListModel;
 class TagPool;
 class TagListDelegate;
 class QListWidget;
+class QTextDocument;
 class NoteEditorLogic : public QObject
 {
     Q_OBJECT
@@ -41,12 +45,23 @@ public:
 
     bool markdownEnabled() const;
     void setMarkdownEnabled(bool enabled);
+    void setDocumentCacheLimits(int maxCount, qsizetype maxBytes);
+    void setUndoMemoryLimit(qsizetype maxBytes);
+    Q_INVOKABLE QVariantMap undoMemoryInfo() const;
+    Q_INVOKABLE QVariantMap documentPrepareInfo() const;
+    Q_INVOKABLE QVariantMap autoSaveInfo() const;
     static QString getNoteDateEditor(const QString &dateEdited);
     void highlightSearch() const;
     bool isTempNote() const;
     void saveNoteToDB();
+    void saveNoteOutline();
     int currentEditingNoteId() const;
     void deleteCurrentNote();
+    bool isNoteDocumentShown() const;
+    QVector<NoteHeading> currentOutline() const;
+    void jumpToBlock(int blockNumber);
+    bool isLargeNoteMode() const;
+    void enableFullFeatures();
 
     static QString getNthLine(const QString &str, int targetLineNumber);
     static QString getFirstLine(const QString &str);
@@ -60,8 +75,8 @@ public:
     void setCurrentMinimumEditorPadding(int newCurrentMinimumEditorPadding);
 
 public slots:
-    void showNotesInEditor(const QVector<NodeData> &notes);
-    void onTextEditTextChanged();
+    void showNotesInEditor(const QVector<NodeData> &listNotes);
+    void onDocumentContentsChange(int position, int charsRemoved, int charsAdded);
     void closeEditor();
     void onNoteTagListChanged(int noteId, const QSet<int> &tagIds);
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
@@ -79,11 +94,15 @@ public slots:
 #endif
 signals:
     void requestCreateUpdateNote(const NodeData &note);
+    void requestSaveNoteDeltas(const NodeData &note, const QVector<ContentDelta> &deltas, int baseLength);
+    void requestUpdateNoteScrollBarPosition(int noteId, int scrollBarPosition);
+    void requestUpdateNoteOutline(const NodeData &note, const QVector<NoteHeading> &outline);
     void noteEditClosed(const NodeData &note, bool selectNext);
     void setVisibilityOfFrameRightWidgets(bool);
     void setVisibilityOfFrameRightNonEditor(bool);
     void moveNoteToListViewTop(const NodeData &note);
     void updateNoteDataInList(const NodeData &note);
+    void largeNoteModeChanged(bool isLargeNoteMode);
     void deleteNoteRequested(const NodeData &note);
     void showKanbanView();
     void hideKanbanView();
@@ -106,10 +125,46 @@ private:
     void removeTextBetweenLines(int startLinePosition, int endLinePosition);
     void appendNewColumn(QJsonArray &data, QJsonObject &currentColumn, QString &currentTitle, QJsonArray &tasks);
     void addUntitledColumnToTextEditor(int startLinePosition);
+    void updateLeadingText();
+    void resetEditTracking();
+    void syncContentFromDocument();
+    void recordContentDelta(int position, int charsRemoved, int charsAdded);
+    void scheduleAutoSave();
+    void collectSaveStats();
+    void onNoteContentOutOfSync(const NodeData &note);
+    void updateHighlightingPriority();
+    struct PreparedDocument
+    {
+        QTextDocument *document = nullptr;
+        qint64 prepareTime = 0; // ms
+        bool isLargeNote = false;
+    };
+
+    void finishShowingNote();
+    bool showNoteDocument(const NodeData &note);
+    bool opensAsLargeNote(const NodeData &note) const;
+    void setLargeNoteMode(bool isLargeNoteMode);
+    CustomMarkdownHighlighter *createHighlighter(QTextDocument *document) const;
+    void attachHighlighter();
+    void loadNoteContent(const NodeData &note);
+    void prepareDocument(const NodeData &note);
+    void onDocumentPrepared(const NodeData &note, const PreparedDocument &prepared);
+    void showPlaceholder();
+    void setEditorDocument(QTextDocument *document, CustomMarkdownHighlighter *highlighter);
+    void matchEditorDocumentSettings(QTextDocument *document) const;
+    void rememberCursorPosition();
 
 private:
     CustomDocument *m_textEdit;
+    QTextDocument *m_scratchDocument;
+    // highlighter of the document in the editor
     CustomMarkdownHighlighter *m_highlighter;
+    CustomMarkdownHighlighter *m_scratchHighlighter;
+    NoteDocumentCache m_documentCache;
+    bool m_markdownEnabled;
+    Theme::Value m_theme;
+    QColor m_editorTextColor;
+    qreal m_editorFontSize;
     QLabel *m_editorDateLabel;
     QLineEdit *m_searchEdit;
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
@@ -119,7 +174,63 @@ private:
     DBManager *m_dbManager;
     QVector<NodeData> m_currentNotes;
     bool m_isContentModified;
+    int m_documentRevision;
+    // edits since the content was last taken from the document
+    bool m_hasUnsyncedEdits;
+    // the note was moved to the top of the list since it was last saved
+    bool m_isMovedToListTop;
+    // the first lines of the document, where the title and preview come from
+    QString m_leadingText;
+    int m_leadingTextEnd;
+    // edits since the last save, saved as deltas once the note was saved in
+    // full after being shown
+    QVector<ContentDelta> m_unsavedDeltas;
+    qsizetype m_unsavedDeltaSize;
+    int m_savedLength;
+    int m_contentLength;
+    bool m_canSaveDeltas;
+    // content is saved once edits pause, or after a while of steady typing;
+    // metadata only (the scrollbar position) is saved lazily
+    bool m_isMetadataModified;
+    // content was saved since the outline was, see saveNoteOutline()
+    bool m_isOutlineModified;
     QTimer m_autoSaveTimer;
+    QTimer m_autoSaveDeadlineTimer;
+    QTimer m_metadataSaveTimer;
+    // saves of the note shown, added to the totals when it's left
+    struct SaveStats
+    {
+        int contentSaves = 0;
+        int metadataSaves = 0;
+        qint64 bytes = 0;
+        QElapsedTimer shownTimer;
+    };
+    SaveStats m_saveStats;
+    struct SaveTotals
+    {
+        int notes = 0;
+        int contentSaves = 0;
+        int metadataSaves = 0;
+        qint64 bytes = 0;
+        qint64 shownTime = 0;
+    };
+    SaveTotals m_saveTotals;
+    // totals over the documents built by prepareDocument(), in ms
+    struct PrepareStats
+    {
+        int documents = 0;
+        qint64 prepareTime = 0;
+        qint64 attachTime = 0;
+        qint64 maxAttachTime = 0;
+    };
+    PrepareStats m_prepareStats;
+    // a jump to a heading of a note still being opened
+    int m_pendingJumpNoteId;
+    int m_pendingJumpBlock;
+    // the note shown is large, without highlighting and undo; notes the user
+    // turned them back on for stay that way for the session
+    bool m_isLargeNoteMode;
+    QSet<int> m_fullFeatureNoteIds;
     TagListDelegate *m_tagListDelegate;
     TagListModel *m_tagListModel;
     QColor m_spacerColor;
@@ -12,6 +12,30 @@
 #include "fontloader.h"
 #include "utils.h"
 
+namespace {
+// Upper bound of the row pixmap cache, in KiB
+auto constexpr ROW_CACHE_MAX_COST = 16 * 1024;
+
+enum class RowCacheState : quint32 {
+    Selected = 1 << 0,
+    SelectedInView = 1 << 1,
+    Hovered = 1 << 2,
+    Separator = 1 << 3,
+    Pinned = 1 << 4,
+    FirstPinned = 1 << 5,
+    FirstUnpinned = 1 << 6,
+    HasPinned = 1 << 7,
+    PinnedCollapsed = 1 << 8,
+    FirstRow = 1 << 9,
+    LastRow = 1 << 10,
+    InAllNotes = 1 << 11,
+    ListActive = 1 << 12,
+    ApplicationActive = 1 << 13,
+    ApplicationInactive = 1 << 14,
+    Editor = 1 << 15
+};
+} // namespace
+
 NoteListDelegate::NoteListDelegate(NoteListView *view, TagPool *tagPool, QObject *parent)
     : QStyledItemDelegate(parent),
       m_view{ view },
@@ -50,7 +74,8 @@ NoteListDelegate::NoteListDelegate(NoteListView *view, TagPool *tagPool, QObject
       m_state(NoteListState::Normal),
       m_isActive(false),
       m_isInAllNotes(false),
-      m_theme(Theme::Light)
+      m_theme(Theme::Light),
+      m_rowCache(ROW_CACHE_MAX_COST)
 {
     m_timeLine = new QTimeLine(300, this);
     m_timeLine->setFrameRange(0, m_maxFrame);
@@ -128,6 +153,11 @@ void NoteListDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opti
         }
     }
 
+    if (!m_animatedIndexes.contains(index) && !m_view->isDragging() && !option.rect.isEmpty()) {
+        paintCachedRow(painter, option, index);
+        return;
+    }
+
     painter->setRenderHint(QPainter::Antialiasing);
     QStyleOptionViewItem opt = option;
     opt.rect.setWidth(option.rect.width() - m_rowRightOffset);
@@ -291,6 +321,86 @@ QTimeLine::State NoteListDelegate::animationState()
     return m_timeLine->state();
 }
 
+NoteListDelegate::RowCacheKey NoteListDelegate::rowCacheKey(const QStyleOptionViewItem &option, const QModelIndex &index, bool isHovered,
+                                                            bool isActive, bool isEditor, qreal devicePixelRatio) const
+{
+    auto const *model = static_cast<NoteListModel *>(m_view->model());
+    const auto &note = model->getNote(index);
+
+    quint32 stateFlags = 0;
+    auto setFlag = [&stateFlags](RowCacheState flag, bool on) {
+        if (on) {
+            stateFlags |= static_cast<quint32>(flag);
+        }
+    };
+    setFlag(RowCacheState::Selected, (option.state & QStyle::State_Selected) == QStyle::State_Selected);
+    setFlag(RowCacheState::SelectedInView, m_view->selectionModel()->isSelected(index));
+    setFlag(RowCacheState::Hovered, isHovered);
+    setFlag(RowCacheState::Separator, shouldPaintSeparator(index, *model));
+    setFlag(RowCacheState::Pinned, note.isPinnedNote());
+    setFlag(RowCacheState::FirstPinned, model->isFirstPinnedNote(index));
+    setFlag(RowCacheState::FirstUnpinned, model->isFirstUnpinnedNote(index));
+    setFlag(RowCacheState::HasPinned, model->hasPinnedNote());
+    setFlag(RowCacheState::PinnedCollapsed, m_view->isPinnedNotesCollapsed());
+    setFlag(RowCacheState::FirstRow, index.row() == 0);
+    setFlag(RowCacheState::LastRow, index.row() == model->rowCount() - 1);
+    setFlag(RowCacheState::InAllNotes, m_isInAllNotes);
+    setFlag(RowCacheState::ListActive, isActive);
+    setFlag(RowCacheState::ApplicationActive, qApp->applicationState() == Qt::ApplicationActive);
+    setFlag(RowCacheState::ApplicationInactive, qApp->applicationState() == Qt::ApplicationInactive);
+    setFlag(RowCacheState::Editor, isEditor);
+
+    return RowCacheKey{ note.id(),
+                        note.lastModificationMSecs(),
+                        utils::parseDateTime(note.lastModificationdateTime()),
+                        qHash(note.tagIds()),
+                        option.rect.width(),
+                        option.rect.height(),
+                        m_rowRightOffset,
+                        m_theme,
+                        stateFlags,
+                        devicePixelRatio };
+}
+
+const QPixmap *NoteListDelegate::cachedRow(const RowCacheKey &key) const
+{
+    return m_rowCache.object(key);
+}
+
+void NoteListDelegate::cacheRow(const RowCacheKey &key, const QPixmap &pixmap) const
+{
+    int cost = qMax(1, static_cast<int>(qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8 / 1024));
+    m_rowCache.insert(key, new QPixmap(pixmap), cost);
+}
+
+void NoteListDelegate::paintCachedRow(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const qreal devicePixelRatio = painter->device()->devicePixelRatioF();
+    const auto key =
+            rowCacheKey(option, index, (option.state & QStyle::State_MouseOver) == QStyle::State_MouseOver, m_isActive, false, devicePixelRatio);
+
+    if (auto const *cached = cachedRow(key)) {
+        painter->drawPixmap(option.rect.topLeft(), *cached);
+        return;
+    }
+
+    QPixmap pixmap{ option.rect.size() * devicePixelRatio };
+    pixmap.setDevicePixelRatio(devicePixelRatio);
+    pixmap.fill(Qt::transparent);
+    {
+        QPainter rowPainter{ &pixmap };
+        rowPainter.setRenderHint(QPainter::Antialiasing);
+        QStyleOptionViewItem rowOption = option;
+        rowOption.rect.moveTo(0, 0);
+        QStyleOptionViewItem backgroundOption = rowOption;
+        backgroundOption.rect.setWidth(option.rect.width() - m_rowRightOffset);
+        paintBackground(&rowPainter, backgroundOption, index);
+        paintLabels(&rowPainter, rowOption, index);
+    }
+    painter->drawPixmap(option.rect.topLeft(), pixmap);
+    cacheRow(key, pixmap);
+}
+
 void NoteListDelegate::paintBackground(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
     auto bufferSize = bufferSizeHint(option, index);
@@ -848,6 +958,24 @@ void NoteListDelegate::clearSizeMap()
     m_sizeMap.clear();
 }
 
+void NoteListDelegate::invalidateRowCache(const QSet<int> &noteIds)
+{
+    if (noteIds.isEmpty()) {
+        return;
+    }
+    const auto keys = m_rowCache.keys();
+    for (const auto &key : keys) {
+        if (noteIds.contains(key.noteId)) {
+            m_rowCache.remove(key);
+        }
+    }
+}
+
+void NoteListDelegate::clearRowCache()
+{
+    m_rowCache.clear();
+}
+
 void NoteListDelegate::updateSizeMap(int id, QSize sz, const QModelIndex &index)
 {
     m_sizeMap[id] = sz;
@@ -943,5 +1071,6 @@ void NoteListDelegate::setTheme(Theme::Value theme)
         break;
     }
     }
+    clearRowCache();
     emit themeChanged(m_theme);
 }
@@ -5,6 +5,8 @@
 #include <QStyledItemDelegate>
 #include <QTimeLine>
 #include <QQueue>
+#include <QCache>
+#include <QPixmap>
 #include "editorsettingsoptions.h"
 
 class TagPool;
@@ -37,6 +39,8 @@ public:
     void setIsInAllNotes(bool newIsInAllNotes);
     bool isInAllNotes() const;
     void clearSizeMap();
+    void invalidateRowCache(const QSet<int> &noteIds);
+    void clearRowCache();
 
 public slots:
     void updateSizeMap(int id, QSize sz, const QModelIndex &index);
@@ -48,11 +52,47 @@ public:
     const QModelIndex &hoveredIndex() const;
     bool shouldPaintSeparator(const QModelIndex &index, const NoteListModel &model) const;
 
+    // Everything a cached row pixmap depends on. Note content changes are
+    // covered by the modification time, the rest is invalidated explicitly.
+    // The rendered date is part of the key because relative dates
+    // ("Today", "Yesterday") change without the note being modified.
+    struct RowCacheKey
+    {
+        int noteId;
+        qint64 modificationTime;
+        QString dateText;
+        size_t tagsHash;
+        int width;
+        int height;
+        int rowRightOffset;
+        Theme::Value theme;
+        quint32 stateFlags;
+        qreal devicePixelRatio;
+
+        bool operator==(const RowCacheKey &other) const
+        {
+            return noteId == other.noteId && modificationTime == other.modificationTime && dateText == other.dateText && tagsHash == other.tagsHash
+                    && width == other.width && height == other.height && rowRightOffset == other.rowRightOffset && theme == other.theme
+                    && stateFlags == other.stateFlags && qFuzzyCompare(devicePixelRatio, other.devicePixelRatio);
+        }
+        friend size_t qHash(const RowCacheKey &key, size_t seed = 0)
+        {
+            return qHashMulti(seed, key.noteId, key.modificationTime, key.dateText, key.tagsHash, key.width, key.height, key.rowRightOffset,
+                              static_cast<int>(key.theme), key.stateFlags);
+        }
+    };
+
+    RowCacheKey rowCacheKey(const QStyleOptionViewItem &option, const QModelIndex &index, bool isHovered, bool isActive, bool isEditor,
+                            qreal devicePixelRatio) const;
+    const QPixmap *cachedRow(const RowCacheKey &key) const;
+    void cacheRow(const RowCacheKey &key, const QPixmap &pixmap) const;
+
 signals:
     void themeChanged(Theme::Value theme);
     void animationFinished(NoteListState animationState);
 
 private:
+    void paintCachedRow(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
     void paintBackground(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
     void paintLabels(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
     void paintSeparator(QPainter *painter, QRect rect, const QModelIndex &index) const;
@@ -88,6 +128,7 @@ private:
     QModelIndex m_hoveredIndex;
     QMap<int, QSize> m_sizeMap;
     QQueue<QPair<QSet<int>, NoteListState>> m_animationQueue;
+    mutable QCache<RowCacheKey, QPixmap> m_rowCache;
 };
 
 #endif // NOTELISTDELEGATE_H
@@ -132,6 +132,50 @@ NoteListDelegateEditor::~NoteListDelegateEditor()
     m_view->unsetEditorWidget(m_id, nullptr);
 }
 
+// The tag list is a child widget and is not part of the cached row pixmap,
+// so its background follows the row state on every paint
+void NoteListDelegateEditor::updateTagListBackground(const QModelIndex &index) const
+{
+    if (m_view->selectionModel()->isSelected(index)) {
+        if (qApp->applicationState() == Qt::ApplicationActive) {
+            m_tagListView->setBackground(m_isActive ? m_activeColor : m_notActiveColor);
+        } else if (qApp->applicationState() == Qt::ApplicationInactive) {
+            m_tagListView->setBackground(m_applicationInactiveColor);
+        }
+    } else if (underMouseC()) {
+        if (!m_view->isDragging()) {
+            m_tagListView->setBackground(m_hoverColor);
+        }
+    } else {
+        m_tagListView->setBackground(m_defaultColor);
+    }
+}
+
+void NoteListDelegateEditor::paintCachedRow(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const qreal devicePixelRatio = devicePixelRatioF();
+    QStyleOptionViewItem keyOption = m_option;
+    keyOption.rect = rect();
+    const auto key = m_delegate->rowCacheKey(keyOption, index, underMouseC(), m_isActive, true, devicePixelRatio);
+
+    if (auto const *cached = m_delegate->cachedRow(key)) {
+        painter->drawPixmap(0, 0, *cached);
+        return;
+    }
+
+    QPixmap pixmap{ rect().size() * devicePixelRatio };
+    pixmap.setDevicePixelRatio(devicePixelRatio);
+    pixmap.fill(Qt::transparent);
+    {
+        QPainter rowPainter{ &pixmap };
+        rowPainter.setRenderHint(QPainter::Antialiasing);
+        paintBackground(&rowPainter, option, index);
+        paintLabels(&rowPainter, m_option, index);
+    }
+    painter->drawPixmap(0, 0, pixmap);
+    m_delegate->cacheRow(key, pixmap);
+}
+
 void NoteListDelegateEditor::paintBackground(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
     auto bufferSize = rect().size();
@@ -151,16 +195,9 @@ void NoteListDelegateEditor::paintBackground(QPainter *painter, const QStyleOpti
     auto isPinned = index.data(NoteListModel::NoteIsPinned).toBool();
     if (m_view->selectionModel()->isSelected(index)) {
         if (qApp->applicationState() == Qt::ApplicationActive) {
-            if (m_isActive) {
-                bufferPainter.fillRect(bufferRect, QBrush(m_activeColor));
-                m_tagListView->setBackground(m_activeColor);
-            } else {
-                bufferPainter.fillRect(bufferRect, QBrush(m_notActiveColor));
-                m_tagListView->setBackground(m_notActiveColor);
-            }
+            bufferPainter.fillRect(bufferRect, QBrush(m_isActive ? m_activeColor : m_notActiveColor));
         } else if (qApp->applicationState() == Qt::ApplicationInactive) {
             bufferPainter.fillRect(bufferRect, QBrush(m_applicationInactiveColor));
-            m_tagListView->setBackground(m_applicationInactiveColor);
         }
     } else if (underMouseC()) {
         if (m_view->isDragging()) {
@@ -171,11 +208,9 @@ void NoteListDelegateEditor::paintBackground(QPainter *painter, const QStyleOpti
             }
         } else {
             bufferPainter.fillRect(bufferRect, QBrush(m_hoverColor));
-            m_tagListView->setBackground(m_hoverColor);
         }
     } else {
         bufferPainter.fillRect(bufferRect, QBrush(m_defaultColor));
-        m_tagListView->setBackground(m_defaultColor);
     }
     if (m_view->isDragging() && !isPinned && !m_view->isDraggingInsidePinned()) {
         if ((noteListModel != nullptr) && noteListModel->isFirstUnpinnedNote(index) && (index.row() == (noteListModel->rowCount() - 1))) {
@@ -382,6 +417,7 @@ QPixmap NoteListDelegateEditor::renderToPixmap()
     QStyleOptionViewItem opt = m_option;
     opt.rect.setWidth(m_option.rect.width() - m_rowRightOffset);
     auto const idx = static_cast<NoteListModel *>(m_view->model())->getNoteIndex(m_id);
+    updateTagListBackground(idx);
     paintBackground(&painter, opt, idx);
     paintLabels(&painter, m_option, idx);
     return result;
@@ -394,8 +430,13 @@ void NoteListDelegateEditor::paintEvent(QPaintEvent *event)
     QStyleOptionViewItem opt = m_option;
     opt.rect.setWidth(m_option.rect.width() - m_rowRightOffset);
     auto const idx = static_cast<NoteListModel *>(m_view->model())->getNoteIndex(m_id);
-    paintBackground(&painter, opt, idx);
-    paintLabels(&painter, m_option, idx);
+    updateTagListBackground(idx);
+    if (m_view->isDragging() || rect().isEmpty()) {
+        paintBackground(&painter, opt, idx);
+        paintLabels(&painter, m_option, idx);
+    } else {
+        paintCachedRow(&painter, opt, idx);
+    }
     QWidget::paintEvent(event);
 }
 
@@ -47,6 +47,8 @@ signals:
     void nearDestroyed(int id, const QModelIndex &index);
 
 private:
+    void paintCachedRow(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
+    void updateTagListBackground(const QModelIndex &index) const;
     void paintBackground(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
     void paintLabels(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
     void paintSeparator(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
@@ -82,26 +82,161 @@ QModelIndex NoteListModel::getNoteIndex(int id) const
 
 void NoteListModel::setListNote(const QVector<NodeData> &notes, const ListViewInfo &inf)
 {
-    beginResetModel();
-    m_pinnedList.clear();
-    m_noteList.clear();
     m_listViewInfo = inf;
+    QVector<NodeData> pinnedList;
+    QVector<NodeData> noteList;
     if ((!m_listViewInfo.isInTag) && (m_listViewInfo.parentFolderId != TRASH_FOLDER_ID)) {
         for (const auto &note : std::as_const(notes)) {
             if (note.isPinnedNote()) {
-                m_pinnedList.append(note);
+                pinnedList.append(note);
             } else {
-                m_noteList.append(note);
+                noteList.append(note);
             }
         }
     } else {
-        m_noteList = notes;
+        noteList = notes;
+    }
+
+    // Only reset the whole model when patching it row by row would touch
+    // more rows than the new list has
+    const int maxOps = pinnedList.size() + noteList.size();
+    QVector<ListDiffOp> pinnedOps;
+    QVector<ListDiffOp> noteOps;
+    int pinnedOpCount = diffNoteList(m_pinnedList, pinnedList, maxOps, pinnedOps);
+    int noteOpCount = -1;
+    if (pinnedOpCount != -1) {
+        noteOpCount = diffNoteList(m_noteList, noteList, maxOps - pinnedOpCount, noteOps);
+    }
+    if (pinnedOpCount == -1 || noteOpCount == -1) {
+        beginResetModel();
+        m_pinnedList = pinnedList;
+        m_noteList = noteList;
+        endResetModel();
+    } else {
+        applyListDiff(m_pinnedList, pinnedList, 0, pinnedOps);
+        applyListDiff(m_noteList, noteList, m_pinnedList.size(), noteOps);
     }
-    sort(0, Qt::AscendingOrder);
-    endResetModel();
     emit rowCountChanged();
 }
 
+/*!
+ * \brief NoteListModel::diffNoteList
+ * Compute the row operations turning \a current into \a target, matching
+ * rows by note id. Removals come first (back to front), then target rows
+ * are placed in order by inserting new notes or moving existing ones.
+ * \return number of touched rows, or -1 if it would exceed \a maxOps
+ */
+int NoteListModel::diffNoteList(const QVector<NodeData> &current, const QVector<NodeData> &target, int maxOps, QVector<ListDiffOp> &ops)
+{
+    QHash<int, int> targetPos;
+    targetPos.reserve(target.size());
+    for (int i = 0; i < target.size(); ++i) {
+        targetPos.insert(target[i].id(), i);
+    }
+
+    int opCount = 0;
+    QVector<int> ids;
+    ids.reserve(current.size());
+    for (int i = current.size() - 1; i >= 0; --i) {
+        if (targetPos.contains(current[i].id())) {
+            continue;
+        }
+        if (++opCount > maxOps) {
+            return -1;
+        }
+        if (!ops.isEmpty() && ops.last().type == ListDiffOp::Remove && ops.last().first == i + 1) {
+            ops.last().first = i;
+        } else {
+            ops.append({ ListDiffOp::Remove, i, i, 0 });
+        }
+    }
+    for (const auto &note : current) {
+        if (targetPos.contains(note.id())) {
+            ids.append(note.id());
+        }
+    }
+    QSet<int> currentIds(ids.cbegin(), ids.cend());
+
+    for (int i = 0; i < target.size(); ++i) {
+        const int id = target[i].id();
+        if (i < ids.size() && ids[i] == id) {
+            continue;
+        }
+        if (++opCount > maxOps) {
+            return -1;
+        }
+        if (!currentIds.contains(id)) {
+            if (!ops.isEmpty() && ops.last().type == ListDiffOp::Insert && ops.last().last == i - 1) {
+                ops.last().last = i;
+            } else {
+                ops.append({ ListDiffOp::Insert, i, i, 0 });
+            }
+            ids.insert(i, id);
+            continue;
+        }
+        int from = ids.indexOf(id, i);
+        int to = i;
+        if (from == i + 1) {
+            // a single row is in the way (e.g. a note that got older),
+            // move that one down instead of every row after it
+            from = i;
+            to = qMin(targetPos.value(ids[i]), ids.size() - 1);
+        }
+        ops.append({ ListDiffOp::Move, from, from, to });
+        ids.move(from, to);
+    }
+    return opCount;
+}
+
+void NoteListModel::applyListDiff(QVector<NodeData> &list, const QVector<NodeData> &target, int rowOffset, const QVector<ListDiffOp> &ops)
+{
+    for (const auto &op : ops) {
+        switch (op.type) {
+        case ListDiffOp::Remove:
+            beginRemoveRows(QModelIndex(), rowOffset + op.first, rowOffset + op.last);
+            list.remove(op.first, op.last - op.first + 1);
+            endRemoveRows();
+            break;
+        case ListDiffOp::Insert:
+            beginInsertRows(QModelIndex(), rowOffset + op.first, rowOffset + op.last);
+            for (int i = op.first; i <= op.last; ++i) {
+                list.insert(i, target[i]);
+            }
+            endInsertRows();
+            break;
+        case ListDiffOp::Move: {
+            const int destination = op.to > op.first ? op.to + 1 : op.to;
+            if (beginMoveRows(QModelIndex(), rowOffset + op.first, rowOffset + op.first, QModelIndex(), rowOffset + destination)) {
+                list.move(op.first, op.to);
+                endMoveRows();
+            }
+            break;
+        }
+        }
+    }
+
+    // rows are in target order now, refresh the ones whose data changed
+    auto isRowChanged = [](const NodeData &lhs, const NodeData &rhs) {
+        return lhs.lastModificationMSecs() != rhs.lastModificationMSecs() || lhs.fullTitle() != rhs.fullTitle()
+                || lhs.tagIds() != rhs.tagIds() || lhs.parentName() != rhs.parentName() || lhs.isPinnedNote() != rhs.isPinnedNote()
+                || lhs.deletionDateTime() != rhs.deletionDateTime();
+    };
+    int changedFirst = -1;
+    for (int i = 0; i < target.size(); ++i) {
+        const bool changed = isRowChanged(list[i], target[i]);
+        list[i] = target[i];
+        if (changed && changedFirst == -1) {
+            changedFirst = i;
+        } else if (!changed && changedFirst != -1) {
+            emit dataChanged(index(rowOffset + changedFirst), index(rowOffset + i - 1));
+            changedFirst = -1;
+        }
+    }
+    if (changedFirst != -1) {
+        emit dataChanged(index(rowOffset + changedFirst), index(rowOffset + target.size() - 1));
+    }
+}
+
 void NoteListModel::removeNotes(const QModelIndexList &noteIndexes)
 {
     emit requestRemoveNotes(noteIndexes);
@@ -187,6 +322,8 @@ QVariant NoteListModel::data(const QModelIndex &index, int role) const
         return note.tagListScrollBarPos();
     case NoteIsPinned:
         return note.isPinnedNote();
+    case NoteIsContentPrefix:
+        return note.isContentPrefix();
     }
 
     return {};
@@ -221,6 +358,8 @@ bool NoteListModel::setData(const QModelIndex &index, const QVariant &value, int
         note.setParentName(value.toString());
     } else if (role == NoteTagListScrollbarPos) {
         note.setTagListScrollBarPos(value.toInt());
+    } else if (role == NoteIsContentPrefix) {
+        note.setIsContentPrefix(value.toBool());
     } else {
         return false;
     }
@@ -244,28 +383,6 @@ int NoteListModel::rowCount(const QModelIndex &parent) const
     return m_noteList.size() + m_pinnedList.size();
 }
 
-void NoteListModel::sort(int column, Qt::SortOrder order)
-{
-    Q_UNUSED(column)
-    Q_UNUSED(order)
-    if (m_listViewInfo.parentFolderId == TRASH_FOLDER_ID) {
-        std::stable_sort(m_noteList.begin(), m_noteList.end(),
-                         [](const NodeData &lhs, const NodeData &rhs) { return lhs.deletionDateTime() > rhs.deletionDateTime(); });
-    } else {
-        std::stable_sort(m_pinnedList.begin(), m_pinnedList.end(), [this](const NodeData &lhs, const NodeData &rhs) {
-            if (isInAllNote()) {
-                return lhs.relativePosAN() < rhs.relativePosAN();
-            }
-            return lhs.relativePosition() < rhs.relativePosition();
-        });
-
-        std::stable_sort(m_noteList.begin(), m_noteList.end(),
-                         [](const NodeData &lhs, const NodeData &rhs) { return lhs.lastModificationdateTime() > rhs.lastModificationdateTime(); });
-    }
-
-    emit dataChanged(index(0), index(rowCount() - 1));
-}
-
 void NoteListModel::setNoteData(const QModelIndex &index, const NodeData &note)
 {
     if (!index.isValid()) {
@@ -281,6 +398,62 @@ void NoteListModel::setNoteData(const QModelIndex &index, const NodeData &note)
     emit dataChanged(this->index(index.row()), this->index(index.row()));
 }
 
+void NoteListModel::setNotesParentFolder(const QModelIndexList &indexes, const NodeData &folder)
+{
+    int firstRow = rowCount();
+    int lastRow = -1;
+    for (const auto &index : indexes) {
+        if (!index.isValid()) {
+            continue;
+        }
+        auto &note = getRef(index.row());
+        note.setParentId(folder.id());
+        note.setParentName(folder.fullTitle());
+        note.setAbsolutePath(QStringLiteral("%1%2%3").arg(folder.absolutePath(), PATH_SEPARATOR).arg(note.id()));
+        firstRow = std::min(firstRow, index.row());
+        lastRow = std::max(lastRow, index.row());
+    }
+    if (lastRow >= 0) {
+        emit dataChanged(this->index(firstRow), this->index(lastRow), QVector<int>(1, NoteParentName));
+    }
+}
+
+void NoteListModel::setNotesHaveTag(const QModelIndexList &indexes, int tagId, bool haveTag)
+{
+    int firstRow = rowCount();
+    int lastRow = -1;
+    for (const auto &index : indexes) {
+        if (!index.isValid()) {
+            continue;
+        }
+        auto &note = getRef(index.row());
+        auto tagIds = note.tagIds();
+        if (haveTag) {
+            tagIds.insert(tagId);
+        } else {
+            tagIds.remove(tagId);
+        }
+        note.setTagIds(tagIds);
+        firstRow = std::min(firstRow, index.row());
+        lastRow = std::max(lastRow, index.row());
+    }
+    if (lastRow >= 0) {
+        emit dataChanged(this->index(firstRow), this->index(lastRow), QVector<int>(1, NoteTagsList));
+    }
+}
+
+QModelIndexList NoteListModel::getNoteIndexes(const QList<int> &ids) const
+{
+    QModelIndexList indexes;
+    QSet<int> remaining(ids.cbegin(), ids.cend());
+    for (int row = 0; row < rowCount() && !remaining.isEmpty(); ++row) {
+        if (remaining.remove(getRef(row).id())) {
+            indexes.append(createIndex(row, 0));
+        }
+    }
+    return indexes;
+}
+
 void NoteListModel::updatePinnedRelativePosition()
 {
     for (int i = 0; i < m_pinnedList.size(); ++i) {
@@ -350,16 +523,13 @@ QMimeData *NoteListModel::mimeData(const QModelIndexList &indexes) const
     if (indexes.isEmpty()) {
         return nullptr;
     }
-    QStringList d;
+    QList<int> d;
+    d.reserve(indexes.size());
     for (const auto &index : indexes) {
-        auto id = index.data(NoteListModel::NoteID).toInt();
-        d.append(QString::number(id));
-    }
-    if (d.isEmpty()) {
-        return nullptr;
+        d.append(index.data(NoteListModel::NoteID).toInt());
     }
     auto *mimeData = new QMimeData;
-    mimeData->setData(NOTE_MIME, d.join(PATH_SEPARATOR).toUtf8());
+    mimeData->setData(NOTE_MIME, encodeNoteMimeData(d));
     return mimeData;
 }
 
@@ -380,11 +550,10 @@ bool NoteListModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
         }
     }
     bool toPinned = row < m_pinnedList.size();
-    auto idl = QString::fromUtf8(mime->data(NOTE_MIME)).split(PATH_SEPARATOR);
+    auto idl = decodeNoteMimeData(mime->data(NOTE_MIME));
     QSet<int> movedIds;
     QModelIndexList idxe;
-    for (const auto &idString : std::as_const(idl)) {
-        auto nodeId = idString.toInt();
+    for (const auto &nodeId : std::as_const(idl)) {
         idxe.append(getNoteIndex(nodeId));
     }
     emit rowsAboutToBeMovedC(idxe);
@@ -398,8 +567,7 @@ bool NoteListModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
                 m_pinnedList.prepend(m_noteList.takeAt(index.row() - m_pinnedList.size()));
             }
         }
-        for (const auto &idString : std::as_const(idl)) {
-            auto nodeId = idString.toInt();
+        for (const auto &nodeId : std::as_const(idl)) {
             for (int i = 0; i < m_pinnedList.size(); ++i) {
                 if (m_pinnedList[i].id() == nodeId) {
                     m_pinnedList.move(i, row);
@@ -531,10 +699,10 @@ void NoteListModel::setNotesIsPinned(const QModelIndexList &indexes, bool isPinn
                     }
                 }
             } else {
-                auto lastMod = index.data(NoteLastModificationDateTime).toDateTime();
+                auto lastMod = getRef(index.row()).lastModificationMSecs();
                 for (destinationChild = 0; destinationChild < m_noteList.size(); ++destinationChild) {
                     const auto &note = m_noteList[destinationChild];
-                    if (note.lastModificationdateTime() <= lastMod) {
+                    if (note.lastModificationMSecs() <= lastMod) {
                         break;
                     }
                 }
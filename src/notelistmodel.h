@@ -22,6 +22,7 @@ public:
         NoteParentName,
         NoteTagListScrollbarPos,
         NoteIsPinned,
+        NoteIsContentPrefix,
     };
 
     explicit NoteListModel(QObject *parent = nullptr);
@@ -31,6 +32,7 @@ public:
     QModelIndex insertNote(const NodeData &note, int row);
     const NodeData &getNote(const QModelIndex &index) const;
     QModelIndex getNoteIndex(int id) const;
+    QModelIndexList getNoteIndexes(const QList<int> &ids) const;
     void setListNote(const QVector<NodeData> &notes, const ListViewInfo &inf);
     void removeNotes(const QModelIndexList &noteIndexes);
     bool moveRow(const QModelIndex &sourceParent, int sourceRow, const QModelIndex &destinationParent, int destinationChild);
@@ -40,8 +42,9 @@ public:
     bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
     Qt::ItemFlags flags(const QModelIndex &index) const override;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
-    void sort(int column, Qt::SortOrder order) override;
     void setNoteData(const QModelIndex &index, const NodeData &note);
+    void setNotesParentFolder(const QModelIndexList &indexes, const NodeData &folder);
+    void setNotesHaveTag(const QModelIndexList &indexes, int tagId, bool haveTag);
 
     Qt::DropActions supportedDropActions() const override;
     Qt::DropActions supportedDragActions() const override;
@@ -58,11 +61,21 @@ public:
     void setNotesIsPinned(const QModelIndexList &indexes, bool isPinned);
 
 private:
+    struct ListDiffOp
+    {
+        enum Type : uint8_t { Remove, Insert, Move } type;
+        int first;
+        int last;
+        int to;
+    };
+
     QVector<NodeData> m_noteList;
     QVector<NodeData> m_pinnedList;
     ListViewInfo m_listViewInfo;
     void updatePinnedRelativePosition();
     bool isInAllNote() const;
+    static int diffNoteList(const QVector<NodeData> &current, const QVector<NodeData> &target, int maxOps, QVector<ListDiffOp> &ops);
+    void applyListDiff(QVector<NodeData> &list, const QVector<NodeData> &target, int rowOffset, const QVector<ListDiffOp> &ops);
     NodeData &getRef(int row);
     const NodeData &getRef(int row) const;
 
@@ -15,10 +15,12 @@
 #include <QMimeData>
 #include <QWindow>
 #include <QMetaObject>
+#include <QPointer>
 #include "tagpool.h"
 #include "notelistmodel.h"
 #include "nodepath.h"
 #include "dbmanager.h"
+#include "dbmanagerasync.h"
 #include "notelistview_p.h"
 #include "notelistdelegateeditor.h"
 #include "fontloader.h"
@@ -207,6 +209,49 @@ void NoteListView::closeAllEditor()
     m_openedEditor.clear();
 }
 
+// Keeps editors open for the rows within a viewport height of the visible
+// area only, opening and closing just the ones that entered or left it.
+// Editors of reopenIds are recreated, e.g. after their tags changed.
+void NoteListView::updateEditorsInViewport(const QSet<int> &reopenIds)
+{
+    auto *listModel = static_cast<NoteListModel *>(model());
+    if (listModel == nullptr) {
+        return;
+    }
+    auto range = abs(viewport()->height());
+    QSet<int> idsInRange;
+    for (int i = 0; i < listModel->rowCount(); ++i) {
+        auto index = listModel->index(i, 0);
+        auto y = visualRect(index).y();
+        if (y < -range) {
+            continue;
+        }
+        if (y > 2 * range) {
+            break;
+        }
+        auto id = index.data(NoteListModel::NoteID).toInt();
+        idsInRange.insert(id);
+        if (reopenIds.contains(id) && m_openedEditor.contains(id)) {
+            closePersistentEditorC(index);
+        }
+        if (!m_openedEditor.contains(id)) {
+            openPersistentEditorC(index);
+        }
+    }
+    for (auto it = m_openedEditor.begin(); it != m_openedEditor.end();) {
+        if (idsInRange.contains(it.key())) {
+            ++it;
+            continue;
+        }
+        // editors of removed rows went away with them
+        auto index = listModel->getNoteIndex(it.key());
+        if (index.isValid()) {
+            closePersistentEditor(index);
+        }
+        it = m_openedEditor.erase(it);
+    }
+}
+
 void NoteListView::setDbManager(DBManager *newDbManager)
 {
     m_dbManager = newDbManager;
@@ -413,34 +458,112 @@ void NoteListView::dragMoveEvent(QDragMoveEvent *event)
 void NoteListView::scrollContentsBy(int dx, int dy)
 {
     QListView::scrollContentsBy(dx, dy);
-    auto *listModel = static_cast<NoteListModel *>(model());
-    if (listModel == nullptr) {
-        return;
+    updateEditorsInViewport();
+}
+
+QPixmap NoteListView::renderDragRow(const QModelIndex &index, QRect *rect)
+{
+    Q_D(NoteListView);
+    QPixmap pixmap;
+    auto id = index.data(NoteListModel::NoteID).toInt();
+    if (m_openedEditor.contains(id)) {
+        QItemViewPaintPairs paintPairs = d->draggablePaintPairs({ index }, rect);
+        Q_UNUSED(paintPairs);
+        auto wl = m_openedEditor[id];
+        if (!wl.empty()) {
+            pixmap = wl.first()->grab();
+        } else {
+            qDebug() << __FUNCTION__ << "Dragging row" << index.row() << "is in opened editor list but editor widget is null";
+        }
+    } else {
+        pixmap = d->renderToPixmap({ index }, rect);
     }
-    for (int i = 0; i < listModel->rowCount(); ++i) {
-        auto index = listModel->index(i, 0);
-        if (index.isValid()) {
-            auto id = index.data(NoteListModel::NoteID).toInt();
-            if (m_openedEditor.contains(id)) {
-                auto y = visualRect(index).y();
-                auto range = abs(viewport()->height());
-                if ((y < -range) || (y > 2 * range)) {
-                    m_openedEditor.remove(id);
-                    closePersistentEditor(index);
-                }
-            } else {
-                auto y = visualRect(index).y();
-                auto range = abs(viewport()->height());
-                if (y < -range) {
-                    continue;
-                }
-                if (y > 2 * range) {
-                    break;
-                }
-                openPersistentEditorC(index);
-            }
+    auto const *noteListModel = static_cast<NoteListModel *>(this->model());
+    if (!pixmap.isNull() && (noteListModel != nullptr) && noteListModel->hasPinnedNote()
+        && (noteListModel->isFirstPinnedNote(index) || noteListModel->isFirstUnpinnedNote(index))) {
+        const qreal dpr = pixmap.devicePixelRatio();
+        QRect r(0, qRound(25 * dpr), pixmap.width(), pixmap.height() - qRound(25 * dpr));
+        pixmap = pixmap.copy(r);
+        rect->setHeight(rect->height() - 25);
+    }
+    return pixmap;
+}
+
+// Only the first few selected rows are rendered, so starting a drag costs the
+// same no matter how many notes are selected; the badge shows the real count.
+QPixmap NoteListView::renderDragStack(const QModelIndexList &indexes)
+{
+    constexpr int MAX_PREVIEW_ROWS = 3;
+    constexpr int STACK_OFFSET = 6;
+
+    QModelIndexList previewIndexes = indexes;
+    auto previewCount = std::min<qsizetype>(previewIndexes.size(), MAX_PREVIEW_ROWS);
+    std::partial_sort(previewIndexes.begin(), previewIndexes.begin() + previewCount, previewIndexes.end(),
+                      [](const QModelIndex &a, const QModelIndex &b) { return a.row() < b.row(); });
+    QVector<QPixmap> rows;
+    for (qsizetype i = 0; i < previewCount; ++i) {
+        QRect rowRect;
+        auto row = renderDragRow(previewIndexes[i], &rowRect);
+        if (!row.isNull()) {
+            rows.append(row);
+        }
+    }
+
+    QPixmap stack;
+    if (rows.isEmpty()) {
+        stack.load(":/images/notepad.ico");
+        stack = stack.scaled(stack.width() / 4, stack.height() / 4, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    } else {
+        const qreal dpr = rows.first().devicePixelRatio();
+        QSize stackSize;
+        for (const auto &row : std::as_const(rows)) {
+            stackSize = stackSize.expandedTo(row.size() / row.devicePixelRatio());
+        }
+        stackSize += QSize(STACK_OFFSET, STACK_OFFSET) * (rows.size() - 1);
+        stack = QPixmap(stackSize * dpr);
+        stack.setDevicePixelRatio(dpr);
+        stack.fill(Qt::transparent);
+        QPainter painter(&stack);
+        // paint back to front so the first selected row ends up on top
+        for (auto i = rows.size() - 1; i >= 0; --i) {
+            painter.setOpacity(i == 0 ? 1.0 : 0.6);
+            painter.drawPixmap(QPoint(STACK_OFFSET * i, STACK_OFFSET * i), rows[i]);
         }
     }
+
+#ifdef __APPLE__
+    QFont displayFont(QFont(QStringLiteral("SF Pro Text")).exactMatch() ? QStringLiteral("SF Pro Text") : QStringLiteral("Roboto"));
+#elif _WIN32
+    QFont displayFont(QFont(QStringLiteral("Segoe UI")).exactMatch() ? QStringLiteral("Segoe UI") : QStringLiteral("Roboto"));
+#else
+    QFont displayFont(QStringLiteral("Roboto"));
+#endif
+    displayFont.setPixelSize(13);
+    displayFont.setBold(true);
+    QFontMetrics fmContent(displayFont);
+    QString sz = QString::number(indexes.size());
+    QRect szRect = fmContent.boundingRect(sz);
+    int badgeHeight = szRect.height() + 4;
+    int badgeWidth = std::max(badgeHeight, szRect.width() + 12);
+
+    const qreal dpr = stack.devicePixelRatio();
+    QSize stackSize = stack.size() / dpr;
+    QPixmap px(QSize(stackSize.width() + badgeWidth / 2, stackSize.height() + badgeHeight / 2) * dpr);
+    px.setDevicePixelRatio(dpr);
+    px.fill(Qt::transparent);
+
+    QRect badgeRect(stackSize.width() - badgeWidth / 2, 0, badgeWidth, badgeHeight);
+    QPainter painter(&px);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.drawPixmap(0, badgeHeight / 2, stack);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(230, 60, 60));
+    painter.drawRoundedRect(badgeRect, badgeHeight / 2.0, badgeHeight / 2.0);
+    painter.setPen(Qt::white);
+    painter.setFont(displayFont);
+    painter.drawText(badgeRect, Qt::AlignCenter, sz);
+    painter.end();
+    return px;
 }
 
 void NoteListView::startDrag(Qt::DropActions supportedActions)
@@ -455,54 +578,10 @@ void NoteListView::startDrag(Qt::DropActions supportedActions)
     QRect rect;
     QPixmap pixmap;
     if (indexes.size() == 1) {
-        auto current = indexes[0];
-        auto id = current.data(NoteListModel::NoteID).toInt();
-        if (m_openedEditor.contains(id)) {
-            QItemViewPaintPairs paintPairs = d->draggablePaintPairs(indexes, &rect);
-            Q_UNUSED(paintPairs);
-            auto wl = m_openedEditor[id];
-            if (!wl.empty()) {
-                pixmap = wl.first()->grab();
-            } else {
-                qDebug() << __FUNCTION__ << "Dragging row" << current.row() << "is in opened editor list but editor widget is null";
-            }
-        } else {
-            pixmap = d->renderToPixmap(indexes, &rect);
-        }
-        auto const *noteListModel = static_cast<NoteListModel *>(this->model());
-        if ((noteListModel != nullptr) && noteListModel->hasPinnedNote()
-            && (noteListModel->isFirstPinnedNote(current) || noteListModel->isFirstUnpinnedNote(current))) {
-            QRect r(0, 25, rect.width(), rect.height() - 25);
-            pixmap = pixmap.copy(r);
-            rect.setHeight(rect.height() - 25);
-        }
+        pixmap = renderDragRow(indexes[0], &rect);
         rect.adjust(horizontalOffset(), verticalOffset(), 0, 0);
     } else {
-        pixmap.load(":/images/notepad.ico");
-        pixmap = pixmap.scaled(pixmap.width() / 4, pixmap.height() / 4, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-#ifdef __APPLE__
-        QFont displayFont(QFont(QStringLiteral("SF Pro Text")).exactMatch() ? QStringLiteral("SF Pro Text") : QStringLiteral("Roboto"));
-#elif _WIN32
-        QFont displayFont(QFont(QStringLiteral("Segoe UI")).exactMatch() ? QStringLiteral("Segoe UI") : QStringLiteral("Roboto"));
-#else
-        QFont displayFont(QStringLiteral("Roboto"));
-#endif
-        displayFont.setPixelSize(16);
-        QFontMetrics fmContent(displayFont);
-        QString sz = QString::number(indexes.size());
-        QRect szRect = fmContent.boundingRect(sz);
-        QPixmap px(pixmap.width() + szRect.width(), pixmap.height());
-        px.fill(Qt::transparent);
-
-        QRect nameRect(px.rect());
-        QPainter painter(&px);
-        painter.setPen(Qt::red);
-        painter.drawPixmap(0, 0, pixmap);
-        painter.setFont(displayFont);
-        painter.drawText(nameRect, Qt::AlignRight | Qt::AlignBottom, sz);
-        painter.end();
-        std::swap(pixmap, px);
-        rect = px.rect();
+        pixmap = renderDragStack(indexes);
     }
     m_isDraggingPinnedNotes = false;
     m_isDraggingPinnedNotes =
@@ -632,26 +711,22 @@ void NoteListView::setupStyleSheet()
 
 void NoteListView::addNotesToTag(QSet<int> const &notesId, int tagId)
 {
-    for (const auto &id : std::as_const(notesId)) {
-        auto const *noteListModel = static_cast<NoteListModel *>(this->model());
-        if (noteListModel != nullptr) {
-            auto index = noteListModel->getNoteIndex(id);
-            if (index.isValid()) {
-                emit addTagRequested(index, tagId);
-            }
+    auto const *noteListModel = static_cast<NoteListModel *>(this->model());
+    if (noteListModel != nullptr) {
+        auto indexes = noteListModel->getNoteIndexes(notesId.values());
+        if (!indexes.isEmpty()) {
+            emit addTagRequested(indexes, tagId);
         }
     }
 }
 
 void NoteListView::removeNotesFromTag(QSet<int> const &notesId, int tagId)
 {
-    for (const auto &id : std::as_const(notesId)) {
-        auto const *noteListModel = static_cast<NoteListModel *>(this->model());
-        if (noteListModel != nullptr) {
-            auto index = noteListModel->getNoteIndex(id);
-            if (index.isValid()) {
-                emit removeTagRequested(index, tagId);
-            }
+    auto const *noteListModel = static_cast<NoteListModel *>(this->model());
+    if (noteListModel != nullptr) {
+        auto indexes = noteListModel->getNoteIndexes(notesId.values());
+        if (!indexes.isEmpty()) {
+            emit removeTagRequested(indexes, tagId);
         }
     }
 }
@@ -810,25 +885,33 @@ void NoteListView::onCustomContextMenu(QPoint point)
                 delete action;
             }
             m_folderActions.clear();
-            auto *m = m_contextMenu->addMenu("Move to");
-            FolderListType folders;
-            QMetaObject::invokeMethod(m_dbManager, "getFolderList", Qt::BlockingQueuedConnection, Q_RETURN_ARG(FolderListType, folders));
-            for (const auto &id : folders.keys()) {
-                if (id == m_currentFolderId) {
-                    continue;
+            QPointer<QMenu> m = m_contextMenu->addMenu("Move to");
+            // the menu opens right away, the folders fill in once the database answers
+            auto *loadingAction = m->addAction(tr("Loading..."));
+            loadingAction->setEnabled(false);
+            DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getFolderList(), [this, m, loadingAction](const FolderListType &folders) {
+                if (m.isNull()) {
+                    return;
                 }
-                auto *action = new QAction(folders[id], this);
-                connect(action, &QAction::triggered, this, [this, id] {
-                    auto indexes = selectedIndexes();
-                    for (const auto &selectedIndex : std::as_const(indexes)) {
-                        if (selectedIndex.isValid()) {
-                            emit moveNoteRequested(selectedIndex.data(NoteListModel::NoteID).toInt(), id);
-                        }
+                m->removeAction(loadingAction);
+                delete loadingAction;
+                for (const auto &id : folders.keys()) {
+                    if (id == m_currentFolderId) {
+                        continue;
                     }
-                });
-                m->addAction(action);
-                m_folderActions.append(action);
-            }
+                    auto *action = new QAction(folders[id], this);
+                    connect(action, &QAction::triggered, this, [this, id] {
+                        auto indexes = selectedIndexes();
+                        for (const auto &selectedIndex : std::as_const(indexes)) {
+                            if (selectedIndex.isValid()) {
+                                emit moveNoteRequested(selectedIndex.data(NoteListModel::NoteID).toInt(), id);
+                            }
+                        }
+                    });
+                    m->addAction(action);
+                    m_folderActions.append(action);
+                }
+            });
             m_contextMenu->addSeparator();
         }
         if (!m_isInTrash) {
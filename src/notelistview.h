@@ -34,6 +34,7 @@ public:
     void setEditorWidget(int noteId, QWidget *w);
     void unsetEditorWidget(int noteId, QWidget *w);
     void closeAllEditor();
+    void updateEditorsInViewport(const QSet<int> &reopenIds = {});
     void setListViewInfo(const ListViewInfo &newListViewInfo);
     bool isDragging() const;
 
@@ -70,8 +71,8 @@ private slots:
     void init();
 
 signals:
-    void addTagRequested(const QModelIndex &index, int tadId);
-    void removeTagRequested(const QModelIndex &index, int tadId);
+    void addTagRequested(const QModelIndexList &indexes, int tadId);
+    void removeTagRequested(const QModelIndexList &indexes, int tadId);
     void deleteNoteRequested(const QModelIndexList &index);
     void restoreNoteRequested(const QModelIndexList &indexes);
     void newNoteRequested();
@@ -112,6 +113,8 @@ private:
     bool m_isDraggingInsidePinned;
     void setupSignalsSlots();
     void setupStyleSheet();
+    QPixmap renderDragRow(const QModelIndex &index, QRect *rect);
+    QPixmap renderDragStack(const QModelIndexList &indexes);
 
     void addNotesToTag(QSet<int> const &notesId, int tagId);
     void removeNotesFromTag(QSet<int> const &notesId, int tagId);
@@ -0,0 +1,159 @@
+#include "noteoutline.h"
+
+namespace note_outline {
+namespace {
+enum class OutlineMarker { None, Heading, SetextH1, SetextH2, Fence };
+
+// What the line is, allowing up to three spaces of indentation like
+// markdown does. level is set for ATX headings.
+OutlineMarker outlineMarker(QStringView line, int *level = nullptr)
+{
+    qsizetype i = 0;
+    while (i < line.size() && i < 3 && line[i] == QLatin1Char(' ')) {
+        ++i;
+    }
+    if (i == line.size()) {
+        return OutlineMarker::None;
+    }
+    auto const c = line[i];
+    if (c == QLatin1Char('#')) {
+        qsizetype n = 1;
+        while (i + n < line.size() && line[i + n] == c) {
+            ++n;
+        }
+        // "#tag" isn't a heading
+        if (n > 6 || (i + n < line.size() && !line[i + n].isSpace())) {
+            return OutlineMarker::None;
+        }
+        if (level != nullptr) {
+            *level = static_cast<int>(n);
+        }
+        return OutlineMarker::Heading;
+    }
+    if (c == QLatin1Char('`') || c == QLatin1Char('~')) {
+        return i + 2 < line.size() && line[i + 1] == c && line[i + 2] == c ? OutlineMarker::Fence : OutlineMarker::None;
+    }
+    if (c == QLatin1Char('=') || c == QLatin1Char('-')) {
+        auto const rest = line.mid(i).trimmed();
+        for (const auto ch : rest) {
+            if (ch != c) {
+                return OutlineMarker::None;
+            }
+        }
+        if (c == QLatin1Char('=')) {
+            return OutlineMarker::SetextH1;
+        }
+        // a lone "-" starts a list item
+        return rest.size() > 1 ? OutlineMarker::SetextH2 : OutlineMarker::None;
+    }
+    return OutlineMarker::None;
+}
+
+// "## Title ##" => "Title"
+QString atxTitle(QStringView line)
+{
+    auto title = line.trimmed();
+    qsizetype n = 0;
+    while (n < title.size() && title[n] == QLatin1Char('#')) {
+        ++n;
+    }
+    title = title.mid(n).trimmed();
+    auto end = title.size();
+    while (end > 0 && title[end - 1] == QLatin1Char('#')) {
+        --end;
+    }
+    if (end == 0 || title[end - 1].isSpace()) {
+        title = title.left(end).trimmed();
+    }
+    return title.toString();
+}
+
+// Calls f(number, line, previousLine) for the outline lines of text
+template<typename F>
+void forEachOutlineLine(QStringView text, F &&f)
+{
+    QStringView previous;
+    int number = 0;
+    qsizetype start = 0;
+    while (true) {
+        auto const end = text.indexOf(QLatin1Char('\n'), start);
+        auto const line = end < 0 ? text.mid(start) : text.mid(start, end - start);
+        if (outlineMarker(line) != OutlineMarker::None) {
+            f(number, line, previous);
+        }
+        if (end < 0) {
+            break;
+        }
+        previous = line;
+        start = end + 1;
+        ++number;
+    }
+}
+} // namespace
+
+bool isOutlineLine(QStringView line)
+{
+    return outlineMarker(line) != OutlineMarker::None;
+}
+
+QVector<int> outlineLineNumbers(QStringView text)
+{
+    QVector<int> numbers;
+    forEachOutlineLine(text, [&numbers](int number, QStringView, QStringView) { numbers.append(number); });
+    return numbers;
+}
+
+// Headings inside code fences are left out, and an underline right after
+// another outline line (e.g. "---" after a heading) is a horizontal rule.
+QVector<NoteHeading> outline(const QVector<OutlineLine> &lines)
+{
+    QVector<NoteHeading> headings;
+    QChar fence;
+    qsizetype fenceLength = 0;
+    int previousNumber = -2;
+    for (const auto &line : lines) {
+        int level = 0;
+        auto const marker = outlineMarker(line.text, &level);
+        auto const followsOutlineLine = line.number == previousNumber + 1;
+        previousNumber = line.number;
+        if (marker == OutlineMarker::Fence) {
+            auto const fenceText = QStringView(line.text).trimmed();
+            qsizetype length = 0;
+            while (length < fenceText.size() && fenceText[length] == fenceText[0]) {
+                ++length;
+            }
+            if (fenceLength == 0) {
+                fence = fenceText[0];
+                fenceLength = length;
+            } else if (fenceText[0] == fence && length >= fenceLength && length == fenceText.size()) {
+                fenceLength = 0;
+            }
+            continue;
+        }
+        if (fenceLength > 0) {
+            continue;
+        }
+        if (marker == OutlineMarker::Heading) {
+            auto title = atxTitle(line.text);
+            if (!title.isEmpty()) {
+                headings.append({ level, title, line.number });
+            }
+        } else if (marker != OutlineMarker::None && !followsOutlineLine && line.number > 0) {
+            auto title = line.previousText.trimmed();
+            if (!title.isEmpty()) {
+                headings.append({ marker == OutlineMarker::SetextH1 ? 1 : 2, title, line.number - 1 });
+            }
+        }
+    }
+    return headings;
+}
+
+QVector<NoteHeading> outline(QStringView text)
+{
+    QVector<OutlineLine> lines;
+    forEachOutlineLine(text, [&lines](int number, QStringView line, QStringView previous) {
+        lines.append({ number, line.toString(), previous.toString() });
+    });
+    return outline(lines);
+}
+} // namespace note_outline
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "nodedata.h"
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+// Outline (heading) detection, done on the text alone: block states of the
+// highlighter can't be relied on while blocks are pending, and notes that
+// aren't open have none. An outline line is an ATX heading, a setext
+// underline or a code fence; the outline only depends on those and the
+// lines before the underlines.
+namespace note_outline {
+
+struct OutlineLine
+{
+    int number;
+    QString text;
+    QString previousText;
+};
+
+bool isOutlineLine(QStringView line);
+QVector<int> outlineLineNumbers(QStringView text);
+// the lines must be in order
+QVector<NoteHeading> outline(const QVector<OutlineLine> &lines);
+QVector<NoteHeading> outline(QStringView text);
+} // namespace note_outline
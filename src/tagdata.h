@@ -2,6 +2,7 @@
 #define TAGDATA_H
 
 #include <QString>
+#include <QSet>
 #include <QMetaClassInfo>
 
 namespace {
@@ -38,4 +39,19 @@ private:
 
 Q_DECLARE_METATYPE(TagData)
 
+enum class TagFilterMode : uint8_t { All, Any };
+
+// A tag selection in the tree: notes carrying all or any of tagIds, minus the
+// ones carrying any of excludedTagIds. Evaluated by DBManager::notesMatchingTags()
+struct TagFilter
+{
+    QSet<int> tagIds;
+    QSet<int> excludedTagIds;
+    TagFilterMode mode = TagFilterMode::All;
+
+    bool isEmpty() const { return tagIds.isEmpty() && excludedTagIds.isEmpty(); }
+};
+
+Q_DECLARE_METATYPE(TagFilter)
+
 #endif // TAGDATA_H
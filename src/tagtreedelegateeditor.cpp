@@ -127,6 +127,11 @@ void TagTreeDelegateEditor::updateDelegate()
                              .arg(QString::number(m_titleColor.red()), QString::number(m_titleColor.green()), QString::number(m_titleColor.blue()));
     }
     m_label->setText(displayName);
+    auto labelFont = m_label->font();
+    labelFont.setStrikeOut(static_cast<NodeTreeView *>(m_view)->isTagExcluded(m_index.data(NodeItem::Roles::NodeId).toInt()));
+    if (m_label->font() != labelFont) {
+        m_label->setFont(labelFont);
+    }
 
     if (m_label->styleSheet() != labelStyle) {
         m_label->setStyleSheet(labelStyle);
@@ -161,7 +166,11 @@ void TagTreeDelegateEditor::paintEvent(QPaintEvent *event)
     int iconPointSizeOffset = -4;
 #endif
     painter.setFont(font_loader::loadFont("Font Awesome 6 Free Solid", "", 16 + iconPointSizeOffset));
-    painter.drawText(iconRect, u8"\uf111"); // fa-circle
+    if (static_cast<NodeTreeView *>(m_view)->isTagExcluded(m_index.data(NodeItem::Roles::NodeId).toInt())) {
+        painter.drawText(iconRect, u8"\uf056"); // fa-circle-minus
+    } else {
+        painter.drawText(iconRect, u8"\uf111"); // fa-circle
+    }
     QWidget::paintEvent(event);
 }
 
@@ -3,6 +3,7 @@
 #include "nodetreemodel.h"
 #include "nodetreedelegate.h"
 #include "notelistview.h"
+#include "dbmanagerasync.h"
 #include <QDebug>
 #include <QMetaObject>
 #include <QMessageBox>
@@ -25,8 +26,20 @@ TreeViewLogic::TreeViewLogic(NodeTreeView *treeView, NodeTreeModel *treeModel, D
 {
     m_treeDelegate = new NodeTreeDelegate(m_treeView, m_treeView, m_listView);
     m_treeView->setItemDelegate(m_treeDelegate);
+    m_treeModel->setDbManager(m_dbManager);
     connect(m_dbManager, &DBManager::nodesTagTreeReceived, this, &TreeViewLogic::loadTreeModel, Qt::QueuedConnection);
     connect(m_treeModel, &NodeTreeModel::topLevelItemLayoutChanged, this, &TreeViewLogic::updateTreeViewSeparator);
+    connect(m_dbManager, &DBManager::folderAdded, m_treeModel, &NodeTreeModel::onFolderAdded, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::folderRenamed, m_treeModel, &NodeTreeModel::onFolderRenamed, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::folderMoved, m_treeModel, &NodeTreeModel::onFolderMoved, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::folderRemoved, m_treeModel, &NodeTreeModel::onFolderRemoved, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::tagAdded, m_treeModel, &NodeTreeModel::onTagAdded, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::tagRenamed, m_treeModel, &NodeTreeModel::onTagRenamed, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::tagColorChanged, m_treeModel, &NodeTreeModel::onTagColorChanged, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::tagRemoved, m_treeModel, &NodeTreeModel::onTagRemoved, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::tagRemoved, m_treeView, &NodeTreeView::onTagRemoved, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::nodesImported, this, [this] { m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex()); }, Qt::QueuedConnection);
+    connect(m_treeModel, &NodeTreeModel::requestTreeReload, m_dbManager, &DBManager::onNodeTagTreeRequested, Qt::QueuedConnection);
     connect(m_treeView, &NodeTreeView::addFolderRequested, this, [this] { onAddFolderRequested(false); });
     connect(m_treeDelegate, &NodeTreeDelegate::addFolderRequested, this, [this] { onAddFolderRequested(true); });
     connect(m_treeDelegate, &NodeTreeDelegate::addTagRequested, this, &TreeViewLogic::onAddTagRequested);
@@ -39,11 +52,9 @@ TreeViewLogic::TreeViewLogic(NodeTreeView *treeView, NodeTreeModel *treeModel, D
     connect(m_treeView, &NodeTreeView::deleteTagRequested, this, &TreeViewLogic::onDeleteTagRequested);
     connect(this, &TreeViewLogic::requestChangeTagColorInDB, m_dbManager, &DBManager::changeTagColor, Qt::QueuedConnection);
     connect(this, &TreeViewLogic::requestMoveNodeInDB, m_dbManager, &DBManager::moveNode, Qt::QueuedConnection);
-    connect(m_treeView, &NodeTreeView::moveNodeRequested, this, [this](int nodeId, int targetId) {
-        onMoveNodeRequested(nodeId, targetId);
-        emit noteMoved(nodeId, targetId);
-    });
-    connect(m_treeView, &NodeTreeView::addNoteToTag, this, &TreeViewLogic::addNoteToTag);
+    connect(this, &TreeViewLogic::requestMoveNotesInDB, m_dbManager, &DBManager::moveNotes, Qt::QueuedConnection);
+    connect(m_treeView, &NodeTreeView::moveNotesRequested, this, &TreeViewLogic::onMoveNotesRequested);
+    connect(m_treeView, &NodeTreeView::addNotesToTag, this, &TreeViewLogic::addNotesToTag);
     connect(m_treeModel, &NodeTreeModel::requestExpand, m_treeView, &NodeTreeView::onRequestExpand);
     connect(m_treeModel, &NodeTreeModel::requestUpdateAbsPath, m_treeView, &NodeTreeView::onUpdateAbsPath);
     connect(m_treeModel, &NodeTreeModel::requestMoveNode, this, &TreeViewLogic::onMoveNodeRequested);
@@ -66,40 +77,31 @@ void TreeViewLogic::updateTreeViewSeparator()
 void TreeViewLogic::loadTreeModel(const NodeTagTreeData &treeData)
 {
     m_treeModel->setTreeData(treeData);
-    {
-        NodeData node;
-        QMetaObject::invokeMethod(m_dbManager, "getChildNotesCountFolder", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, node),
-                                  Q_ARG(int, ROOT_FOLDER_ID));
+    DBManagerAsync db{ m_dbManager };
+    DBManagerAsync::then(this, db.getChildNotesCountFolder(ROOT_FOLDER_ID), [this](const NodeData &node) {
         auto index = m_treeModel->getAllNotesButtonIndex();
         if (index.isValid()) {
             m_treeModel->setData(index, node.childNotesCount(), NodeItem::Roles::ChildCount);
         }
-    }
-    {
-        NodeData node;
-        QMetaObject::invokeMethod(m_dbManager, "getChildNotesCountFolder", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, node),
-                                  Q_ARG(int, TRASH_FOLDER_ID));
+    });
+    DBManagerAsync::then(this, db.getChildNotesCountFolder(TRASH_FOLDER_ID), [this](const NodeData &node) {
         auto index = m_treeModel->getTrashButtonIndex();
         if (index.isValid()) {
             m_treeModel->setData(index, node.childNotesCount(), NodeItem::Roles::ChildCount);
         }
-    }
+    });
     if (m_needLoadSavedState) {
         m_needLoadSavedState = false;
         m_treeView->reExpandC(m_expandedFolder);
         if (m_isLastSelectFolder) {
-            QModelIndex index;
             if (m_lastSelectFolder == NodePath::getAllNoteFolderPath()) {
-                index = m_treeModel->getAllNotesButtonIndex();
+                m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
             } else if (m_lastSelectFolder == NodePath::getTrashFolderPath()) {
-                index = m_treeModel->getTrashButtonIndex();
-            } else {
-                index = m_treeModel->folderIndexFromIdPath(m_lastSelectFolder);
-            }
-            if (index.isValid()) {
-                m_treeView->setCurrentIndexC(index);
+                m_treeView->setCurrentIndexC(m_treeModel->getTrashButtonIndex());
             } else {
-                m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
+                m_treeModel->loadFolderIndex(m_lastSelectFolder, this, [this](const QModelIndex &index) {
+                    m_treeView->setCurrentIndexC(index.isValid() ? index : m_treeModel->getAllNotesButtonIndex());
+                });
             }
         } else {
             for (const auto &id : std::as_const(m_lastSelectTags)) {
@@ -153,20 +155,44 @@ void TreeViewLogic::onAddFolderRequested(bool fromPlusButton)
         }
         currentIndex = m_treeModel->rootIndex();
     }
-    int newlyCreatedNodeId;
-    NodeData newFolder;
-    newFolder.setNodeType(NodeData::Type::Folder);
-    QDateTime noteDate = QDateTime::currentDateTime();
-    newFolder.setCreationDateTime(noteDate);
-    newFolder.setLastModificationDateTime(noteDate);
-    if (parentId != ROOT_FOLDER_ID) {
-        newFolder.setFullTitle(m_treeModel->getNewFolderPlaceholderName(currentIndex));
-    } else {
-        newFolder.setFullTitle(m_treeModel->getNewFolderPlaceholderName(m_treeModel->rootIndex()));
-    }
-    newFolder.setParentId(parentId);
+    QPersistentModelIndex parentIndex = currentIndex;
+    // the placeholder name is picked among all the siblings, also the ones
+    // still in the database
+    m_treeModel->fetchChildFolders(parentId, this, [this, parentId, parentIndex, fromPlusButton, currentType, currentAbsPath, currentTagId]() {
+        if (parentId != ROOT_FOLDER_ID && !parentIndex.isValid()) {
+            return;
+        }
+        NodeData newFolder;
+        newFolder.setNodeType(NodeData::Type::Folder);
+        QDateTime noteDate = QDateTime::currentDateTime();
+        newFolder.setCreationDateTime(noteDate);
+        newFolder.setLastModificationDateTime(noteDate);
+        if (parentId != ROOT_FOLDER_ID) {
+            newFolder.setFullTitle(m_treeModel->getNewFolderPlaceholderName(parentIndex));
+        } else {
+            newFolder.setFullTitle(m_treeModel->getNewFolderPlaceholderName(m_treeModel->rootIndex()));
+        }
+        newFolder.setParentId(parentId);
+        m_treeModel->skipFolderAdded(parentId, newFolder.fullTitle());
 
-    QMetaObject::invokeMethod(m_dbManager, "addNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(int, newlyCreatedNodeId), Q_ARG(NodeData, newFolder));
+        auto future = DBManagerAsync{ m_dbManager }.addNode(newFolder);
+        DBManagerAsync::then(this, future, [this, newFolder, parentIndex, fromPlusButton, currentType, currentAbsPath, currentTagId](int newlyCreatedNodeId) {
+            onFolderCreated(newFolder, newlyCreatedNodeId, parentIndex, fromPlusButton, currentType, currentAbsPath, currentTagId);
+        });
+    });
+}
+
+void TreeViewLogic::onFolderCreated(const NodeData &newFolder, int newlyCreatedNodeId, const QPersistentModelIndex &parentIndex, bool fromPlusButton,
+                                    NodeItem::Type currentType, const QString &currentAbsPath, int currentTagId)
+{
+    int parentId = newFolder.parentId();
+    if (parentId != ROOT_FOLDER_ID && !parentIndex.isValid()) {
+        // the parent went away meanwhile, the folder shows up wherever it ends up
+        return;
+    }
+    if (newlyCreatedNodeId == INVALID_NODE_ID) {
+        return;
+    }
 
     QHash<NodeItem::Roles, QVariant> hs;
     hs[NodeItem::Roles::ItemType] = NodeItem::Type::FolderItem;
@@ -174,38 +200,37 @@ void TreeViewLogic::onAddFolderRequested(bool fromPlusButton)
     hs[NodeItem::Roles::NodeId] = newlyCreatedNodeId;
 
     if (parentId != ROOT_FOLDER_ID) {
-        hs[NodeItem::Roles::AbsPath] = currentIndex.data(NodeItem::Roles::AbsPath).toString() + PATH_SEPARATOR + QString::number(newlyCreatedNodeId);
-        m_treeModel->appendChildNodeToParent(currentIndex, hs);
-        if (!m_treeView->isExpanded(currentIndex)) {
-            m_treeView->expand(currentIndex);
+        hs[NodeItem::Roles::AbsPath] = parentIndex.data(NodeItem::Roles::AbsPath).toString() + PATH_SEPARATOR + QString::number(newlyCreatedNodeId);
+        m_treeModel->appendChildNodeToParent(parentIndex, hs);
+        if (!m_treeView->isExpanded(parentIndex)) {
+            m_treeView->expand(parentIndex);
         }
     } else {
         hs[NodeItem::Roles::AbsPath] = PATH_SEPARATOR + QString::number(ROOT_FOLDER_ID) + PATH_SEPARATOR + QString::number(newlyCreatedNodeId);
         m_treeModel->appendChildNodeToParent(m_treeModel->rootIndex(), hs);
     }
     if (fromPlusButton) {
+        auto restoreCurrent = [this](const QModelIndex &currentIndex) {
+            m_treeView->setIgnoreThisCurrentLoad(true);
+            m_treeView->reExpandC();
+            m_treeView->setCurrentIndexC(currentIndex);
+            updateTreeViewSeparator();
+            m_treeView->setIgnoreThisCurrentLoad(false);
+        };
         if (currentType == NodeItem::FolderItem) {
-            currentIndex = m_treeModel->folderIndexFromIdPath(currentAbsPath);
+            m_treeModel->loadFolderIndex(currentAbsPath, this, restoreCurrent);
         } else if (currentType == NodeItem::TagItem) {
-            currentIndex = m_treeModel->tagIndexFromId(currentTagId);
-        } else if (currentType == NodeItem::AllNoteButton) {
-            currentIndex = m_treeModel->getAllNotesButtonIndex();
+            restoreCurrent(m_treeModel->tagIndexFromId(currentTagId));
         } else if (currentType == NodeItem::TrashButton) {
-            currentIndex = m_treeModel->getTrashButtonIndex();
+            restoreCurrent(m_treeModel->getTrashButtonIndex());
         } else {
-            currentIndex = m_treeModel->getAllNotesButtonIndex();
+            restoreCurrent(m_treeModel->getAllNotesButtonIndex());
         }
-        m_treeView->setIgnoreThisCurrentLoad(true);
-        m_treeView->reExpandC();
-        m_treeView->setCurrentIndexC(currentIndex);
-        updateTreeViewSeparator();
-        m_treeView->setIgnoreThisCurrentLoad(false);
     }
 }
 
 void TreeViewLogic::onAddTagRequested()
 {
-    int newlyCreatedTagId;
     TagData newTag;
     newTag.setName(m_treeModel->getNewTagPlaceholderName());
     // random color generator
@@ -221,14 +246,18 @@ void TreeViewLogic::onAddTagRequested()
     auto color = QColor::fromHsv(h, s, v);
 
     newTag.setColor(color.name());
-    QMetaObject::invokeMethod(m_dbManager, "addTag", Qt::BlockingQueuedConnection, Q_RETURN_ARG(int, newlyCreatedTagId), Q_ARG(TagData, newTag));
-
-    QHash<NodeItem::Roles, QVariant> hs;
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::TagItem;
-    hs[NodeItem::Roles::DisplayText] = newTag.name();
-    hs[NodeItem::Roles::TagColor] = newTag.color();
-    hs[NodeItem::Roles::NodeId] = newlyCreatedTagId;
-    m_treeModel->appendChildNodeToParent(m_treeModel->rootIndex(), hs);
+    m_treeModel->skipTagAdded(newTag.name());
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.addTag(newTag), [this, newTag](int newlyCreatedTagId) {
+        if (newlyCreatedTagId == INVALID_NODE_ID) {
+            return;
+        }
+        QHash<NodeItem::Roles, QVariant> hs;
+        hs[NodeItem::Roles::ItemType] = NodeItem::Type::TagItem;
+        hs[NodeItem::Roles::DisplayText] = newTag.name();
+        hs[NodeItem::Roles::TagColor] = newTag.color();
+        hs[NodeItem::Roles::NodeId] = newlyCreatedTagId;
+        m_treeModel->appendChildNodeToParent(m_treeModel->rootIndex(), hs);
+    });
 }
 
 void TreeViewLogic::onRenameNodeRequestedFromTreeView(const QModelIndex &index, const QString &newName)
@@ -249,17 +278,21 @@ void TreeViewLogic::onDeleteFolderRequested(const QModelIndex &index)
             qDebug() << __FUNCTION__ << "Failed while trying to delete folder with id" << id;
             return;
         }
-        NodeData node;
-        QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, node), Q_ARG(int, id));
-        auto parentPath = NodePath{ node.absolutePath() }.parentPath();
-        auto parentIndex = m_treeModel->folderIndexFromIdPath(parentPath);
-        if (parentIndex.isValid()) {
-            m_treeModel->deleteRow(index, parentIndex);
-            QMetaObject::invokeMethod(m_dbManager, "moveFolderToTrash", Qt::QueuedConnection, Q_ARG(NodeData, node));
-            m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
-        } else {
-            qDebug() << __FUNCTION__ << "Parent index with path" << parentPath.path() << "is not valid";
-        }
+        QPersistentModelIndex folderIndex = index;
+        DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getNode(id), [this, folderIndex](const NodeData &node) {
+            if (!folderIndex.isValid()) {
+                return;
+            }
+            auto parentPath = NodePath{ node.absolutePath() }.parentPath();
+            auto parentIndex = m_treeModel->folderIndexFromIdPath(parentPath);
+            if (parentIndex.isValid()) {
+                m_treeModel->deleteRow(folderIndex, parentIndex);
+                QMetaObject::invokeMethod(m_dbManager, "moveFolderToTrash", Qt::QueuedConnection, Q_ARG(NodeData, node));
+                m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
+            } else {
+                qDebug() << __FUNCTION__ << "Parent index with path" << parentPath.path() << "is not valid";
+            }
+        });
     } else {
         m_treeView->closePersistentEditor(m_treeModel->getTrashButtonIndex());
         m_treeView->update(m_treeModel->getTrashButtonIndex());
@@ -304,13 +337,15 @@ void TreeViewLogic::onChildNotesCountChangedTag(int tagId, int notesCount)
 
 void TreeViewLogic::onChildNoteCountChangedFolder(int folderId, const QString &absPath, int notesCount)
 {
+    Q_UNUSED(absPath);
     QModelIndex index;
     if (folderId == ROOT_FOLDER_ID) {
         index = m_treeModel->getAllNotesButtonIndex();
     } else if (folderId == TRASH_FOLDER_ID) {
         index = m_treeModel->getTrashButtonIndex();
     } else {
-        index = m_treeModel->folderIndexFromIdPath(absPath);
+        // folders that aren't loaded pick up their count when fetched
+        index = m_treeModel->loadedFolderIndexFromId(folderId);
     }
     if (index.isValid()) {
         m_treeModel->setData(index, notesCount, NodeItem::Roles::ChildCount);
@@ -319,48 +354,58 @@ void TreeViewLogic::onChildNoteCountChangedFolder(int folderId, const QString &a
 
 void TreeViewLogic::openFolder(int id)
 {
-    NodeData target;
-    QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, target), Q_ARG(int, id));
-    if (target.nodeType() != NodeData::Type::Folder) {
-        qDebug() << __FUNCTION__ << "Target is not folder!";
-        return;
-    }
-    if (target.id() == TRASH_FOLDER_ID) {
-        m_treeView->setCurrentIndexC(m_treeModel->getTrashButtonIndex());
-    } else if (target.id() == ROOT_FOLDER_ID) {
-        m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
-    } else {
-        auto index = m_treeModel->folderIndexFromIdPath(target.absolutePath());
-        if (index.isValid()) {
-            m_treeView->setCurrentIndexC(index);
-        } else {
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getNode(id), [this](const NodeData &target) {
+        if (target.nodeType() != NodeData::Type::Folder) {
+            qDebug() << "openFolder" << "Target is not folder!";
+            return;
+        }
+        if (target.id() == TRASH_FOLDER_ID) {
+            m_treeView->setCurrentIndexC(m_treeModel->getTrashButtonIndex());
+        } else if (target.id() == ROOT_FOLDER_ID) {
             m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
+        } else {
+            m_treeModel->loadFolderIndex(target.absolutePath(), this, [this](const QModelIndex &index) {
+                m_treeView->setCurrentIndexC(index.isValid() ? index : m_treeModel->getAllNotesButtonIndex());
+            });
         }
-    }
+    });
 }
 
 void TreeViewLogic::onMoveNodeRequested(int nodeId, int targetId)
 {
-    NodeData target;
-    QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, target), Q_ARG(int, targetId));
-    // only allow moving a node into a folder
-    if (target.nodeType() != NodeData::Type::Folder) {
-        qDebug() << __FUNCTION__ << "Target is not folder!";
-        return;
-    }
     // don't allow moving a node into itself (not sure how this can ever happen but just in case)
     if (nodeId == targetId) {
         qDebug() << __FUNCTION__ << "Can't move a node into itself";
         return;
     }
-    // don't allow moving a node into the same parent
-    NodeData node;
-    QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, node), Q_ARG(int, nodeId));
-    if (node.parentId() == targetId) {
-        qDebug() << __FUNCTION__ << "Can't move a node into the same parent";
-        return;
-    }
-    emit requestMoveNodeInDB(nodeId, target);
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getNodes({ targetId, nodeId }), [this, nodeId](const QVector<NodeData> &nodes) {
+        auto const &target = nodes[0];
+        auto const &node = nodes[1];
+        // only allow moving a node into a folder
+        if (target.nodeType() != NodeData::Type::Folder) {
+            qDebug() << "onMoveNodeRequested" << "Target is not folder!";
+            return;
+        }
+        // don't allow moving a node into the same parent
+        if (node.parentId() == target.id()) {
+            qDebug() << "onMoveNodeRequested" << "Can't move a node into the same parent";
+            return;
+        }
+        emit requestMoveNodeInDB(nodeId, target);
+    });
+}
+
+void TreeViewLogic::onMoveNotesRequested(const QList<int> &noteIds, int targetId)
+{
+    DBManagerAsync::then(this, DBManagerAsync{ m_dbManager }.getNode(targetId), [this, noteIds](const NodeData &target) {
+        if (target.nodeType() != NodeData::Type::Folder) {
+            qDebug() << "onMoveNotesRequested" << "Target is not folder!";
+            return;
+        }
+        // notes already inside the target are skipped by the database
+        emit requestMoveNotesInDB(noteIds, target);
+        emit notesMoved(noteIds, target);
+    });
 }
 
 void TreeViewLogic::setTheme(Theme::Value theme)
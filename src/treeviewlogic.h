@@ -4,6 +4,7 @@
 #include <QObject>
 #include "dbmanager.h"
 #include "editorsettingsoptions.h"
+#include "nodetreemodel.h"
 
 class NodeTreeView;
 class NodeTreeModel;
@@ -19,6 +20,7 @@ public:
     explicit TreeViewLogic(NodeTreeView *treeView, NodeTreeModel *treeModel, DBManager *dbManager, NoteListView *listView, QObject *parent = nullptr);
     void openFolder(int id);
     void onMoveNodeRequested(int nodeId, int targetId);
+    void onMoveNotesRequested(const QList<int> &noteIds, int targetId);
     void setTheme(Theme::Value theme);
     void setLastSavedState(bool isLastSelectFolder, const QString &lastSelectFolder, const QSet<int> &lastSelectTag, const QStringList &expandedFolder);
 private slots:
@@ -38,11 +40,14 @@ signals:
     void requestRenameTagInDB(int id, const QString &newName);
     void requestChangeTagColorInDB(int id, const QString &newColor);
     void requestMoveNodeInDB(int id, const NodeData &target);
-    void addNoteToTag(int noteId, int tagId);
-    void noteMoved(int nodeId, int targetId);
+    void requestMoveNotesInDB(const QList<int> &noteIds, const NodeData &target);
+    void addNotesToTag(const QList<int> &noteIds, int tagId);
+    void notesMoved(const QList<int> &noteIds, const NodeData &target);
 
 private:
     void onAddFolderRequested(bool fromPlusButton);
+    void onFolderCreated(const NodeData &newFolder, int newlyCreatedNodeId, const QPersistentModelIndex &parentIndex, bool fromPlusButton,
+                         NodeItem::Type currentType, const QString &currentAbsPath, int currentTagId);
 
 private:
     NodeTreeView *m_treeView;